@@ -7,19 +7,77 @@
 #include "ast_decl.h"
 #include <string.h> // strdup
 #include <stdio.h>  // printf
+#include <new>      // placement new
+#include <vector>
 
 CodeGenerator Node::GENERATOR = CodeGenerator();
 
 Node::Node(yyltype loc) {
-    location = new yyltype(loc);
+    location = new (Allocate(sizeof(yyltype))) yyltype(loc);
     parent = NULL;
+    kind = NoKind;
 }
 
 Node::Node() {
     location = NULL;
     parent = NULL;
+    kind = NoKind;
+}
+
+struct Node::Arena {
+    std::vector<char*> blocks;
+    char *next, *end;
+    Arena() : next(NULL), end(NULL) {}
+};
+
+static Node::Arena permanent;
+static Node::Arena *current = &permanent;
+
+/* Method: Allocate
+ * ----------------
+ * Bump allocation out of 64K blocks of the current arena; a request too
+ * big for what is left of the current block starts a new one.
+ */
+void *Node::Allocate(size_t size) {
+    static const size_t BlockSize = 1 << 16;
+    size = (size + 7) & ~(size_t)7;
+    if (size > BlockSize) {
+        current->blocks.push_back((char *)malloc(size));
+        return current->blocks.back();
+    }
+    if (current->next + size > current->end) {
+        current->blocks.push_back((char *)malloc(BlockSize));
+        current->next = current->blocks.back();
+        current->end = current->next + BlockSize;
+    }
+    void *p = current->next;
+    current->next += size;
+    return p;
+}
+
+/* Methods: BeginBody, EndBody, ReleaseArena
+ * -----------------------------------------
+ * A body left open by a syntax error is never released, so starting the
+ * next one just leaves it behind.
+ */
+void Node::BeginBody() {
+    current = new Arena;
+}
+
+Node::Arena *Node::EndBody() {
+    Arena *body = current;
+    current = &permanent;
+    return body;
+}
+
+void Node::ReleaseArena(Arena *arena) {
+    Assert(arena != &permanent);
+    for (size_t i = 0; i < arena->blocks.size(); i++)
+        free(arena->blocks[i]);
+    delete arena;
 }
 
 Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
     name = strdup(n);
+    kind = IdentifierKind;
 }
@@ -23,6 +23,17 @@
  * node classes. Your code generator should do an postorder walk on the
  * parse tree, and when visiting each node, emitting the necessary
  * instructions for that construct.
+ *
+ * Kind: Each concrete node class sets a one-byte tag naming it in its
+ * constructor. Passes other than Emit are Visitors (see ast_visit.h)
+ * that switch on the tag, so adding one doesn't mean adding a virtual
+ * method to every node class.
+ *
+ * Allocation: Nodes are carved one after the other out of large blocks
+ * (see Node::operator new), which keeps a tree built together close
+ * together in memory. They are never freed one at a time, but the parser
+ * puts each function body in an arena of its own that can be released
+ * as a whole once the body has been translated (see Node::BeginBody).
 
  */
 
@@ -35,11 +46,26 @@
 #include "tac.h"
 #include "codegen.h"
 
+typedef enum { NoKind,
+               ProgramKind, VarDeclKind, ClassDeclKind, InterfaceDeclKind, FnDeclKind,
+               StmtBlockKind, ForStmtKind, WhileStmtKind, IfStmtKind, BreakStmtKind,
+               ReturnStmtKind, PrintStmtKind,
+               EmptyExprKind, IntConstantKind, DoubleConstantKind, BoolConstantKind,
+               StringConstantKind, NullConstantKind, ArithmeticExprKind,
+               RelationalExprKind, EqualityExprKind, LogicalExprKind, AssignExprKind,
+               ThisKind, ArrayAccessKind, FieldAccessKind, CallKind, NewExprKind,
+               NewArrayExprKind, ReadIntegerExprKind, ReadLineExprKind,
+               OperatorKind, IdentifierKind, TypeKind, NamedTypeKind, ArrayTypeKind,
+               ErrorKind, NumNodeKinds } NodeKind;
+
+class Visitor;
+
 class Node
 {
  protected:
   yyltype *location;
   Node *parent;
+  unsigned char kind;     // a NodeKind
 
  public:
   static CodeGenerator GENERATOR;
@@ -49,12 +75,24 @@ class Node
   yyltype *GetLocation()   { return location; }
   void SetParent(Node *p)  { parent = p; }
   Node *GetParent()        { return parent; }
+  NodeKind GetKind()       { return (NodeKind)kind; }
+
+       // From the current arena; nodes (and their yyltypes) are never
+       // deleted one at a time
+  static void *Allocate(size_t size);
+       // Nodes allocated between BeginBody and EndBody go to an arena of
+       // their own, which EndBody returns for ReleaseArena to free
+  struct Arena;
+  static void BeginBody();
+  static Arena *EndBody();
+  static void ReleaseArena(Arena *arena);
+  static void *operator new(size_t size) { return Allocate(size); }
+  static void operator delete(void *p) {}
 
   /*
     we need to return a Location pointer to resolve certain expr, such as assignexpr.
    */
   virtual Location * Emit() {return NULL;} //Do nothing
-  virtual void Declare(){return;}
   Segment GetSegment(){
     if(parent == NULL){
       return gpRelative;
@@ -67,6 +105,11 @@ class Node
 };
 
 
+    // Visits node and the nodes below it, see ast_visit.h. It is a friend
+    // of the node classes with children.
+void Walk(Node *node, Visitor *visitor);
+
+
 class Identifier : public Node
 {
  protected:
@@ -87,7 +130,7 @@ class Identifier : public Node
 class Error : public Node
 {
  public:
- Error() : Node() {}
+ Error() : Node() { kind = ErrorKind; }
 };
 
 
@@ -17,115 +17,268 @@ Decl::Decl(Identifier *n) : Node(*n->GetLocation()) {
 
 
 VarDecl::VarDecl(Identifier *n, Type *t) : Decl(n) {
+    kind = VarDeclKind;
     Assert(n != NULL && t != NULL);
     (type=t)->SetParent(this);
 }
 
-Location * VarDecl::EmitFormal() {
-  GENERATOR.GenLabel(id->GetName());
-  Location * formal = SymbolTable::active->Lookup(id->GetName());
-  GENERATOR.GenLoadLabel(id->GetName());
-  //GENERATOR.GenLoad(formal, 0);
-  return NULL;
-}
 Location * VarDecl::Emit() {
-  GENERATOR.GenLabel(id->GetName());
-  GENERATOR.GenLoadLabel(id->GetName());
-  id->Emit();
-  type->Emit();
+  // The slot was reserved when the variable was declared, so there is no
+  // code to generate for the declaration itself.
   return NULL;
 }
 
-void VarDecl::Declare(){
+void VarDecl::Declare(DeclarePass *pass){
   SymbolTable::active->Add(id->GetName(), false, type);
 }
 
+void VarDecl::PrintLayout(std::ostream& out){
+  out << type << " " << id << ";\n";
+}
+
+std::map<std::string, ClassDecl*> ClassDecl::classes;
+
 ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<Decl*> *m) : Decl(n) {
+  kind = ClassDeclKind;
   // extends can be NULL, impl & mem may be empty lists but cannot be NULL
   Assert(n != NULL && imp != NULL && m != NULL);
   extends = ex;
   if (extends) extends->SetParent(this);
   (implements=imp)->SetParentAll(this);
   (members=m)->SetParentAll(this);
-  //GENERATOR
+  class_table = NULL;
+  super = NULL;
+  size = 0;
+  vtable = new List<const char*>;
+  classes[n->GetName()] = this;
 }
-void ClassDecl::Declare(){
-  char * class_name = id->GetName();
-  Location * declared_variable = GENERATOR.GenLoadLabel(class_name);
-  class_table = new SymbolTable(declared_variable);
-  SymbolTable::active->Add(id->GetName(), false, new NamedType(id));
-  SymbolTable::SwitchActive(class_table);
-  members->DeclareForAll();
-  SymbolTable::SwitchActive(class_table->GetParent());
+
+ClassDecl *ClassDecl::ForName(const char *name){
+  std::map<std::string, ClassDecl*>::iterator it = classes.find(name);
+  return (it == classes.end())? NULL : it->second;
+}
+
+ClassDecl *ClassDecl::ForType(Type *type){
+  NamedType *named = dynamic_cast<NamedType*>(type);
+  return named? named->GetClass() : NULL;
+}
+
+/* An object is the vtable pointer followed by the fields, the inherited
+ * ones first so a subclass object can be used as any of its superclasses.
+ * The vtable likewise starts with the superclass slots, an override takes
+ * over the slot of the method it replaces and new methods are appended.
+ * Classes can be declared in any order, so the superclass is laid out
+ * first when needed.
+ */
+void ClassDecl::Declare(DeclarePass *pass){
+  if(class_table) return; // already laid out for a subclass
+  SymbolTable *saved = SymbolTable::active;
+  int firstField = CodeGenerator::VarSize;
+  if(extends){
+    super = ForName(extends->GetName());
+    Assert(super);
+    super->Declare(pass);
+    SymbolTable::SwitchActive(super->class_table);
+    firstField = super->size;
+    for (int i = 0; i < super->vtable->NumElements(); i++)
+      vtable->Append(super->vtable->Nth(i));
+  }
+  class_table = new SymbolTable(new Location(gpRelative, 0, id->GetName()), firstField);
+  for (Decl *member : *members)
+    Walk(member, pass);
+  size = class_table->GetNextOffset();
+
+  for (int i = 0; i < members->NumElements(); i++){
+    FnDecl *fn = dynamic_cast<FnDecl*>(members->Nth(i));
+    if(!fn) continue;
+    std::string name = "_" + std::string(fn->GetName());
+    Location *inherited = super? super->FindMember(name.c_str()) : NULL;
+    int slot = inherited? inherited->GetOffset() / CodeGenerator::VarSize
+                        : vtable->NumElements();
+    if(inherited) vtable->RemoveAt(slot);
+    vtable->InsertAt(fn->GetLabel(), slot);
+    class_table->AddMethod(name.c_str(), slot, fn->GetReturnType());
+  }
+  SymbolTable::SwitchActive(saved);
 }
 
 Location * ClassDecl::Emit() {
+  SymbolTable *saved = SymbolTable::active;
   SymbolTable::SwitchActive(class_table);
-  GENERATOR.GenLabel(SymbolTable::active->GetClassName());
-  id->Emit();
-  if(extends) extends->Emit();
-  implements->EmitForAll();
   members->EmitForAll();
-  SymbolTable::SwitchActive(class_table->GetParent());
+  GENERATOR.GenVTable(id->GetName(), vtable);
+  SymbolTable::SwitchActive(saved);
   return NULL;
 }
 
+bool ClassDecl::Implements(const char *interfaceName){
+  for (int i = 0; i < implements->NumElements(); i++)
+    if(!strcmp(implements->Nth(i)->GetName(), interfaceName)) return true;
+  return super && super->Implements(interfaceName);
+}
+
+bool ClassDecl::IsSubclassOf(const char *className){
+  return !strcmp(id->GetName(), className) || (super && super->IsSubclassOf(className));
+}
+
+Location *ClassDecl::FindMember(const char *name){
+  Location *member = class_table->Lookup(name);
+  return (member && member->GetBase())? member : NULL;
+}
+
+const char *ClassDecl::MethodLabel(Location *method){
+  return vtable->Nth(method->GetOffset() / CodeGenerator::VarSize);
+}
+
+void ClassDecl::PrintLayout(std::ostream& out){
+  out << "class " << id;
+  if (extends) out << " extends " << extends;
+  for (int i = 0; i < implements->NumElements(); i++)
+    out << (i ? ", " : " implements ") << implements->Nth(i);
+  out << " {\n";
+  for (int i = 0; i < members->NumElements(); i++)
+    members->Nth(i)->PrintLayout(out);
+  out << "}\n";
+}
+
+void ClassDecl::ReleaseBody(){
+  for (int i = 0; i < members->NumElements(); i++)
+    members->Nth(i)->ReleaseBody();
+}
+
+std::map<std::string, InterfaceDecl*> InterfaceDecl::interfaces;
+
 InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(n) {
+  kind = InterfaceDeclKind;
   Assert(n != NULL && m != NULL);
   (members=m)->SetParentAll(this);
+  interfaces[n->GetName()] = this;
+}
+
+InterfaceDecl *InterfaceDecl::ForType(Type *type){
+  NamedType *named = dynamic_cast<NamedType*>(type);
+  if(!named) return NULL;
+  std::map<std::string, InterfaceDecl*>::iterator it = interfaces.find(named->GetName());
+  return (it == interfaces.end())? NULL : it->second;
+}
+
+FnDecl *InterfaceDecl::FindPrototype(const char *name){
+  for (int i = 0; i < members->NumElements(); i++){
+    FnDecl *prototype = dynamic_cast<FnDecl*>(members->Nth(i));
+    if(prototype && !strcmp(prototype->GetName(), name)) return prototype;
+  }
+  return NULL;
 }
 
 Location * InterfaceDecl::Emit() {
-  id->Emit();
-  members->EmitForAll();
+  // only prototypes, the code is in the classes that implement them
   return NULL;
 }
 
+void InterfaceDecl::PrintLayout(std::ostream& out){
+  out << "interface " << id << " {\n";
+  for (int i = 0; i < members->NumElements(); i++)
+    members->Nth(i)->PrintLayout(out);
+  out << "}\n";
+}
+
 
 FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
+  kind = FnDeclKind;
   Assert(n != NULL && r!= NULL && d != NULL);
   (returnType=r)->SetParent(this);
   (formals=d)->SetParentAll(this);
   body = NULL;
+  bodyArena = NULL;
 }
 
-void FnDecl::Declare(){
+//methods are labeled _Class.name and get the object as a hidden first
+//parameter; ClassDecl::Declare adds their entry to the class table
+void FnDecl::Declare(DeclarePass *pass){
   std::string function_name = std::string(id->GetName());
-  if(function_name != "main"){
-    function_name = "_" + function_name;
+  ClassDecl *owner = dynamic_cast<ClassDecl*>(GetParent());
+  Location * declared_variable;
+  if(owner){
+    function_name = "_" + std::string(owner->GetName()) + "." + function_name;
+    declared_variable = new Location(gpRelative, 0, function_name.c_str());
+  }
+  else{
+    if(function_name != "main"){
+      function_name = "_" + function_name;
+    }
+    SymbolTable::active->Add(function_name.c_str(), false, returnType);
+    declared_variable = SymbolTable::active->Lookup(function_name.c_str());
   }
-  SymbolTable::active->Add(function_name.c_str(), false, returnType);
-  Location * declared_variable = SymbolTable::active->Lookup(function_name.c_str());
   fn_table = new SymbolTable(declared_variable);
   SymbolTable::SwitchActive(fn_table);
 
+  if(owner){
+    SymbolTable::active->Add("this", true, new NamedType(new Identifier(*id->GetLocation(), owner->GetName())));
+  }
+
   for (int i = 0; i < formals->NumElements(); i++){
     VarDecl * var= formals->Nth(i);
     SymbolTable::active->Add(var->GetName(), true, var->GetType());
   }
 
-  body->Declare();
+  Walk(body, pass);
   SymbolTable::SwitchActive(fn_table->GetParent());
 
 }
 Location * FnDecl::Emit() {
-  //reset offsets since we'll add a stack frame
-  //GENERATOR.ResetStackFrame();
-  CodeGenerator::ResetStackFrame();
+  //temps go below the locals Declare already laid out in this frame
+  CodeGenerator::ResetStackFrame(fn_table->GetNextOffset());
   SymbolTable::SwitchActive(fn_table);
   GENERATOR.GenLabel(SymbolTable::active->GetClassName());
-  BeginFunc* func = GENERATOR.GenBeginFunc();
-  func->SetFrameSize(28);
-  id->Emit();
-  for (int i = 0; i < formals->NumElements(); i++){
-    formals->Nth(i)->EmitFormal();
-  }
+  //only the top-level main is the program's entry, not a method named main
+  bool isEntry = !dynamic_cast<ClassDecl*>(GetParent()) && strcmp(id->GetName(), "main") == 0;
+  BeginFunc* func = GENERATOR.GenBeginFunc(isEntry);
   body->Emit();
-  returnType->Emit();
+  func->SetFrameSize(CodeGenerator::FrameSize());
   GENERATOR.GenEndFunc();
   SymbolTable::SwitchActive(fn_table->GetParent());
   return NULL;
 }
-void FnDecl::SetFunctionBody(Stmt *b) {
+void FnDecl::SetFunctionBody(Stmt *b, Arena *arena) {
   (body=b)->SetParent(this);
+  bodyArena = arena;
+}
+
+//the body's types and locals are referred to from nowhere outside it once
+//it's translated: calls from other functions only use the header
+void FnDecl::ReleaseBody(){
+  if (!bodyArena) return;
+  Node::ReleaseArena(bodyArena);
+  bodyArena = NULL;
+  body = NULL;
+}
+
+void FnDecl::PrintLayout(std::ostream& out){
+  out << returnType << " " << id << "(";
+  for (int i = 0; i < formals->NumElements(); i++)
+    out << (i ? ", " : "") << formals->Nth(i)->GetType();
+  out << ");\n";
+}
+
+
+//declarations are only found in the statements, never below an expression
+bool DeclarePass::Pre(Node *node){
+  switch (node->GetKind()) {
+    case ProgramKind:
+      new SymbolTable();
+      return true;
+    case ClassDeclKind:
+      static_cast<ClassDecl*>(node)->Declare(this);
+      return false;
+    case FnDeclKind:
+      static_cast<FnDecl*>(node)->Declare(this);
+      return false;
+    case VarDeclKind:
+      static_cast<VarDecl*>(node)->Declare(this);
+      return false;
+    case StmtBlockKind: case ForStmtKind: case WhileStmtKind: case IfStmtKind:
+      return true;
+    default:
+      return false;
+  }
 }
@@ -13,23 +13,39 @@
 #define _H_ast_decl
 
 #include "ast.h"
+#include "ast_visit.h"
 #include "symbol_table.h"
 #include "list.h"
+#include <map>
+#include <string>
 
 class Type;
 class NamedType;
 class Identifier;
 class Stmt;
+class DeclarePass;
+class FnDecl;
 
 class Decl : public Node
 {
   protected:
     Identifier *id;
+    yyltype span;                   // first to last token, set by the parser
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     Decl(Identifier *name);
     char * GetName(){ return id->GetName();}
     friend std::ostream& operator<<(std::ostream& out, Decl *d) { return out << d->id; }
+
+    void SetSpan(yyltype s) { span = s; }
+    yyltype *GetSpan() { return &span; }
+         // Prints what other declarations' code can depend on: names,
+         // types, signatures and class layouts, but no function bodies
+    virtual void PrintLayout(std::ostream& out) { out << id << "\n"; }
+         // Frees the function bodies under this declaration, which must
+         // not be needed again; see Node::BeginBody
+    virtual void ReleaseBody() {}
 };
 
 class VarDecl : public Decl
@@ -38,11 +54,12 @@ class VarDecl : public Decl
     Type *type;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     VarDecl(Identifier *name, Type *type);
     Location * Emit();
-    Location * EmitFormal();
     Type * GetType(){ return type;}
-    void Declare();
+    void Declare(DeclarePass *pass);
+    void PrintLayout(std::ostream& out);
 };
 
 class ClassDecl : public Decl
@@ -52,12 +69,32 @@ class ClassDecl : public Decl
     NamedType *extends;
     List<NamedType*> *implements;
     SymbolTable *class_table;
+    ClassDecl *super;
+    int size;                       // bytes in an object, vtable pointer included
+    List<const char*> *vtable;      // method labels by slot, inherited slots first
+
+    static std::map<std::string, ClassDecl*> classes;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     ClassDecl(Identifier *name, NamedType *extends,
               List<NamedType*> *implements, List<Decl*> *members);
     Location * Emit();
-    void Declare();
+    void Declare(DeclarePass *pass);
+
+    static ClassDecl *ForName(const char *name);
+    static ClassDecl *ForType(Type *type);   // NULL unless a class type
+    static const std::map<std::string, ClassDecl*> &All() { return classes; }
+
+    int GetSize() { return size; }
+    bool Implements(const char *interfaceName);
+    bool IsSubclassOf(const char *className);   // true for itself too
+         // A field (by name) or method (by "_name", its Location has the
+         // vtable offset of its slot); NULL if the class has no such member
+    Location *FindMember(const char *name);
+    const char *MethodLabel(Location *method);
+    void PrintLayout(std::ostream& out);
+    void ReleaseBody();
 };
 
 class InterfaceDecl : public Decl
@@ -65,9 +102,17 @@ class InterfaceDecl : public Decl
   protected:
     List<Decl*> *members;
 
+    static std::map<std::string, InterfaceDecl*> interfaces;
+
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     InterfaceDecl(Identifier *name, List<Decl*> *members);
     Location * Emit();
+
+    static InterfaceDecl *ForType(Type *type);   // NULL unless an interface type
+         // The prototype of the method named name, NULL if there is none
+    FnDecl *FindPrototype(const char *name);
+    void PrintLayout(std::ostream& out);
 };
 
 class FnDecl : public Decl
@@ -76,13 +121,34 @@ class FnDecl : public Decl
     List<VarDecl*> *formals;
     Type *returnType;
     Stmt *body;
+    Arena *bodyArena;               // where the parser put the body's nodes
     SymbolTable *fn_table;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     FnDecl(Identifier *name, Type *returnType, List<VarDecl*> *formals);
-    void SetFunctionBody(Stmt *b);
+    void SetFunctionBody(Stmt *b, Arena *arena);
     Location * Emit();
-    void Declare();
+    void Declare(DeclarePass *pass);
+    void ReleaseBody();
+    Type * GetReturnType() { return returnType; }
+    const char * GetLabel() { return fn_table->GetClassName(); }
+    SymbolTable *GetTable() { return fn_table; }
+    void PrintLayout(std::ostream& out);
+};
+
+/* DeclarePass
+ * -----------
+ * Builds the symbol tables: the global one, a table per class holding its
+ * fields and methods and a table per function holding its parameters and
+ * the variables of all its blocks, and lays out objects, vtables and
+ * frames. A class is laid out after its superclass, and a function's
+ * table is set up before the pass goes into its body.
+ */
+class DeclarePass : public Visitor
+{
+  public:
+    bool Pre(Node *node);
 };
 
 #endif
@@ -8,11 +8,38 @@
 #include <string.h>
 #include "codegen.h"
 #include "errors.h"
+#include "cha.h"
 
 Expr::Expr(yyltype loc): Stmt(loc), type(Type::nullType) {}
 Expr::Expr(): Stmt(), type(Type::nullType) {}
 
+void Expr::EmitBranch(const char *trueLabel, const char *falseLabel) {
+  Location *value = Emit();
+  if(falseLabel){
+    GENERATOR.GenIfZ(value, falseLabel);
+    if(trueLabel) GENERATOR.GenGoto(trueLabel);
+  }
+  else if(trueLabel){
+    Location *zero = GENERATOR.GenLoadConstant(0);
+    GENERATOR.GenIfCompare(IfCompare::NotEq, value, zero, trueLabel);
+  }
+}
+
+//fused branch for an already evaluated comparison "lhs relop rhs"
+static void EmitCompareBranch(IfCompare::RelOp relop, Location *lhs, Location *rhs,
+                              const char *trueLabel, const char *falseLabel) {
+  CodeGenerator &gen = Node::GENERATOR;
+  if(trueLabel){
+    gen.GenIfCompare(relop, lhs, rhs, trueLabel);
+    if(falseLabel) gen.GenGoto(falseLabel);
+  }
+  else if(falseLabel){
+    gen.GenIfCompare(IfCompare::Negate(relop), lhs, rhs, falseLabel);
+  }
+}
+
 IntConstant::IntConstant(yyltype loc, int val) : Expr(loc) {
+    kind = IntConstantKind;
     value = val;
     type = Type::intType;
 }
@@ -21,16 +48,16 @@ Location * IntConstant::Emit() {
 }
 
 DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(loc) {
+    kind = DoubleConstantKind;
     value = val;
     type = Type::doubleType;
 }
 Location * DoubleConstant::Emit() {
-  //error for p5
-  ReportError::DoubleInGenP5();
-  return NULL;
+  return GENERATOR.GenLoadConstant(value);
 }
 
 BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(loc) {
+    kind = BoolConstantKind;
     value = val;
     type = Type::boolType;
 }
@@ -40,6 +67,7 @@ Location * BoolConstant::Emit() {
 }
 
 StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
+    kind = StringConstantKind;
     Assert(val != NULL);
     value = strdup(val);
     type = Type::stringType;
@@ -49,12 +77,31 @@ Location * StringConstant::Emit() {
   return GENERATOR.GenLoadConstant(value);
 }
 
+NullConstant::NullConstant(yyltype loc) : Expr(loc) {
+    kind = NullConstantKind;
+    type = Type::nullType;
+}
+
+//null is the address 0, so it compares and assigns like any pointer
+Location * NullConstant::Emit() {
+  return GENERATOR.GenLoadConstant(0);
+}
+
+void This::Resolve() {
+  self = SymbolTable::active->Lookup("this");
+  if(!self){
+    ReportError::ThisOutsideClassScope(this);
+    return;
+  }
+  type = self->GetType();
+}
+
 Location * This::Emit() {
-  //TBI
-  return NULL;
+  return self;
 }
 
 Operator::Operator(yyltype loc, const char *tok) : Node(loc) {
+    kind = OperatorKind;
     Assert(tok != NULL);
     strncpy(tokenString, tok, sizeof(tokenString));
 }
@@ -80,37 +127,131 @@ CompoundExpr::CompoundExpr(Operator *o, Expr *r)
     (right=r)->SetParent(this);
 }
 
+void AssignExpr::Resolve() {
+  type = left->GetType();
+}
+
 Location * AssignExpr::Emit() {
   Location *rhs = right->Emit();
-  char * text;
-  if(FieldAccess *var = dynamic_cast<FieldAccess*>(left)){
-    text = var->Resolve();
-  }
-  else{
-    PrintDebug("dev", "Not FieldAccess");
-    return NULL;
+  if(left->GetKind() == ArrayAccessKind){
+    GENERATOR.GenStore(static_cast<ArrayAccess*>(left)->EmitAddress(), rhs);
+    return rhs;
   }
-  Location * lhs = SymbolTable::active->Lookup(text);
-  Assert(lhs); //should always be valid in P5...
-  if(!rhs){
-    PrintDebug("dev", "Warning: wasn't able to resolve rhs of Assign to variable: ");
-    PrintDebug("dev", text);
-    return NULL;
+  Assert(left->GetKind() == FieldAccessKind && rhs);
+  FieldAccess *var = static_cast<FieldAccess*>(left);
+  Location *object = var->EmitObject();
+  Location *lhs = var->GetVariable();
+  if(object){
+    GENERATOR.GenStore(object, rhs, lhs->GetOffset());
+    return rhs;
   }
-
-  //get last temp, it will be the rhs calculated...
-  char temp [10];
-  sprintf(temp, "_tmp%d", CodeGenerator::nextTempNum-1);
   GENERATOR.GenAssign(lhs, rhs);
   return lhs;
 }
+LogicalExpr::LogicalExpr(Expr *l, Operator *o, Expr *r) : CompoundExpr(l,o,r) {
+  kind = LogicalExprKind;
+  type = Type::boolType;
+}
+
+LogicalExpr::LogicalExpr(Operator *o, Expr *r) : CompoundExpr(o,r) {
+  kind = LogicalExprKind;
+  type = Type::boolType;
+}
+
+//&& and || are lowered to jumps so the right operand is only evaluated
+//when the left one doesn't already decide the result
 Location * LogicalExpr::Emit() {
-  //TBI
-  return NULL;
+  if(!left){ // unary !
+    Location *value = right->Emit();
+    return GENERATOR.GenBinaryOp("==", value, GENERATOR.GenLoadConstant(0));
+  }
+  Location *result = GENERATOR.GenTempVar();
+  char *isFalse = GENERATOR.NewLabel();
+  char *end = GENERATOR.NewLabel();
+  EmitBranch(NULL, isFalse);
+  GENERATOR.GenAssign(result, GENERATOR.GenLoadConstant(1));
+  GENERATOR.GenGoto(end);
+  GENERATOR.GenLabel(isFalse);
+  GENERATOR.GenAssign(result, GENERATOR.GenLoadConstant(0));
+  GENERATOR.GenLabel(end);
+  return result;
 }
+
+//the operands branch straight to the targets of the enclosing test, a
+//local label is only needed where this node falls through
+void LogicalExpr::EmitBranch(const char *trueLabel, const char *falseLabel) {
+  const char *op_str = op->ToString();
+  if(!left){
+    right->EmitBranch(falseLabel, trueLabel);
+  }
+  else if(!strcmp(op_str, "&&")){
+    if(falseLabel){
+      left->EmitBranch(NULL, falseLabel);
+      right->EmitBranch(trueLabel, falseLabel);
+    }
+    else{
+      char *skip = GENERATOR.NewLabel();
+      left->EmitBranch(NULL, skip);
+      right->EmitBranch(trueLabel, NULL);
+      GENERATOR.GenLabel(skip);
+    }
+  }
+  else{ // ||
+    if(trueLabel){
+      left->EmitBranch(trueLabel, NULL);
+      right->EmitBranch(trueLabel, falseLabel);
+    }
+    else{
+      char *skip = GENERATOR.NewLabel();
+      left->EmitBranch(skip, NULL);
+      right->EmitBranch(NULL, falseLabel);
+      GENERATOR.GenLabel(skip);
+    }
+  }
+}
+EqualityExpr::EqualityExpr(Expr *l, Operator *o, Expr *r) : CompoundExpr(l,o,r) {
+  kind = EqualityExprKind;
+  type = Type::boolType;
+}
+
+//a string compared with null is a plain pointer compare
+bool EqualityExpr::ComparesStrings() {
+  return left->GetType() == Type::stringType && right->GetType() == Type::stringType;
+}
+
 Location * EqualityExpr::Emit() {
-  //TBI
-  return NULL;
+  Location *lhs = left->Emit();
+  Location *rhs = right->Emit();
+  Location *equal;
+  if(ComparesStrings()){
+    equal = GENERATOR.GenBuiltInCall(StringEqual, lhs, rhs);
+  }
+  else{
+    equal = GENERATOR.GenBinaryOp("==", lhs, rhs);
+  }
+  if(!strcmp(op->ToString(), "!=")){
+    return GENERATOR.GenBinaryOp("==", equal, GENERATOR.GenLoadConstant(0));
+  }
+  return equal;
+}
+
+void EqualityExpr::EmitBranch(const char *trueLabel, const char *falseLabel) {
+  Location *lhs = left->Emit();
+  Location *rhs = right->Emit();
+  if(ComparesStrings()){
+    //strings compare through _StringEqual, so branch on its result
+    Location *equal = GENERATOR.GenBuiltInCall(StringEqual, lhs, rhs);
+    IfCompare::RelOp relop = (!strcmp(op->ToString(), "!="))? IfCompare::Eq : IfCompare::NotEq;
+    EmitCompareBranch(relop, equal, GENERATOR.GenLoadConstant(0), trueLabel, falseLabel);
+    return;
+  }
+  EmitCompareBranch(IfCompare::RelOpForName(op->ToString()), lhs, rhs,
+                    trueLabel, falseLabel);
+}
+
+//the operands have the same type in a valid program
+void ArithmeticExpr::Resolve() {
+  type = right->GetType();
 }
 
 Location * ArithmeticExpr::Emit() {
@@ -122,141 +263,409 @@ Location * ArithmeticExpr::Emit() {
     return GENERATOR.GenBinaryOp(op_str, lhs, rhs);
   }
   else{ //unary minus is the only possibility
-    Location * zero = GENERATOR.GenLoadConstant(0);
+    Location * zero = rhs->IsDouble()? GENERATOR.GenLoadConstant(0.0)
+                                     : GENERATOR.GenLoadConstant(0);
     return GENERATOR.GenBinaryOp("-", zero, rhs);
   }
 }
 
+RelationalExpr::RelationalExpr(Expr *l, Operator *o, Expr *r) : CompoundExpr(l,o,r) {
+  kind = RelationalExprKind;
+  type = Type::boolType;
+}
+
 Location * RelationalExpr::Emit() {
-  //TBI
-  return NULL;
+  Location *lhs = left->Emit();
+  Location *rhs = right->Emit();
+  const char *op_str = op->ToString();
+  //Tac only has "<", the rest are built from it by swapping operands
+  //and/or comparing the strict result against zero
+  if(!strcmp(op_str, "<")){
+    return GENERATOR.GenBinaryOp("<", lhs, rhs);
+  }
+  if(!strcmp(op_str, ">")){
+    return GENERATOR.GenBinaryOp("<", rhs, lhs);
+  }
+  Location *strict = (!strcmp(op_str, "<="))? GENERATOR.GenBinaryOp("<", rhs, lhs)
+                                            : GENERATOR.GenBinaryOp("<", lhs, rhs);
+  return GENERATOR.GenBinaryOp("==", strict, GENERATOR.GenLoadConstant(0));
+}
+
+void RelationalExpr::EmitBranch(const char *trueLabel, const char *falseLabel) {
+  Location *lhs = left->Emit();
+  Location *rhs = right->Emit();
+  EmitCompareBranch(IfCompare::RelOpForName(op->ToString()), lhs, rhs,
+                    trueLabel, falseLabel);
 }
 
 ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(loc) {
+  kind = ArrayAccessKind;
   (base=b)->SetParent(this);
   (subscript=s)->SetParent(this);
 }
 
+void ArrayAccess::Resolve() {
+  ArrayType *arrayType = dynamic_cast<ArrayType*>(base->GetType());
+  if(!arrayType){
+    ReportError::BracketsOnNonArray(base);
+    return;
+  }
+  type = arrayType->GetElemType();
+}
+
+/* Arrays are laid out as a length word followed by the elements, and an
+ * array value points at the first element, so arr[i] is at arr + size*i
+ * (size 8 for doubles, 4 for everything else) and the length at arr - 4.
+ */
+Location * ArrayAccess::EmitAddress() {
+  Location *array = base->Emit();
+  Location *index = subscript->Emit();
+  GENERATOR.GenBoundsCheck(array, index);
+  Location *size = GENERATOR.GenLoadConstant(CodeGenerator::SizeOf(type));
+  Location *offset = GENERATOR.GenBinaryOp("*", index, size);
+  return GENERATOR.GenBinaryOp("+", array, offset);
+}
+
 Location * ArrayAccess::Emit() {
-  base->Emit();
-  subscript->Emit();
-  return NULL;
+  Location *addr = EmitAddress();
+  Location *elem = GENERATOR.GenLoad(addr, 0, type);
+  elem->SetType(type);
+  return elem;
 }
 
 FieldAccess::FieldAccess(Expr *b, Identifier *f)
   : LValue(b? Join(b->GetLocation(), f->GetLocation()) : *f->GetLocation()) {
+  kind = FieldAccessKind;
   Assert(f != NULL); // b can be be NULL (just means no explicit base)
   base = b;
   if (base) base->SetParent(this);
   (field=f)->SetParent(this);
+  variable = self = NULL;
 }
 
-//TODO: Resolve bases and arrays
-char *FieldAccess::Resolve(){
-  return field->GetName();
-
-}
-
-Location * FieldAccess::Emit() {
+//a name without a base is a local, a global or a field of this
+void FieldAccess::Resolve(){
   if(base){
-    base->Emit();
-    //SymbolTable::active->Lookup(field);
-  }
-  field->Emit();
-  PrintDebug("dev", "Looking up");
-  PrintDebug("dev", field->GetName());
-  PrintDebug("dev", "-----------");
-  //SymbolTable::active->DebugSymbolTable();
-  //PrintDebug("dev", "-----------");
-  Location * loc = SymbolTable::active->Lookup(field->GetName());
-  if(loc){
-    PrintDebug("dev", loc->GetName());
-    PrintDebug("dev", "-----------");
-    return loc;
+    ClassDecl *cls = ClassDecl::ForType(base->GetType());
+    variable = cls? cls->FindMember(field->GetName()) : NULL;
+    if(!variable){
+      ReportError::FieldNotFoundInBase(field, base->GetType());
+      return;
+    }
   }
   else{
-    PrintDebug("dev", "Didn't resolve FieldAccess");
-    return NULL;
+    variable = SymbolTable::active->Lookup(field->GetName());
+    if(!variable){
+      ReportError::IdentifierNotDeclared(field, LookingForVariable);
+      return;
+    }
+    if(variable->GetBase()) self = SymbolTable::active->Lookup("this");
   }
+  type = variable->GetType();
+}
+
+Location *FieldAccess::EmitObject(){
+  return base? base->Emit() : self;
+}
+
+Location * FieldAccess::Emit() {
+  Location *object = EmitObject();
+  if(!object) return variable;
+  return GENERATOR.GenLoad(object, variable->GetOffset(), type);
 }
 
 
 Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
+  kind = CallKind;
   Assert(f != NULL && a != NULL); // b can be be NULL (just means no explicit base)
   base = b;
   if (base) base->SetParent(this);
   (field=f)->SetParent(this);
   (actuals=a)->SetParentAll(this);
+  label = NULL;
+  method = self = NULL;
+  receiver = NULL;
+  cls = NULL;
+  target = NULL;
 }
 
-Location * Call::Emit() {
-  //may temporarily swap the active, so need to save the current
-  SymbolTable* saved = SymbolTable::active;
+//functions and methods are entered as "_name"; a method called without a
+//base is one of this's
+void Call::Resolve() {
+  if(base && dynamic_cast<ArrayType*>(base->GetType())){  // arr.length()
+    type = Type::intType;
+    return;
+  }
+  std::string name = "_" + std::string(field->GetName());
+  label = strdup(name.c_str());
   if(base){
-    Location * loc = base->Emit();
-    SymbolTable* st = SymbolTable::active->FindClassTable(loc->GetName());
-    if(st){
-      SymbolTable::active = st;
+    receiver = base->GetType();
+  }
+  else{
+    method = SymbolTable::active->Lookup(label);
+    if(!method){
+      ReportError::IdentifierNotDeclared(field, LookingForFunction);
+      return;
     }
-    else{
-      PrintDebug("dev", "Error in Call Resolution");
+    if(!method->GetBase()){
+      type = method->GetType();
+      return;
     }
+    self = SymbolTable::active->Lookup("this");
+    receiver = self->GetType();
+  }
+  Type *returnType = NULL;
+  cls = ClassDecl::ForType(receiver);
+  if(cls){
+    method = cls->FindMember(label);
+    if(method) returnType = method->GetType();
   }
-  //prepended name with underscore
-  const char * function_name = ('_' + std::string(field->GetName())).c_str();
-  Location * loc = SymbolTable::active->Lookup(function_name);
-  if(!loc){
-      PrintDebug("dev", "Error in Call Resolution");
-      SymbolTable::active->DebugSymbolTable();
-      PrintDebug("dev", "---------------");
-      return NULL;
+  else if(InterfaceDecl *interface = InterfaceDecl::ForType(receiver)){
+    FnDecl *prototype = interface->FindPrototype(field->GetName());
+    if(prototype) returnType = prototype->GetReturnType();
   }
+  if(!returnType){
+    ReportError::FieldNotFoundInBase(field, receiver);
+    return;
+  }
+  type = returnType;
+  //class hierarchy analysis: no vtable lookup when only one body is possible
+  target = IsDebugOn("noopt")? NULL : UniqueTarget(receiver->GetName(), label);
+}
 
-  Location * ret_loc = GENERATOR.GenLCall(function_name, (loc->GetType() != Type::nullType));
-  for (int i = 0; i < actuals->NumElements(); i++){
-    Location* param_loc =  actuals->Nth(i)->Emit();
-    if(param_loc){
-      GENERATOR.GenPushParam(param_loc);
+//pushes the arguments right to left, with the receiver (if any) last so it
+//ends up as the first parameter; returns the bytes to pop after the call
+static int PushParams(Location *object, List<Location*> *args) {
+  CodeGenerator &gen = Node::GENERATOR;
+  int bytes = 0;
+  for (int i = args->NumElements() - 1; i >= 0; i--){
+    gen.GenPushParam(args->Nth(i));
+    bytes += args->Nth(i)->IsDouble()? CodeGenerator::DoubleSize : CodeGenerator::VarSize;
+  }
+  if(object){
+    gen.GenPushParam(object);
+    bytes += CodeGenerator::VarSize;
+  }
+  return bytes;
+}
+
+//a call to a known label; the value goes to result when given, so the
+//paths of a guarded call can share it
+static Location *EmitDirectCall(const char *label, Location *object, List<Location*> *args,
+                                Type *returnType, Location *result = NULL) {
+  CodeGenerator &gen = Node::GENERATOR;
+  int bytes = PushParams(object, args);
+  Location *value = gen.GenLCall(label, returnType != Type::voidType, returnType);
+  gen.GenPopParams(bytes);
+  if(result && value) gen.GenAssign(result, value);
+  return value;
+}
+
+static Location *EmitVirtualCall(Location *vptr, Location *method, Location *object,
+                                 List<Location*> *args, Location *result = NULL) {
+  CodeGenerator &gen = Node::GENERATOR;
+  Type *returnType = method->GetType();
+  Location *fn = gen.GenLoad(vptr, method->GetOffset());
+  int bytes = PushParams(object, args);
+  Location *value = gen.GenACall(fn, returnType != Type::voidType, returnType);
+  gen.GenPopParams(bytes);
+  if(result && value) gen.GenAssign(result, value);
+  return value;
+}
+
+/* With -d ic each call site is a monomorphic inline cache primed with
+ * the receiver's static class: when the object's vtable pointer is that
+ * class's vtable the method is called directly, only a miss goes through
+ * the vtable slot.
+ */
+static Location *EmitMethodCall(ClassDecl *cls, Location *method, Location *object,
+                                List<Location*> *args) {
+  CodeGenerator &gen = Node::GENERATOR;
+  Location *vptr = gen.GenLoad(object);
+  if(!IsDebugOn("ic"))
+    return EmitVirtualCall(vptr, method, object, args);
+
+  Type *returnType = method->GetType();
+  Location *result = (returnType != Type::voidType)? gen.GenTempVar(returnType) : NULL;
+  char *miss = gen.NewLabel();
+  char *done = gen.NewLabel();
+  gen.GenIfCompare(IfCompare::NotEq, vptr, gen.GenLoadLabel(cls->GetName()), miss);
+  EmitDirectCall(cls->MethodLabel(method), object, args, returnType, result);
+  gen.GenGoto(done);
+  gen.GenLabel(miss);
+  EmitVirtualCall(vptr, method, object, args, result);
+  gen.GenLabel(done);
+  return result;
+}
+
+/* An interface gives no common vtable layout, but the whole program is
+ * known here, so the call tests the object's vtable against each class
+ * implementing the interface and calls that class's method directly. The
+ * last candidate needs no test. When no class implements the interface
+ * the object can only be null, and the call is a runtime error.
+ */
+static Location *EmitInterfaceCall(const char *interfaceName, const char *name,
+                                   Location *object, List<Location*> *args,
+                                   Type *returnType) {
+  CodeGenerator &gen = Node::GENERATOR;
+  List<ClassDecl*> *candidates = PossibleClasses(interfaceName);
+  if(candidates->NumElements() == 0){
+    gen.GenRuntimeError(err_no_implementation);
+    if(returnType == Type::voidType) return NULL;
+    return (returnType == Type::doubleType)? gen.GenLoadConstant(0.0)
+                                           : gen.GenLoadConstant(0);
+  }
+
+  Location *result = (returnType != Type::voidType)? gen.GenTempVar(returnType) : NULL;
+  Location *vptr = gen.GenLoad(object);
+  char *done = gen.NewLabel();
+  for (int i = 0; i < candidates->NumElements(); i++){
+    ClassDecl *cls = candidates->Nth(i);
+    char *next = NULL;
+    if(i + 1 < candidates->NumElements()){
+      next = gen.NewLabel();
+      gen.GenIfCompare(IfCompare::NotEq, vptr, gen.GenLoadLabel(cls->GetName()), next);
     }
-    else{
-      PrintDebug("dev", "Error in Call's Parameter Resolution");
+    EmitDirectCall(cls->MethodLabel(cls->FindMember(name)), object, args, returnType, result);
+    if(next){
+      gen.GenGoto(done);
+      gen.GenLabel(next);
     }
   }
-  SymbolTable::active = saved;
-  return ret_loc;
+  gen.GenLabel(done);
+  return result;
+}
+
+Location * Call::Emit() {
+  Location *object = base? base->Emit() : self;
+  if(!label){  // arr.length()
+    Location *length = GENERATOR.GenLoad(object, -CodeGenerator::VarSize);
+    length->SetType(Type::intType);
+    return length;
+  }
+  List<Location*> args;
+  for (int i = 0; i < actuals->NumElements(); i++){
+    Location *arg = actuals->Nth(i)->Emit();
+    Assert(arg);
+    args.Append(arg);
+  }
+
+  if(!object) return EmitDirectCall(label, NULL, &args, type);
+  if(target) return EmitDirectCall(target, object, &args, type);
+  if(!cls) return EmitInterfaceCall(receiver->GetName(), label, object, &args, type);
+  return EmitMethodCall(cls, method, object, &args);
 }
 
 
 NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) {
+  kind = NewExprKind;
   Assert(c != NULL);
   (cType=c)->SetParent(this);
+  type = cType;
 }
 
+//the object is zeroed by the allocator, only the vtable pointer is set
 Location * NewExpr::Emit() {
-  cType->Emit();
-  return NULL;
+  ClassDecl *cls = cType->GetClass();
+  Assert(cls);
+  Location *object = GENERATOR.GenAlloc(GENERATOR.GenLoadConstant(cls->GetSize()));
+  GENERATOR.GenStore(object, GENERATOR.GenLoadLabel(cls->GetName()));
+  object->SetType(cType);
+  return object;
 }
 
 
 NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
+  kind = NewArrayExprKind;
   Assert(sz != NULL && et != NULL);
   (size=sz)->SetParent(this);
-  (elemType=et)->SetParent(this);
+  type = new ArrayType(loc, et);
+  (elemType=et)->SetParent(this);   // not the ArrayType's, it isn't in the tree
 }
 
+//allocates the length word plus the elements, see ArrayAccess::EmitAddress;
+//a length whose size in bytes doesn't fit in an int is as bad as one <= 0
 Location * NewArrayExpr::Emit() {
-  size->Emit();
-  elemType->Emit();
-  return NULL;
+  Location *length = size->Emit();
+  int elemSize = CodeGenerator::SizeOf(elemType);
+  char *sizeBad = GENERATOR.NewLabel();
+  char *sizeOk = GENERATOR.NewLabel();
+  Location *zero = GENERATOR.GenLoadConstant(0);
+  GENERATOR.GenIfCompare(IfCompare::LessEq, length, zero, sizeBad);
+  Location *maxLength = GENERATOR.GenLoadConstant(CodeGenerator::MaxArrayLength(elemSize));
+  GENERATOR.GenIfCompare(IfCompare::LessEq, length, maxLength, sizeOk);
+  GENERATOR.GenLabel(sizeBad);
+  GENERATOR.GenRuntimeError(err_arr_bad_size);
+  GENERATOR.GenLabel(sizeOk);
+
+  Location *wordSize = GENERATOR.GenLoadConstant(CodeGenerator::VarSize);
+  Location *bytes = GENERATOR.GenArrayBytes(length, elemSize, wordSize);
+  Location *mem = GENERATOR.GenAlloc(bytes, CodeGenerator::HoldsReference(elemType));
+  GENERATOR.GenStore(mem, length);
+  return GENERATOR.GenBinaryOp("+", mem, wordSize);
 }
 
 
+ReadIntegerExpr::ReadIntegerExpr(yyltype loc) : Expr(loc) {
+  kind = ReadIntegerExprKind;
+  type = Type::intType;
+}
+
 Location * ReadIntegerExpr::Emit() {
-  GENERATOR.GenBuiltInCall(ReadInteger, NULL, NULL);
-  return NULL;
+  return GENERATOR.GenBuiltInCall(ReadInteger, NULL, NULL);
+}
+
+ReadLineExpr::ReadLineExpr(yyltype loc) : Expr(loc) {
+  kind = ReadLineExprKind;
+  type = Type::stringType;
 }
 
 Location * ReadLineExpr::Emit() {
-  GENERATOR.GenBuiltInCall(ReadLine, NULL, NULL);
-  return NULL;
+  return GENERATOR.GenBuiltInCall(ReadLine, NULL, NULL);
+}
+
+
+bool ResolvePass::Pre(Node *node) {
+  switch (node->GetKind()) {
+    case FnDeclKind:
+      saved = SymbolTable::active;
+      SymbolTable::SwitchActive(static_cast<FnDecl*>(node)->GetTable());
+      return true;
+    case InterfaceDeclKind:       // only prototypes
+      return false;
+    case NamedTypeKind:
+      static_cast<NamedType*>(node)->GetClass();
+      return false;
+    default:
+      return true;
+  }
+}
+
+//an expression is resolved after its operands, so their types are known
+void ResolvePass::Post(Node *node) {
+  switch (node->GetKind()) {
+    case FnDeclKind:
+      SymbolTable::SwitchActive(saved);
+      break;
+    case ThisKind:
+      static_cast<This*>(node)->Resolve();
+      break;
+    case ArithmeticExprKind:
+      static_cast<ArithmeticExpr*>(node)->Resolve();
+      break;
+    case AssignExprKind:
+      static_cast<AssignExpr*>(node)->Resolve();
+      break;
+    case ArrayAccessKind:
+      static_cast<ArrayAccess*>(node)->Resolve();
+      break;
+    case FieldAccessKind:
+      static_cast<FieldAccess*>(node)->Resolve();
+      break;
+    case CallKind:
+      static_cast<Call*>(node)->Resolve();
+      break;
+    default:
+      break;
+  }
 }
@@ -15,10 +15,13 @@
 
 #include "ast.h"
 #include "ast_stmt.h"
+#include "ast_visit.h"
 #include "list.h"
 
 class NamedType; // for new
 class Type; // for NewArray
+class ClassDecl;
+class SymbolTable;
 
 
 class Expr : public Stmt
@@ -30,6 +33,10 @@ class Expr : public Stmt
   Expr();
     virtual Type * GetType(){return type;}
 
+    // Emits a jump on the truth of this expression: to trueLabel when it
+    // holds, to falseLabel when it doesn't. Either label may be NULL to
+    // fall through instead. The default tests the value with IfZ.
+    virtual void EmitBranch(const char *trueLabel, const char *falseLabel);
 };
 
 /* This node type is used for those places where an expression is optional.
@@ -38,6 +45,7 @@ class Expr : public Stmt
 class EmptyExpr : public Expr
 {
   public:
+    EmptyExpr() { kind = EmptyExprKind; }
 };
 
 class IntConstant : public Expr
@@ -83,8 +91,8 @@ class StringConstant : public Expr
 class NullConstant: public Expr
 {
   public:
-    NullConstant(yyltype loc) : Expr(loc) {}
-  //emit will inherit and just return NULL
+    NullConstant(yyltype loc);
+    Location * Emit();
 };
 
 class Operator : public Node
@@ -106,6 +114,7 @@ class CompoundExpr : public Expr
     Expr *left, *right; // left will be NULL if unary
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     CompoundExpr(Expr *lhs, Operator *op, Expr *rhs); // for binary
     CompoundExpr(Operator *op, Expr *rhs);             // for unary
 };
@@ -113,40 +122,48 @@ class CompoundExpr : public Expr
 class ArithmeticExpr : public CompoundExpr
 {
   public:
-    ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
-    ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
+    ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) { kind = ArithmeticExprKind; }
+    ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) { kind = ArithmeticExprKind; }
+    void Resolve();
     Location * Emit();
 };
 
 class RelationalExpr : public CompoundExpr
 {
   public:
-    RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    RelationalExpr(Expr *lhs, Operator *op, Expr *rhs);
     Location * Emit();
+    void EmitBranch(const char *trueLabel, const char *falseLabel);
 };
 
 class EqualityExpr : public CompoundExpr
 {
+  protected:
+    bool ComparesStrings();
+
   public:
-    EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    EqualityExpr(Expr *lhs, Operator *op, Expr *rhs);
     const char *GetPrintNameForNode() { return "EqualityExpr"; }
     Location * Emit();
+    void EmitBranch(const char *trueLabel, const char *falseLabel);
 };
 
 class LogicalExpr : public CompoundExpr
 {
   public:
-    LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
-    LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
+    LogicalExpr(Expr *lhs, Operator *op, Expr *rhs);
+    LogicalExpr(Operator *op, Expr *rhs);
     const char *GetPrintNameForNode() { return "LogicalExpr"; }
     Location * Emit();
+    void EmitBranch(const char *trueLabel, const char *falseLabel);
 };
 
 class AssignExpr : public CompoundExpr
 {
   public:
-    AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) { kind = AssignExprKind; }
     const char *GetPrintNameForNode() { return "AssignExpr"; }
+    void Resolve();
     Location * Emit();
 };
 
@@ -159,8 +176,12 @@ class LValue : public Expr
 
 class This : public Expr
 {
+  protected:
+    Location *self;         // bound by ResolvePass
+
   public:
-    This(yyltype loc) : Expr(loc) {}
+    This(yyltype loc) : Expr(loc), self(NULL) { kind = ThisKind; }
+    void Resolve();
     Location * Emit();
 };
 
@@ -170,8 +191,12 @@ class ArrayAccess : public LValue
     Expr *base, *subscript;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     ArrayAccess(yyltype loc, Expr *base, Expr *subscript);
+    void Resolve();
     Location * Emit();
+    // Emits the checked address of the element, for loads and stores
+    Location * EmitAddress();
 };
 
 /* Note that field access is used both for qualified names
@@ -184,11 +209,19 @@ class FieldAccess : public LValue
   protected:
     Expr *base;	// will be NULL if no explicit base
     Identifier *field;
+    Location *variable;     // bound by ResolvePass, see GetVariable
+    Location *self;         // "this" for a field named without a base
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     FieldAccess(Expr *base, Identifier *field); //ok to pass NULL base
+    void Resolve();
     Location * Emit();
-    char *Resolve();
+         // The variable the name refers to, or for a field the member
+         // Location (offset into the object)
+    Location *GetVariable() { return variable; }
+         // The object holding the field, NULL for a plain variable
+    Location *EmitObject();
 };
 
 /* Like field access, call is used both for qualified base.field()
@@ -201,9 +234,18 @@ class Call : public Expr
     Expr *base;	// will be NULL if no explicit base
     Identifier *field;
     List<Expr*> *actuals;
+    // Bound by ResolvePass
+    const char *label;      // "_name", NULL for arr.length()
+    Location *method;       // the function, or the member of the receiver's class
+    Location *self;         // "this" for a method called without a base
+    Type *receiver;         // the static type of the object, NULL for a function
+    ClassDecl *cls;         // the class of the receiver, NULL for an interface
+    const char *target;     // the only body the call can reach, if just one
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     Call(yyltype loc, Expr *base, Identifier *field, List<Expr*> *args);
+    void Resolve();
     Location * Emit();
 };
 
@@ -213,6 +255,7 @@ class NewExpr : public Expr
     NamedType *cType;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     NewExpr(yyltype loc, NamedType *clsType);
     Location * Emit();
 };
@@ -224,6 +267,7 @@ class NewArrayExpr : public Expr
     Type *elemType;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     NewArrayExpr(yyltype loc, Expr *sizeExpr, Type *elemType);
     Location * Emit();
 };
@@ -231,16 +275,36 @@ class NewArrayExpr : public Expr
 class ReadIntegerExpr : public Expr
 {
   public:
-    ReadIntegerExpr(yyltype loc) : Expr(loc) {}
+    ReadIntegerExpr(yyltype loc);
     Location * Emit();
 };
 
 class ReadLineExpr : public Expr
 {
   public:
-    ReadLineExpr(yyltype loc) : Expr (loc) {}
+    ReadLineExpr(yyltype loc);
     Location * Emit();
 };
 
 
+/* ResolvePass
+ * -----------
+ * Runs after DeclarePass and gives every expression its type, bottom up,
+ * and binds every name once: a FieldAccess to its variable or field, a
+ * Call to its function or method and how it is dispatched, a NamedType to
+ * its class. Emit then generates code from what is cached on the nodes
+ * without looking anything up. Names that aren't declared are reported.
+ */
+class ResolvePass : public Visitor
+{
+  private:
+    SymbolTable *saved;     // the scope outside the current function
+
+  public:
+    ResolvePass() : saved(NULL) {}
+    bool Pre(Node *node);
+    void Post(Node *node);
+};
+
+
 #endif
@@ -7,23 +7,29 @@
 #include "ast_decl.h"
 #include "ast_expr.h"
 #include "codegen.h"
+#include "cache.h"
+#include "link.h"
 #include "symbol_table.h"
+#include <string>
 
 
 Program::Program(List<Decl*> *d) {
+    kind = ProgramKind;
     Assert(d != NULL);
     (decls=d)->SetParentAll(this);
 }
 
 void Program::Check() {
-    /* You can use your pp3 semantic analysis or leave it out if
-     * you want to avoid the clutter.  We won't test pp5 against
-     * semantically-invalid programs.
+    /* We won't test pp5 against semantically-invalid programs, so
+     * this only resolves names and types for code generation, see
+     * ResolvePass.
      */
+  ResolvePass pass;
+  Walk(this, &pass);
 }
 void Program::Declare() {
-  SymbolTable *global = new SymbolTable();
-  decls->DeclareForAll();
+  DeclarePass pass;
+  Walk(this, &pass);
 }
 Location * Program::Emit() {
     /* pp5: here is where the code generation is kicked off.
@@ -33,21 +39,35 @@ Location * Program::Emit() {
      *      which makes for a great use of inheritance and
      *      polymorphism in the node classes.
      */
-  decls->EmitForAll();
+  if (NumSourceFiles() > 1) {
+    CompileAndLink(decls);
+    return NULL;
+  }
+  if (IsDebugOn("cache") && !IsDebugOn("tac") && !IsDebugOn("tacfile")) {
+    CodeCache cache(decls);
+    for (int i = 0; i < decls->NumElements(); i++) {
+      cache.Emit(decls->Nth(i));
+      decls->Nth(i)->ReleaseBody();
+    }
+  } else if (IsDebugOn("stream")) {
+    //each declaration's code is out before the next is translated
+    for (int i = 0; i < decls->NumElements(); i++) {
+      decls->Nth(i)->Emit();
+      decls->Nth(i)->ReleaseBody();
+    }
+  } else
+    decls->EmitForAll();
   GENERATOR.DoFinalCodeGen();
   return NULL;
 
 }
 
 StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s) {
+    kind = StmtBlockKind;
     Assert(d != NULL && s != NULL);
     (decls=d)->SetParentAll(this);
     (stmts=s)->SetParentAll(this);
 }
-void StmtBlock::Declare() {
-  decls->DeclareForAll();
-  stmts->DeclareForAll();
-}
 Location * StmtBlock::Emit() {
   decls->EmitForAll();
   stmts->EmitForAll();
@@ -60,78 +80,129 @@ ConditionalStmt::ConditionalStmt(Expr *t, Stmt *b) {
     (body=b)->SetParent(this);
 }
 
-void  ConditionalStmt::Declare() {
-  body->Declare();
-}
-
 Location * ConditionalStmt::Emit() {
-  test->Emit();
+  char *skip = GENERATOR.NewLabel();
+  test->EmitBranch(NULL, skip);
   body->Emit();
+  GENERATOR.GenLabel(skip);
   return NULL;
 }
 
 ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) {
+    kind = ForStmtKind;
     Assert(i != NULL && t != NULL && s != NULL && b != NULL);
     (init=i)->SetParent(this);
     (step=s)->SetParent(this);
 }
 Location * LoopStmt::Emit() {
+  EmitLoop(NULL);
   return NULL;
 }
 
+/* The loop is laid out with its test at the bottom, guarded by one copy
+ * of the test on entry, so each iteration costs a single conditional
+ * branch instead of a branch plus a jump back to the top:
+ *
+ *       if !test goto exit
+ *   top:
+ *       body
+ *       step
+ *       if test goto top
+ *   exit:
+ *
+ * break jumps to exit (see BreakStmt::Emit).
+ */
+void LoopStmt::EmitLoop(Expr *step) {
+  char *top = GENERATOR.NewLabel();
+  exitLabel = GENERATOR.NewLabel();
+  test->EmitBranch(NULL, exitLabel);
+  GENERATOR.GenLabel(top);
+  body->Emit();
+  if(step) step->Emit();
+  test->EmitBranch(top, NULL);
+  GENERATOR.GenLabel(exitLabel);
+}
+
 Location * ForStmt::Emit() {
-  LoopStmt::Emit();
   init->Emit();
-  step->Emit();
+  EmitLoop(step);
   return NULL;
 }
 
 IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(t, tb) {
+    kind = IfStmtKind;
     Assert(t != NULL && tb != NULL); // else can be NULL
     elseBody = eb;
     if (elseBody) elseBody->SetParent(this);
 }
 
 Location * IfStmt::Emit() {
-  ConditionalStmt::Emit();
+  if(!elseBody){
+    return ConditionalStmt::Emit();
+  }
+  char *elseLabel = GENERATOR.NewLabel();
+  char *end = GENERATOR.NewLabel();
+  test->EmitBranch(NULL, elseLabel);
+  body->Emit();
+  GENERATOR.GenGoto(end);
+  GENERATOR.GenLabel(elseLabel);
   elseBody->Emit();
+  GENERATOR.GenLabel(end);
   return NULL;
 }
 
 ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) {
+    kind = ReturnStmtKind;
     Assert(e != NULL);
     (expr=e)->SetParent(this);
 }
 Location * ReturnStmt::Emit() {
-  expr->Emit();
+  GENERATOR.GenReturn(expr->Emit());
+  return NULL;
+}
+
+//break leaves the innermost loop enclosing it
+Location * BreakStmt::Emit() {
+  Node *n = GetParent();
+  LoopStmt *loop = NULL;
+  while (n && !(loop = dynamic_cast<LoopStmt*>(n)))
+    n = n->GetParent();
+  Assert(loop != NULL);
+  GENERATOR.GenGoto(loop->GetExitLabel());
   return NULL;
 }
 
 PrintStmt::PrintStmt(List<Expr*> *a) {
+    kind = PrintStmtKind;
     Assert(a != NULL);
     (args=a)->SetParentAll(this);
 }
+//evaluates all the args, then prints them with a single runtime call
 Location * PrintStmt::Emit() {
   PrintDebug("dev", "Print should be emitting");
+  std::string format;
+  List<Location*> values;
   for (int i = 0; i < args->NumElements(); i++){
     Expr * param_expr = args->Nth(i);
     Location * param_loc = param_expr->Emit();
     Type *type = param_expr->GetType();
-    if(!type || type == Type::nullType){
-      type = param_loc->GetType();
-    }
     if(type == Type::intType || type == Type::boolType){
-      GENERATOR.GenBuiltInCall(PrintInt, param_loc, NULL);
+      format += 'i';
     }
     else if(type == Type::stringType){
-      GENERATOR.GenBuiltInCall(PrintString, param_loc, NULL);
+      format += 's';
+    }
+    else if(type == Type::doubleType){
+      format += 'd';
     }
     else{
       PrintDebug("dev", "Just hitting the else...");
+      continue;
     }
-
+    values.Append(param_loc);
   }
 
-  args->EmitForAll();
+  if (values.NumElements() > 0)
+    GENERATOR.GenPrint(format.c_str(), &values);
   return NULL;
 }
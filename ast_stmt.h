@@ -26,9 +26,11 @@ class Program : public Node
      List<Decl*> *decls;
 
   public:
+     friend void Walk(Node *node, Visitor *visitor);
      Program(List<Decl*> *declList);
      void Check();
      Location * Emit();
+         // Builds the symbol tables, see DeclarePass
      void Declare();
 };
 
@@ -46,9 +48,9 @@ class StmtBlock : public Stmt
     List<Stmt*> *stmts;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     StmtBlock(List<VarDecl*> *variableDeclarations, List<Stmt*> *statements);
     Location * Emit();
-    void Declare();
 };
 
 
@@ -59,17 +61,22 @@ class ConditionalStmt : public Stmt
     Stmt *body;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     ConditionalStmt(Expr *testExpr, Stmt *body);
     Location * Emit();
-    virtual void Declare();
 };
 
 class LoopStmt : public ConditionalStmt
 {
+  protected:
+    char *exitLabel;
+    void EmitLoop(Expr *step);
+
   public:
     LoopStmt(Expr *testExpr, Stmt *body)
-            : ConditionalStmt(testExpr, body) {}
-  Location *Emit();
+            : ConditionalStmt(testExpr, body), exitLabel(NULL) {}
+    Location *Emit();
+    const char *GetExitLabel() { return exitLabel; }
 };
 
 class ForStmt : public LoopStmt
@@ -78,6 +85,7 @@ class ForStmt : public LoopStmt
     Expr *init, *step;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     ForStmt(Expr *init, Expr *test, Expr *step, Stmt *body);
     Location * Emit();
 };
@@ -85,7 +93,7 @@ class ForStmt : public LoopStmt
 class WhileStmt : public LoopStmt
 {
   public:
-    WhileStmt(Expr *test, Stmt *body) : LoopStmt(test, body) {}
+    WhileStmt(Expr *test, Stmt *body) : LoopStmt(test, body) { kind = WhileStmtKind; }
 };
 
 class IfStmt : public ConditionalStmt
@@ -94,6 +102,7 @@ class IfStmt : public ConditionalStmt
     Stmt *elseBody;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     IfStmt(Expr *test, Stmt *thenBody, Stmt *elseBody);
     Location * Emit();
 };
@@ -101,7 +110,8 @@ class IfStmt : public ConditionalStmt
 class BreakStmt : public Stmt
 {
   public:
-    BreakStmt(yyltype loc) : Stmt(loc) {}
+    BreakStmt(yyltype loc) : Stmt(loc) { kind = BreakStmtKind; }
+    Location * Emit();
 };
 
 class ReturnStmt : public Stmt
@@ -110,6 +120,7 @@ class ReturnStmt : public Stmt
     Expr *expr;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     ReturnStmt(yyltype loc, Expr *expr);
     Location * Emit();
 };
@@ -120,6 +131,7 @@ class PrintStmt : public Stmt
     List<Expr*> *args;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     PrintStmt(List<Expr*> *arguments);
     Location * Emit();
 };
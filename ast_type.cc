@@ -24,6 +24,7 @@ Type *Type::stringType = new Type("string");
 Type *Type::errorType  = new Type("error"); 
 
 Type::Type(const char *n) {
+    kind = TypeKind;
     Assert(n);
     typeName = strdup(n);
 }
@@ -32,12 +33,24 @@ Type::Type(const char *n) {
 
 	
 NamedType::NamedType(Identifier *i) : Type(*i->GetLocation()) {
+    kind = NamedTypeKind;
     Assert(i != NULL);
     (id=i)->SetParent(this);
+    cls = NULL;
+    bound = false;
+}
+
+ClassDecl *NamedType::GetClass() {
+    if (!bound) {
+        cls = ClassDecl::ForName(GetName());
+        bound = true;
+    }
+    return cls;
 } 
 
 
 ArrayType::ArrayType(yyltype loc, Type *et) : Type(loc) {
+    kind = ArrayTypeKind;
     Assert(et != NULL);
     (elemType=et)->SetParent(this);
 }
@@ -16,6 +16,8 @@
 #include "list.h"
 #include <iostream>
 
+class ClassDecl;
+
 
 class Type : public Node
 {
@@ -40,9 +42,15 @@ class NamedType : public Type
 {
   protected:
     Identifier *id;
+    ClassDecl *cls;
+    bool bound;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     NamedType(Identifier *i);
+    char * GetName() { return id->GetName(); }
+         // The class named, NULL for an interface; looked up on first use
+    ClassDecl *GetClass();
 
     void PrintToStream(std::ostream& out) { out << id; }
 };
@@ -53,7 +61,9 @@ class ArrayType : public Type
     Type *elemType;
 
   public:
+    friend void Walk(Node *node, Visitor *visitor);
     ArrayType(yyltype loc, Type *elemType);
+    Type *GetElemType() { return elemType; }
 
     void PrintToStream(std::ostream& out) { out << elemType << "[]"; }
 };
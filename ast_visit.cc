@@ -0,0 +1,134 @@
+/* File: ast_visit.cc
+ * ------------------
+ * Implementation of the tree walk.
+ */
+#include "ast_visit.h"
+#include "ast_decl.h"
+#include "ast_expr.h"
+#include "ast_stmt.h"
+#include "ast_type.h"
+
+
+template <class T> static void WalkAll(List<T*> *nodes, Visitor *visitor) {
+  for (T *node : *nodes)
+    Walk(node, visitor);
+}
+
+void Walk(Node *node, Visitor *visitor) {
+  if (!node) return;        // an optional part that isn't there
+  if (visitor->Pre(node)) {
+    switch (node->GetKind()) {
+      case ProgramKind:
+        WalkAll(static_cast<Program*>(node)->decls, visitor);
+        break;
+      case VarDeclKind: {
+        VarDecl *var = static_cast<VarDecl*>(node);
+        Walk(var->type, visitor);
+        Walk(var->id, visitor);
+        break;
+      }
+      case ClassDeclKind: {
+        ClassDecl *cls = static_cast<ClassDecl*>(node);
+        Walk(cls->id, visitor);
+        Walk(cls->extends, visitor);
+        WalkAll(cls->implements, visitor);
+        WalkAll(cls->members, visitor);
+        break;
+      }
+      case InterfaceDeclKind: {
+        InterfaceDecl *iface = static_cast<InterfaceDecl*>(node);
+        Walk(iface->id, visitor);
+        WalkAll(iface->members, visitor);
+        break;
+      }
+      case FnDeclKind: {
+        FnDecl *fn = static_cast<FnDecl*>(node);
+        Walk(fn->returnType, visitor);
+        Walk(fn->id, visitor);
+        WalkAll(fn->formals, visitor);
+        Walk(fn->body, visitor);
+        break;
+      }
+      case StmtBlockKind: {
+        StmtBlock *block = static_cast<StmtBlock*>(node);
+        WalkAll(block->decls, visitor);
+        WalkAll(block->stmts, visitor);
+        break;
+      }
+      case ForStmtKind: {
+        ForStmt *loop = static_cast<ForStmt*>(node);
+        Walk(loop->init, visitor);
+        Walk(loop->test, visitor);
+        Walk(loop->step, visitor);
+        Walk(loop->body, visitor);
+        break;
+      }
+      case WhileStmtKind: {
+        WhileStmt *loop = static_cast<WhileStmt*>(node);
+        Walk(loop->test, visitor);
+        Walk(loop->body, visitor);
+        break;
+      }
+      case IfStmtKind: {
+        IfStmt *stmt = static_cast<IfStmt*>(node);
+        Walk(stmt->test, visitor);
+        Walk(stmt->body, visitor);
+        Walk(stmt->elseBody, visitor);
+        break;
+      }
+      case ReturnStmtKind:
+        Walk(static_cast<ReturnStmt*>(node)->expr, visitor);
+        break;
+      case PrintStmtKind:
+        WalkAll(static_cast<PrintStmt*>(node)->args, visitor);
+        break;
+      case ArithmeticExprKind: case RelationalExprKind: case EqualityExprKind:
+      case LogicalExprKind: case AssignExprKind: {
+        CompoundExpr *expr = static_cast<CompoundExpr*>(node);
+        Walk(expr->left, visitor);
+        Walk(expr->op, visitor);
+        Walk(expr->right, visitor);
+        break;
+      }
+      case ArrayAccessKind: {
+        ArrayAccess *access = static_cast<ArrayAccess*>(node);
+        Walk(access->base, visitor);
+        Walk(access->subscript, visitor);
+        break;
+      }
+      case FieldAccessKind: {
+        FieldAccess *access = static_cast<FieldAccess*>(node);
+        Walk(access->base, visitor);
+        Walk(access->field, visitor);
+        break;
+      }
+      case CallKind: {
+        Call *call = static_cast<Call*>(node);
+        Walk(call->base, visitor);
+        Walk(call->field, visitor);
+        WalkAll(call->actuals, visitor);
+        break;
+      }
+      case NewExprKind:
+        Walk(static_cast<NewExpr*>(node)->cType, visitor);
+        break;
+      case NewArrayExprKind: {
+        NewArrayExpr *expr = static_cast<NewArrayExpr*>(node);
+        Walk(expr->size, visitor);
+        Walk(expr->elemType, visitor);
+        break;
+      }
+      case NamedTypeKind:
+        Walk(static_cast<NamedType*>(node)->id, visitor);
+        break;
+      case ArrayTypeKind:
+        Walk(static_cast<ArrayType*>(node)->elemType, visitor);
+        break;
+      default:              // constants, names, operators: no children
+        Assert(node->GetKind() != NoKind);
+        break;
+    }
+  }
+  visitor->Post(node);
+}
+
@@ -0,0 +1,28 @@
+/* File: ast_visit.h
+ * -----------------
+ * Passes over the parse tree. A pass is a Visitor: Walk calls its Pre on
+ * a node before the nodes below it, which it visits in source order, and
+ * its Post on the way back up. Pre returning false skips the nodes below
+ * (Post is still called). Walk knows the children of every kind of node,
+ * so a pass only handles the kinds it cares about, switching on
+ * Node::GetKind().
+ *
+ * Code generation isn't a pass: Emit hands the Location of an expression's
+ * value back to the parent and statements emit their parts out of source
+ * order (a loop's test after its body), so it stays a virtual method.
+ */
+
+#ifndef _H_ast_visit
+#define _H_ast_visit
+
+#include "ast.h"
+
+class Visitor
+{
+  public:
+    virtual ~Visitor() {}
+    virtual bool Pre(Node *node) { return true; }
+    virtual void Post(Node *node) {}
+};
+
+#endif
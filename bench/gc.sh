@@ -0,0 +1,88 @@
+#!/bin/sh
+#
+# gc.sh
+# Usage:  bench/gc.sh [rounds...]     (run from the directory holding dcc and defs.asm)
+#
+# Allocation-heavy benchmark for the collector in defs.asm. The program
+# below keeps a fixed set of arrays alive (reachable from a global and
+# from a local) while it allocates and drops arrays of varying sizes,
+# some holding references and some not. Each run prints the heap size
+# when main returns (read from _heap_start/_heap_end by a small driver
+# that calls main) along with spim's instruction count. With the
+# collector the heap stays the same size however many rounds are run;
+# without it, it would grow by about 1.9K per round.
+#
+
+SPIM=${SPIM:-spim}
+ROUNDS=${*:-"100 400 1600"}
+TMP=${TMPDIR:-/tmp}/gc.$$
+
+if [ ! -x dcc -o ! -r defs.asm ]; then
+  echo "gc.sh: run from the directory containing dcc and defs.asm"
+  exit 1
+fi
+
+run() {
+  cat > $TMP.decaf <<END
+int[][] kept;
+
+void main() {
+  int i;
+  int k;
+  int sum;
+  int[][] table;
+  int[] junk;
+  int[][] nest;
+
+  kept = NewArray(100, int[]);
+  table = NewArray(20, int[]);
+  for (i = 0; i < 100; i = i + 1) {
+    kept[i] = NewArray(i + 1, int);
+    kept[i][i] = i;
+  }
+  for (i = 0; i < $1; i = i + 1) {
+    for (k = 0; k < 20; k = k + 1) {
+      junk = NewArray(k * 2 + 1, int);
+      junk[k] = k;
+    }
+    nest = NewArray(4, int[]);
+    nest[3] = NewArray(10, int);
+    table[i % 20] = NewArray(8, int);
+  }
+  sum = 0;
+  for (i = 0; i < 100; i = i + 1) sum = sum + kept[i][i];
+  if (sum != 4950) Print("wrong result ", sum, "\n");
+}
+END
+  ./dcc < $TMP.decaf | sed 's/^\( *\)main:/\1_bench_main:/' > $TMP.asm || exit 1
+  cat >> $TMP.asm <<END
+	.text
+main:
+	subu \$sp, \$sp, 4
+	sw \$ra, 4(\$sp)
+	jal _bench_main
+	lw \$a0, _heap_end
+	lw \$t0, _heap_start
+	subu \$a0, \$a0, \$t0
+	li \$v0, 1
+	syscall
+	la \$a0, _bench_nl
+	li \$v0, 4
+	syscall
+	lw \$ra, 4(\$sp)
+	addu \$sp, \$sp, 4
+	li \$v0, 10
+	syscall
+	.data
+_bench_nl: .asciiz "\\n"
+	.text
+END
+  cat defs.asm >> $TMP.asm
+  $SPIM -count -file $TMP.asm | awk -v n=$1 '
+    $1 == "total" { count = $2 }
+    /^[0-9]+$/ { heap = $1 }
+    END { printf "%6d rounds  heap %8d bytes  %10d instructions\n", n, heap, count }'
+}
+
+for n in $ROUNDS; do run $n; done
+rm -f $TMP.decaf $TMP.asm
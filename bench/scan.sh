@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# scan.sh
+# Usage:  bench/scan.sh [dcc...]      (MB=<size of the source>, default 8)
+#
+# Scanner throughput benchmark. Generates a Decaf source of about MB
+# megabytes (functions full of declarations, arithmetic, string and
+# double constants, comments and blank lines) and runs each given dcc
+# (./dcc by default) over it with -d scan, which only tokenizes the
+# input. Prints the token count, the best wall time of three runs and
+# tokens per second, so building the compiler before and after a
+# scanner change and passing both binaries compares the two. The
+# binaries must agree on the token count (a flex build and a
+# "make LEXER=hand" build, say); if one doesn't, that is reported and
+# the exit status is 1.
+#
+
+MB=${MB:-8}
+DCCS=${*:-./dcc}
+TMP=${TMPDIR:-/tmp}/scan.$$
+
+awk -v bytes=$((MB * 1024 * 1024)) 'BEGIN {
+  size = 0
+  for (f = 0; size < bytes; f++) {
+    text = sprintf("/* function %d\n * computes nothing useful\n */\nint f%d(int a, double b) {\n", f, f)
+    text = text sprintf("  int count_%d;\n  string s;\n\n", f)
+    for (i = 0; i < 20; i++)
+      text = text sprintf("  count_%d = (a + %d) * 0x%X - count_%d %% 7; // step %d\n", f, i, i * 31, f, i)
+    text = text sprintf("  if (b >= %d.5E2 && a != %d) s = \"line %d\";\n", f % 100, f, f)
+    text = text sprintf("  while (count_%d < 100) count_%d = count_%d + 1;\n", f, f, f)
+    text = text "\treturn count_" f ";\n}\n\n"
+    printf "%s", text
+    size += length(text)
+  }
+  print "void main() { }"
+}' > $TMP.decaf
+
+now() { date +%s%N; }
+expected=
+status=0
+
+for dcc in $DCCS; do
+  if [ ! -x $dcc ]; then
+    echo "scan.sh: $dcc is not an executable"
+    continue
+  fi
+  best=0
+  for run in 1 2 3; do
+    start=$(now)
+    tokens=$($dcc -d scan < $TMP.decaf | awk '{ print $1 }')
+    ns=$(($(now) - start))
+    if [ $best -eq 0 -o $ns -lt $best ]; then best=$ns; fi
+  done
+  awk -v dcc=$dcc -v mb=$MB -v tokens=$tokens -v ns=$best 'BEGIN {
+    printf "%-20s %3d MB  %9d tokens  %7.3f s  %12.0f tokens/sec\n",
+           dcc, mb, tokens, ns / 1e9, tokens / (ns / 1e9) }'
+  if [ -z "$expected" ]; then
+    expected=$tokens
+  elif [ "$tokens" != "$expected" ]; then
+    echo "scan.sh: $dcc scanned $tokens tokens, not $expected"
+    status=1
+  fi
+done
+rm -f $TMP.decaf
+exit $status
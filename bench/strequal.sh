@@ -0,0 +1,82 @@
+#!/bin/sh
+#
+# strequal.sh
+# Usage:  bench/strequal.sh [reps]     (run from the directory holding defs.asm)
+#
+# Micro-benchmark for _StringEqual in defs.asm. For each case it builds a
+# small driver that calls _StringEqual reps times on the same two strings,
+# runs it with "spim -count" and reads back the total number of
+# instructions executed, which is spim's cycle count (one instruction per
+# cycle, no delay slots modelled). Each case is run at a short and a long
+# length and the difference divided by reps * (long - short), so the
+# call overhead and the driver loop cancel out and what remains is the
+# cost per character compared.
+#
+# Cases: equal strings that share word alignment, equal strings that
+# don't (the byte loop), and strings that differ only in the last byte.
+#
+
+SPIM=${SPIM:-spim}
+REPS=${1:-200}
+SHORT=8
+LONG=512
+TMP=${TMPDIR:-/tmp}/strequal.$$
+
+if [ ! -r defs.asm ]; then
+  echo "strequal.sh: run from the directory containing defs.asm"
+  exit 1
+fi
+
+# string of n copies of character c
+repeat() {
+  awk -v n=$1 -v c=$2 'BEGIN { s = ""; for (i = 0; i < n; i++) s = s c; print s }'
+}
+
+# cycles for one driver run: $1 length, $2 misalignment of s2, $3 last char of s2
+cycles() {
+  s=`repeat $(($1 - 1)) a`
+  pad=`repeat $2 x`
+  cat > $TMP.asm <<END
+	.text
+	.align 2
+	.globl main
+main:
+	li \$s0, $REPS
+loop:
+	la \$t0, s2
+	subu \$sp, \$sp, 4
+	sw \$t0, 4(\$sp)
+	la \$t0, s1
+	subu \$sp, \$sp, 4
+	sw \$t0, 4(\$sp)
+	jal _StringEqual
+	add \$sp, \$sp, 8
+	subu \$s0, \$s0, 1
+	bnez \$s0, loop
+	li \$v0, 10
+	syscall
+	.data
+	.align 2
+s1:	.asciiz "${s}a"
+	.align 2
+	.ascii "$pad"
+s2:	.asciiz "${s}$3"
+	.align 2
+_gc_roots: .word 0	# no globals for the collector
+	.text
+END
+  cat defs.asm >> $TMP.asm
+  $SPIM -count -file $TMP.asm | awk '$1 == "total" { print $2 }'
+}
+
+report() {
+  short=`cycles $SHORT $2 $3`
+  long=`cycles $LONG $2 $3`
+  awk -v a=$short -v b=$long -v r=$REPS -v n=$(($LONG - $SHORT)) -v name="$1" \
+    'BEGIN { printf "%-28s %6.2f cycles/byte\n", name, (b - a) / (r * n) }'
+}
+
+report "equal, same alignment" 0 a
+report "equal, s2 one byte off" 1 a
+report "differ in last byte" 0 b
+rm -f $TMP.asm
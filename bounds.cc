@@ -0,0 +1,231 @@
+/* File: bounds.cc
+ * ---------------
+ * Implementation of bounds check elimination. Facts about a Location are
+ * taken from its definitions, so the analysis leans on temps being
+ * assigned exactly once and on locals only changing through explicit
+ * assignments (nothing in Decaf can take their address).
+ */
+
+#include "bounds.h"
+#include "cfg.h"
+#include "codegen.h"
+#include <map>
+#include <string.h>
+
+  // the largest step accepted for an induction variable, small enough
+  // that i + step can't overflow while i is below some array's length
+static const int MaxStep = 1 << 16;
+
+class BoundsEliminator {
+  private:
+    FlowGraph *graph;
+    std::map<Location*, std::vector<Instruction*> > defs;
+    std::map<Instruction*, BasicBlock*> blockOf;
+
+    Instruction *UniqueDef(Location *loc);
+    bool Defines(BasicBlock *b, Location *loc);
+    bool IsConstantIn(Location *loc, int low, int high);
+    bool IsLengthOf(Location *len, Location *array);
+    bool IsStepOf(Instruction *instr, Location *var);
+    bool IsStableArray(Location *array, Loop *loop);
+    bool EntersNonNegative(Location *var, Loop *loop);
+    bool IsGrowingCounter(Location *var, Loop *loop);
+    bool EdgeProvesBelow(BasicBlock *from, BasicBlock *to,
+                         Location *var, Location *array);
+    bool UnchangedSinceHeader(Location *var, Loop *loop,
+                              BasicBlock *b, Instruction *use);
+    bool IsRedundant(BoundsCheck *check, BasicBlock *b, Loop *loop);
+
+  public:
+    BoundsEliminator(FlowGraph *g);
+    void Run();
+};
+
+BoundsEliminator::BoundsEliminator(FlowGraph *g) : graph(g)
+{
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    std::list<Instruction*>::iterator p;
+    for (p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p) {
+      blockOf[*p] = blocks[i];
+      if ((*p)->GetDst()) defs[(*p)->GetDst()].push_back(*p);
+    }
+  }
+}
+
+Instruction *BoundsEliminator::UniqueDef(Location *loc)
+{
+  std::vector<Instruction*> &d = defs[loc];
+  return d.size() == 1 ? d[0] : NULL;
+}
+
+bool BoundsEliminator::Defines(BasicBlock *b, Location *loc)
+{
+  std::list<Instruction*>::iterator p;
+  for (p = b->code.begin(); p != b->code.end(); ++p)
+    if ((*p)->GetDst() == loc) return true;
+  return false;
+}
+
+bool BoundsEliminator::IsConstantIn(Location *loc, int low, int high)
+{
+  LoadConstant *c = dynamic_cast<LoadConstant*>(UniqueDef(loc));
+  if (!c) {
+    Assign *copy = dynamic_cast<Assign*>(UniqueDef(loc));
+    if (copy) c = dynamic_cast<LoadConstant*>(UniqueDef(copy->GetSrc(0)));
+  }
+  return c && c->GetValue() >= low && c->GetValue() <= high;
+}
+
+bool BoundsEliminator::IsLengthOf(Location *len, Location *array)
+{
+  Load *load = dynamic_cast<Load*>(UniqueDef(len));
+  return load && load->GetSrc(0) == array
+    && load->GetOffset() == -CodeGenerator::VarSize;
+}
+
+  // var = var + c, or var + c computed into a temp that is copied to var
+bool BoundsEliminator::IsStepOf(Instruction *instr, Location *var)
+{
+  if (Assign *copy = dynamic_cast<Assign*>(instr))
+    instr = UniqueDef(copy->GetSrc(0));
+  BinaryOp *op = dynamic_cast<BinaryOp*>(instr);
+  if (!op || op->GetOpCode() != BinaryOp::Add) return false;
+  Location *a = op->GetSrc(0), *b = op->GetSrc(1);
+  return (a == var && IsConstantIn(b, 0, MaxStep))
+    || (b == var && IsConstantIn(a, 0, MaxStep));
+}
+
+bool BoundsEliminator::IsStableArray(Location *array, Loop *loop)
+{
+  if (array->GetSegment() != fpRelative) return false;
+  std::vector<Instruction*> &d = defs[array];
+  if (d.empty()) return true;   // a parameter
+  if (d.size() > 1) return false;
+  BasicBlock *b = blockOf[d[0]];
+  return !loop->Contains(b) && graph->Dominates(b, loop->header);
+}
+
+  // The value var holds when control enters the loop from outside is
+  // found by walking back from the entering edge through blocks with a
+  // single predecessor until an assignment to var turns up.
+bool BoundsEliminator::EntersNonNegative(Location *var, Loop *loop)
+{
+  BasicBlock *b = graph->GetPreheader(loop);
+  while (b) {
+    std::list<Instruction*>::reverse_iterator p;
+    for (p = b->code.rbegin(); p != b->code.rend(); ++p) {
+      if ((*p)->GetDst() != var) continue;
+      if (dynamic_cast<LoadConstant*>(*p))
+        return ((LoadConstant*)*p)->GetValue() >= 0;
+      Assign *copy = dynamic_cast<Assign*>(*p);
+      return copy && IsConstantIn(copy->GetSrc(0), 0, MaxStep);
+    }
+    b = b->preds.size() == 1 ? b->preds[0] : NULL;
+  }
+  return false;
+}
+
+bool BoundsEliminator::IsGrowingCounter(Location *var, Loop *loop)
+{
+  if (var->GetSegment() != fpRelative) return false;
+  std::vector<Instruction*> &d = defs[var];
+  for (int i = 0; i < (int)d.size(); i++)
+    if (loop->Contains(blockOf[d[i]]) && !IsStepOf(d[i], var))
+      return false;
+  return EntersNonNegative(var, loop);
+}
+
+  // Whether taking the edge from -> to implies var < array's length.
+  // Blocks that just pass control along (a preheader, say) are skipped
+  // back over as long as they don't assign var.
+bool BoundsEliminator::EdgeProvesBelow(BasicBlock *from, BasicBlock *to,
+                                       Location *var, Location *array)
+{
+  while (true) {
+    Instruction *last = from->GetTerminator();
+    if (IfCompare *cmp = dynamic_cast<IfCompare*>(last)) {
+      const char *target = to->GetLabel();
+      bool taken = target && strcmp(cmp->branch_label(), target) == 0;
+      if (taken && from->id + 1 == to->id) return false;
+      IfCompare::RelOp relop = taken ? cmp->GetRelOp()
+                                     : IfCompare::Negate(cmp->GetRelOp());
+      Location *a = cmp->GetSrc(0), *b = cmp->GetSrc(1);
+      return (relop == IfCompare::Less && a == var && IsLengthOf(b, array))
+        || (relop == IfCompare::Greater && b == var && IsLengthOf(a, array));
+    }
+    if (last && !dynamic_cast<Goto*>(last)) return false;
+    if (Defines(from, var) || from->preds.size() != 1) return false;
+    to = from;
+    from = from->preds[0];
+  }
+}
+
+  // No assignment to var lies on a path from the loop header to use
+  // that stays within one iteration (doesn't pass the header again).
+bool BoundsEliminator::UnchangedSinceHeader(Location *var, Loop *loop,
+                                            BasicBlock *b, Instruction *use)
+{
+  std::list<Instruction*>::iterator p;
+  for (p = b->code.begin(); *p != use; ++p)
+    if ((*p)->GetDst() == var) return false;
+  if (b == loop->header) return true;
+
+  std::vector<bool> seen(graph->Blocks().size(), false);
+  std::vector<BasicBlock*> work;
+  for (int i = 0; i < (int)loop->blocks.size(); i++)
+    if (Defines(loop->blocks[i], var)) work.push_back(loop->blocks[i]);
+  while (!work.empty()) {
+    BasicBlock *d = work.back();
+    work.pop_back();
+    for (int i = 0; i < (int)d->succs.size(); i++) {
+      BasicBlock *s = d->succs[i];
+      if (s == loop->header || !loop->Contains(s) || seen[s->id]) continue;
+      if (s == b) return false;
+      seen[s->id] = true;
+      work.push_back(s);
+    }
+  }
+  return true;
+}
+
+bool BoundsEliminator::IsRedundant(BoundsCheck *check, BasicBlock *b, Loop *loop)
+{
+  Location *array = check->GetSrc(0), *index = check->GetSrc(1);
+  if (!IsStableArray(array, loop) || !IsGrowingCounter(index, loop))
+    return false;
+  BasicBlock *header = loop->header;
+  for (int i = 0; i < (int)header->preds.size(); i++)
+    if (!EdgeProvesBelow(header->preds[i], header, index, array))
+      return false;
+  return UnchangedSinceHeader(index, loop, b, check);
+}
+
+void BoundsEliminator::Run()
+{
+  std::vector<Loop*> &loops = graph->Loops();
+  for (int i = 0; i < (int)loops.size(); i++) {
+    Loop *loop = loops[i];
+    for (int j = 0; j < (int)loop->blocks.size(); j++) {
+      std::list<Instruction*> &code = loop->blocks[j]->code;
+      std::list<Instruction*>::iterator p = code.begin();
+      while (p != code.end()) {
+        BoundsCheck *check = dynamic_cast<BoundsCheck*>(*p);
+        if (check && IsRedundant(check, loop->blocks[j], loop)) {
+          PrintDebug("bounds", "removed %s[%s]", check->GetSrc(0)->GetName(),
+                     check->GetSrc(1)->GetName());
+          p = code.erase(p);
+        } else {
+          ++p;
+        }
+      }
+    }
+  }
+}
+
+
+void EliminateBoundsChecks(FlowGraph *graph)
+{
+  BoundsEliminator eliminator(graph);
+  eliminator.Run();
+}
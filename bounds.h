@@ -0,0 +1,25 @@
+/* File: bounds.h
+ * --------------
+ * Removes array bounds checks that a simple range analysis proves can
+ * never fail.
+ *
+ * The case handled is the canonical counting loop
+ *
+ *     for (i = <non-negative constant>; i < arr.length(); i = i + <c>)
+ *         ... arr[i] ...
+ *
+ * (or the same shape written as a while loop), where i only ever grows
+ * by non-negative constants, and arr is not reassigned inside the loop.
+ * Then 0 <= i holds throughout, and i < arr.length() holds from the top
+ * of each iteration up to the first assignment to i, so a BoundsCheck on
+ * arr[i] in that stretch is redundant. Every other check stays.
+ */
+
+#ifndef _H_bounds
+#define _H_bounds
+
+class FlowGraph;
+
+void EliminateBoundsChecks(FlowGraph *graph);
+
+#endif
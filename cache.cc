@@ -0,0 +1,282 @@
+/* File: cache.cc
+ * --------------
+ * Implementation of the compilation cache. Entries are text files: a
+ * header line, the numbers, one line per string constant and then the
+ * assembly itself and the jump tables it made, each preceded by its
+ * length. They are written under a temporary name and renamed into
+ * place, so a compile that is killed halfway (or two running at once)
+ * never leaves a partial entry.
+ */
+
+#include "cache.h"
+#include "ast_decl.h"
+#include "codegen.h"
+#include "mips.h"
+#include "scanner.h" // for GetLineNumbered
+#include "utility.h"
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char *EntryHeader = "dcc-cache 3";
+
+//the compiler binary (its size and modification time) and the debug keys
+void DescribeCompiler(std::ostream &out)
+{
+  struct stat exe;
+  if (stat("/proc/self/exe", &exe) == 0)
+    out << "dcc " << exe.st_size << " " << exe.st_mtime << "\n";
+  else
+    out << "dcc " << __DATE__ << " " << __TIME__ << "\n";
+  for (int i = 0; i < NumDebugKeys(); i++)
+    out << NthDebugKey(i) << " ";
+  out << "\n";
+}
+
+//two 64-bit FNV-1a hashes (from different starting values) in hex
+std::string HashKey(const std::string &s)
+{
+  unsigned long long a = 14695981039346656037ULL, b = 0x84222325cbf29ce4ULL;
+  for (size_t i = 0; i < s.size(); i++) {
+    a = (a ^ (unsigned char)s[i]) * 1099511628211ULL;
+    b = (b ^ (unsigned char)s[i]) * 1099511628211ULL;
+  }
+  char hex[40];
+  sprintf(hex, "%016llx%016llx", a, b);
+  return hex;
+}
+
+CodeCache::CodeCache(List<Decl*> *decls)
+{
+  SetDebugForKey("stream", true);
+  const char *env = getenv("DCC_CACHE");
+  dir = (env && *env) ? env : ".dcc-cache";
+  mkdir(dir.c_str(), 0777);
+
+  std::ostringstream out;
+  DescribeCompiler(out);
+  for (int i = 0; i < decls->NumElements(); i++)
+    decls->Nth(i)->PrintLayout(out);
+  common = out.str();
+}
+
+//the source lines decl spans, whole, with the layout etc. in front
+std::string CodeCache::KeyFor(Decl *decl)
+{
+  std::string material = common;
+  yyltype *span = decl->GetSpan();
+  for (int n = span->first_line; n <= span->last_line; n++) {
+    const char *line = GetLineNumbered(n);
+    material += "\n";
+    if (line) material += line;
+  }
+  return HashKey(material);
+}
+
+//a length on a line of its own, then that many bytes
+static bool ReadText(std::istream &in, std::string *text)
+{
+  size_t length;
+  if (!(in >> length)) return false;
+  in.get();
+  text->resize(length);
+  in.read(&(*text)[0], length);
+  return in.gcount() == (std::streamsize)length;
+}
+
+bool CodeCache::Load(const std::string &key, Entry *entry)
+{
+  std::ifstream in((dir + "/" + key).c_str(), std::ios::binary);
+  std::string header;
+  if (!in || !std::getline(in, header) || header != EntryHeader) return false;
+  int numStrings, numDoubles;
+  in >> entry->label >> entry->numLabels >> entry->temp >> entry->numTemps
+     >> entry->compare >> entry->numCompares >> numStrings;
+  for (int i = 0; i < numStrings && in; i++) {
+    int num;
+    std::string str;
+    in >> num;
+    in.get();
+    std::getline(in, str);
+    entry->stringNums.push_back(num);
+    entry->strings.push_back(str);
+  }
+  in >> numDoubles;
+  for (int i = 0; i < numDoubles && in; i++) {
+    int num;
+    unsigned long long bits;
+    double val;
+    in >> num >> std::hex >> bits >> std::dec;
+    memcpy(&val, &bits, sizeof(val));
+    entry->doubleNums.push_back(num);
+    entry->doubles.push_back(val);
+  }
+  return ReadText(in, &entry->text) && ReadText(in, &entry->tables);
+}
+
+void CodeCache::Store(const std::string &key, Entry *entry)
+{
+  char suffix[32];
+  sprintf(suffix, ".%d", (int)getpid());
+  std::string path = dir + "/" + key, temp = path + suffix;
+  std::ofstream out(temp.c_str(), std::ios::binary);
+  out << EntryHeader << "\n"
+      << entry->label << " " << entry->numLabels << " "
+      << entry->temp << " " << entry->numTemps << " "
+      << entry->compare << " " << entry->numCompares << "\n"
+      << entry->strings.size() << "\n";
+  for (size_t i = 0; i < entry->strings.size(); i++)
+    out << entry->stringNums[i] << " " << entry->strings[i] << "\n";
+  out << entry->doubles.size() << "\n";
+  for (size_t i = 0; i < entry->doubles.size(); i++) {
+    unsigned long long bits;      // exactly, and inf and nan too
+    memcpy(&bits, &entry->doubles[i], sizeof(bits));
+    out << entry->doubleNums[i] << " " << std::hex << bits << std::dec << "\n";
+  }
+  out << entry->text.size() << "\n" << entry->text;
+  out << entry->tables.size() << "\n" << entry->tables;
+  out.close();
+  if (!out || rename(temp.c_str(), path.c_str()) != 0) remove(temp.c_str());
+}
+
+void CodeCache::Generate(Decl *decl, Entry *entry)
+{
+  CodeGenerator &gen = Node::GENERATOR;
+  Mips *mips = gen.GetMips();
+  entry->label = CodeGenerator::nextLabelNum;
+  entry->temp = CodeGenerator::nextTempNum;
+  entry->compare = mips->nextCompareNum;
+  size_t tables = mips->pooledTables.size();
+
+  Mips::capture = &entry->text;
+  mips->NoteStrings(&entry->strings);
+  mips->NoteDoubles(&entry->doubles);
+  decl->Emit();
+  gen.FlushCode();
+  Mips::capture = NULL;
+  mips->NoteStrings(NULL);
+  mips->NoteDoubles(NULL);
+
+  entry->numLabels = CodeGenerator::nextLabelNum - entry->label;
+  entry->numTemps = CodeGenerator::nextTempNum - entry->temp;
+  entry->numCompares = mips->nextCompareNum - entry->compare;
+  entry->tables = mips->pooledTables.substr(tables);
+  for (size_t i = 0; i < entry->strings.size(); i++)
+    entry->stringNums.push_back(mips->InternString(entry->strings[i].c_str()));
+  for (size_t i = 0; i < entry->doubles.size(); i++)
+    entry->doubleNums.push_back(mips->InternDouble(entry->doubles[i]));
+  fputs(entry->text.c_str(), stdout);
+}
+
+
+/* The numbered names are found outside the quotes of string constants
+ * (which appear in the Tac comments), as a prefix and digits not part of
+ * a longer name. A family is moved as a range or, for the pooled
+ * constants, renumbered by a map; a number outside the range the entry
+ * used, or a constant the entry didn't load, is left alone.
+ */
+struct Family {
+  const char *prefix;
+  int from, count, to;
+  std::map<int, int> *renumber;     // instead of the range, if set
+};
+
+static bool InName(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+      || c == '_' || c == '.';
+}
+
+static std::string Relocate(const std::string &text, Family *families, int numFamilies)
+{
+  std::string out;
+  out.reserve(text.size());
+  bool quoted = false;
+  size_t i = 0;
+  while (i < text.size()) {
+    char c = text[i];
+    if (c == '"') quoted = !quoted;
+    if (quoted || c != '_' || (i > 0 && InName(text[i-1]))) {
+      out += c;
+      i++;
+      continue;
+    }
+    bool relocated = false;
+    for (int f = 0; f < numFamilies && !relocated; f++) {
+      Family &family = families[f];
+      const char *prefix = family.prefix;
+      size_t len = strlen(prefix), end = i + len;
+      if (text.compare(i, len, prefix) != 0) continue;
+      int num = 0;
+      while (end < text.size() && text[end] >= '0' && text[end] <= '9')
+        num = num * 10 + (text[end++] - '0');
+      if (end == i + len || (end < text.size() && InName(text[end]))) continue;
+      if (family.renumber) {
+        if (!family.renumber->count(num)) continue;
+        num = (*family.renumber)[num];
+      } else {
+        if (num < family.from || num >= family.from + family.count) continue;
+        num += family.to - family.from;
+      }
+      char name[48];
+      sprintf(name, "%s%d", prefix, num);
+      out += name;
+      i = end;
+      relocated = true;
+    }
+    if (!relocated) {
+      out += c;
+      i++;
+    }
+  }
+  return out;
+}
+
+void CodeCache::Splice(Entry *entry)
+{
+  Mips *mips = Node::GENERATOR.GetMips();
+  std::map<int, int> strings, doubles;
+  for (size_t i = 0; i < entry->strings.size(); i++)
+    strings[entry->stringNums[i]] = mips->InternString(entry->strings[i].c_str());
+  for (size_t i = 0; i < entry->doubles.size(); i++)
+    doubles[entry->doubleNums[i]] = mips->InternDouble(entry->doubles[i]);
+  Family families[] = {
+    {"_L", entry->label, entry->numLabels, CodeGenerator::nextLabelNum, NULL},
+    {"_tmp", entry->temp, entry->numTemps, CodeGenerator::nextTempNum, NULL},
+    {"_fcmp", entry->compare, entry->numCompares, mips->nextCompareNum, NULL},
+    {"_string", 0, 0, 0, &strings},
+    {"_double", 0, 0, 0, &doubles},
+  };
+  fputs(Relocate(entry->text, families, 5).c_str(), stdout);
+  mips->pooledTables += Relocate(entry->tables, families, 5);
+  CodeGenerator::nextLabelNum += entry->numLabels;
+  CodeGenerator::nextTempNum += entry->numTemps;
+  mips->nextCompareNum += entry->numCompares;
+}
+
+/* Method: Emit
+ * ------------
+ * Only functions and classes have code; variables and interfaces are
+ * emitted (as nothing) directly.
+ */
+void CodeCache::Emit(Decl *decl)
+{
+  if (!dynamic_cast<FnDecl*>(decl) && !dynamic_cast<ClassDecl*>(decl)) {
+    decl->Emit();
+    return;
+  }
+  std::string key = KeyFor(decl);
+  Entry entry;
+  if (Load(key, &entry)) {
+    PrintDebug("dev", "cache hit %s for %s", key.c_str(), decl->GetName());
+    Splice(&entry);
+    return;
+  }
+  PrintDebug("dev", "cache miss %s for %s", key.c_str(), decl->GetName());
+  Generate(decl, &entry);
+  Store(key, &entry);
+}
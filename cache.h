@@ -0,0 +1,66 @@
+/* File: cache.h
+ * -------------
+ * The compilation cache (-d cache) keeps the assembly emitted for each
+ * top-level function and class on disk, so recompiling a program where
+ * only a few of them changed only generates code for those.
+ *
+ * An entry is named by a hash of everything the code depends on: the
+ * source lines the declaration spans, the layout of the whole program
+ * (the signatures and class layouts Decl::PrintLayout prints), the debug
+ * keys and the compiler binary itself. It holds the assembly along with
+ * the numbers its _L, _tmp and _fcmp names started at, the string and
+ * double constants it loads and the jump tables it adds to the data
+ * segment. Spliced into a later compile, the names are renumbered to
+ * continue from where that compile is and the constants and tables are
+ * pooled in the same order, so the output is byte for byte what the
+ * compile would have generated.
+ *
+ * The cache directory is $DCC_CACHE, .dcc-cache if that isn't set. The
+ * mode implies -d stream, functions are not inlined into each other.
+ */
+
+#ifndef _H_cache
+#define _H_cache
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "list.h"
+
+class Decl;
+
+class CodeCache {
+  private:
+    std::string dir;
+    std::string common;         // compiler, debug keys and program layout
+
+    struct Entry {
+      int label, temp, compare;                    // first numbers used
+      int numLabels, numTemps, numCompares;
+      std::vector<std::string> strings;            // in first-load order
+      std::vector<int> stringNums;
+      std::vector<double> doubles;                 // likewise
+      std::vector<int> doubleNums;
+      std::string text;
+      std::string tables;                           // added to Mips::pooledTables
+    };
+
+    std::string KeyFor(Decl *decl);
+    bool Load(const std::string &key, Entry *entry);
+    void Store(const std::string &key, Entry *entry);
+    void Generate(Decl *decl, Entry *entry);
+    void Splice(Entry *entry);
+
+  public:
+    CodeCache(List<Decl*> *decls);
+
+         // Emits decl's code, from the cache if it's there
+    void Emit(Decl *decl);
+};
+
+     // What the output depends on besides the source, and the hash keys
+     // are made from. Object files (link.h) are keyed the same way.
+void DescribeCompiler(std::ostream &out);
+std::string HashKey(const std::string &material);
+
+#endif
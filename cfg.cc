@@ -0,0 +1,337 @@
+/* File: cfg.cc
+ * ------------
+ * Implementation of the FlowGraph class: basic block construction,
+ * dominators (the iterative algorithm of Cooper, Harvey and Kennedy),
+ * dominance frontiers and natural loop discovery.
+ */
+
+#include "cfg.h"
+#include <map>
+#include <string>
+#include <string.h>
+#include <algorithm>
+
+
+const char *BasicBlock::GetLabel() {
+  if (code.empty()) return NULL;
+  Label *label = dynamic_cast<Label*>(code.front());
+  return label ? label->text() : NULL;
+}
+
+Instruction *BasicBlock::GetTerminator() {
+  if (code.empty()) return NULL;
+  Instruction *last = code.back();
+  if (last->branch_label() || !last->FallsThrough()) return last;
+  return NULL;
+}
+
+bool BasicBlock::FallsThrough() {
+  return code.empty() || code.back()->FallsThrough();
+}
+
+bool Loop::Contains(BasicBlock *b) {
+  return b->id < (int)member.size() && member[b->id];
+}
+
+
+/* Constructor
+ * -----------
+ * A new block starts at every label and after every instruction that
+ * can transfer control (branches, jumps, returns).
+ */
+FlowGraph::FlowGraph(std::list<Instruction*>::iterator first,
+                     std::list<Instruction*>::iterator last)
+{
+  BasicBlock *current = NULL;
+  bool startNew = true;
+  for (std::list<Instruction*>::iterator p = first; p != last; ++p) {
+    Instruction *instr = *p;
+    if (startNew || dynamic_cast<Label*>(instr)) {
+      current = new BasicBlock(blocks.size());
+      blocks.push_back(current);
+    }
+    current->code.push_back(instr);
+    startNew = (instr->branch_label() != NULL || !instr->FallsThrough());
+  }
+  if (blocks.empty())
+    blocks.push_back(new BasicBlock(0));
+  Analyze();
+}
+
+FlowGraph::~FlowGraph()
+{
+  for (int i = 0; i < (int)blocks.size(); i++) delete blocks[i];
+  for (int i = 0; i < (int)loops.size(); i++) delete loops[i];
+}
+
+void FlowGraph::Analyze()
+{
+  ComputeEdges();
+  ComputeDominators();
+  ComputeFrontiers();
+  FindLoops();
+}
+
+
+static void AddEdge(BasicBlock *from, BasicBlock *to)
+{
+  if (std::find(from->succs.begin(), from->succs.end(), to) != from->succs.end())
+    return;
+  from->succs.push_back(to);
+  to->preds.push_back(from);
+}
+
+void FlowGraph::ComputeEdges()
+{
+  std::map<std::string, BasicBlock*> labeled;
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    blocks[i]->id = i;
+    blocks[i]->preds.clear();
+    blocks[i]->succs.clear();
+    const char *label = blocks[i]->GetLabel();
+    if (label) labeled[label] = blocks[i];
+  }
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    BasicBlock *b = blocks[i];
+    Instruction *last = b->GetTerminator();
+    const char *target = last ? last->branch_label() : NULL;
+    if (target && labeled.count(target))
+      AddEdge(b, labeled[target]);
+    if (b->FallsThrough() && i + 1 < (int)blocks.size())
+      AddEdge(b, blocks[i+1]);
+  }
+}
+
+
+static void Postorder(BasicBlock *b, std::vector<BasicBlock*> &order)
+{
+  b->reachable = true;
+  for (int i = 0; i < (int)b->succs.size(); i++)
+    if (!b->succs[i]->reachable) Postorder(b->succs[i], order);
+  order.push_back(b);
+}
+
+static BasicBlock *Intersect(BasicBlock *a, BasicBlock *b,
+                             std::map<BasicBlock*, int> &number)
+{
+  while (a != b) {
+    while (number[a] < number[b]) a = a->idom;
+    while (number[b] < number[a]) b = b->idom;
+  }
+  return a;
+}
+
+/* Method: ComputeDominators
+ * -------------------------
+ * Iterates idom(b) = intersection of the dominators of b's processed
+ * predecessors, visiting blocks in reverse postorder until nothing
+ * changes. Blocks not reachable from the entry get no idom.
+ */
+void FlowGraph::ComputeDominators()
+{
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    blocks[i]->reachable = false;
+    blocks[i]->idom = NULL;
+    blocks[i]->domChildren.clear();
+  }
+  std::vector<BasicBlock*> post;
+  Postorder(Entry(), post);
+  rpo.assign(post.rbegin(), post.rend());
+
+  std::map<BasicBlock*, int> number;   // postorder number
+  for (int i = 0; i < (int)post.size(); i++) number[post[i]] = i;
+
+  BasicBlock *entry = Entry();
+  entry->idom = entry;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 1; i < (int)rpo.size(); i++) {
+      BasicBlock *b = rpo[i];
+      BasicBlock *newIdom = NULL;
+      for (int j = 0; j < (int)b->preds.size(); j++) {
+        BasicBlock *p = b->preds[j];
+        if (!p->reachable || !p->idom) continue;
+        newIdom = newIdom ? Intersect(p, newIdom, number) : p;
+      }
+      if (newIdom != b->idom) {
+        b->idom = newIdom;
+        changed = true;
+      }
+    }
+  }
+  entry->idom = NULL;
+  for (int i = 1; i < (int)rpo.size(); i++)
+    rpo[i]->idom->domChildren.push_back(rpo[i]);
+}
+
+bool FlowGraph::Dominates(BasicBlock *a, BasicBlock *b)
+{
+  if (!a->reachable || !b->reachable) return false;
+  for (; b != NULL; b = b->idom)
+    if (b == a) return true;
+  return false;
+}
+
+void FlowGraph::ComputeFrontiers()
+{
+  for (int i = 0; i < (int)blocks.size(); i++)
+    blocks[i]->frontier.clear();
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    BasicBlock *b = rpo[i];
+    if (b->preds.size() < 2) continue;
+    for (int j = 0; j < (int)b->preds.size(); j++) {
+      BasicBlock *runner = b->preds[j];
+      if (!runner->reachable) continue;
+      while (runner != b->idom) {
+        std::vector<BasicBlock*> &df = runner->frontier;
+        if (std::find(df.begin(), df.end(), b) == df.end())
+          df.push_back(b);
+        runner = runner->idom;
+      }
+    }
+  }
+}
+
+
+static bool LargerLoop(Loop *a, Loop *b)
+{
+  return a->blocks.size() > b->blocks.size();
+}
+
+static bool DeeperLoop(Loop *a, Loop *b)
+{
+  return a->depth > b->depth;
+}
+
+/* Method: FindLoops
+ * -----------------
+ * Every edge b->h where h dominates b is a back edge of the natural loop
+ * headed by h, whose body is everything that reaches b without passing
+ * through h. Back edges sharing a header make a single loop. A loop's
+ * parent is the smallest other loop containing its header.
+ */
+void FlowGraph::FindLoops()
+{
+  for (int i = 0; i < (int)loops.size(); i++) delete loops[i];
+  loops.clear();
+  int n = blocks.size();
+  std::map<BasicBlock*, Loop*> byHeader;
+
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    BasicBlock *tail = rpo[i];
+    for (int j = 0; j < (int)tail->succs.size(); j++) {
+      BasicBlock *header = tail->succs[j];
+      if (!Dominates(header, tail)) continue;
+      Loop *loop = byHeader[header];
+      if (!loop) {
+        loop = byHeader[header] = new Loop(header);
+        loop->member.assign(n, false);
+        loop->member[header->id] = true;
+        loops.push_back(loop);
+      }
+      std::vector<BasicBlock*> work;
+      if (!loop->member[tail->id]) {
+        loop->member[tail->id] = true;
+        work.push_back(tail);
+      }
+      while (!work.empty()) {
+        BasicBlock *b = work.back();
+        work.pop_back();
+        for (int k = 0; k < (int)b->preds.size(); k++) {
+          BasicBlock *p = b->preds[k];
+          if (p->reachable && !loop->member[p->id]) {
+            loop->member[p->id] = true;
+            work.push_back(p);
+          }
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < (int)loops.size(); i++) {
+    Loop *loop = loops[i];
+    for (int k = 0; k < n; k++) {
+      if (!loop->member[k]) continue;
+      loop->blocks.push_back(blocks[k]);
+      for (int s = 0; s < (int)blocks[k]->succs.size(); s++)
+        if (!loop->member[blocks[k]->succs[s]->id]) {
+          loop->exiting.push_back(blocks[k]);
+          break;
+        }
+    }
+  }
+
+  // larger loops first, so the last container found is the smallest
+  std::sort(loops.begin(), loops.end(), LargerLoop);
+  for (int i = 0; i < (int)loops.size(); i++) {
+    for (int j = 0; j < i; j++)
+      if (loops[j]->Contains(loops[i]->header) && loops[j] != loops[i])
+        loops[i]->parent = loops[j];
+    loops[i]->depth = loops[i]->parent ? loops[i]->parent->depth + 1 : 1;
+  }
+  for (int k = 0; k < n; k++) blocks[k]->loop = NULL;
+  for (int i = 0; i < (int)loops.size(); i++)
+    for (int k = 0; k < (int)loops[i]->blocks.size(); k++)
+      loops[i]->blocks[k]->loop = loops[i];
+  std::stable_sort(loops.begin(), loops.end(), DeeperLoop);
+}
+
+
+BasicBlock *FlowGraph::InsertBlock(int pos)
+{
+  Assert(pos >= 0 && pos <= (int)blocks.size());
+  BasicBlock *b = new BasicBlock(pos);
+  blocks.insert(blocks.begin() + pos, b);
+  for (int i = 0; i < (int)blocks.size(); i++) blocks[i]->id = i;
+  return b;
+}
+
+static void OutsidePreds(Loop *loop, std::vector<BasicBlock*> &outside)
+{
+  BasicBlock *header = loop->header;
+  for (int i = 0; i < (int)header->preds.size(); i++)
+    if (!loop->Contains(header->preds[i]) && header->preds[i]->reachable)
+      outside.push_back(header->preds[i]);
+}
+
+BasicBlock *FlowGraph::GetPreheader(Loop *loop)
+{
+  std::vector<BasicBlock*> outside;
+  OutsidePreds(loop, outside);
+  if (outside.size() == 1 && outside[0]->succs.size() == 1)
+    return outside[0];
+  return NULL;
+}
+
+void FlowGraph::AddPreheaders()
+{
+  bool added = true;
+  while (added) {
+    added = false;
+    for (int i = 0; i < (int)loops.size() && !added; i++) {
+      Loop *loop = loops[i];
+      BasicBlock *header = loop->header;
+      if (GetPreheader(loop)) continue;
+      std::vector<BasicBlock*> outside;
+      OutsidePreds(loop, outside);
+      if (outside.empty() && header == Entry()) {
+        InsertBlock(0);
+        added = true;
+      } else if (outside.size() == 1 && outside[0]->id == header->id - 1
+                 && outside[0]->FallsThrough()) {
+        // entered by falling through from a block that also branches
+        // elsewhere: put an empty block on the fall-through edge
+        InsertBlock(header->id);
+        added = true;
+      }
+    }
+    if (added) Analyze();
+  }
+}
+
+void FlowGraph::Flatten(std::list<Instruction*> &out)
+{
+  for (int i = 0; i < (int)blocks.size(); i++)
+    out.insert(out.end(), blocks[i]->code.begin(), blocks[i]->code.end());
+}
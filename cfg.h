@@ -0,0 +1,109 @@
+/* File: cfg.h
+ * -----------
+ * The FlowGraph class splits the Tac instructions of one function into
+ * basic blocks and computes the control flow facts the optimization
+ * passes need: predecessors/successors, dominators, dominance frontiers
+ * and natural loops.
+ *
+ * A graph is built from the instructions strictly between a BeginFunc
+ * and its EndFunc. Blocks keep the layout order of the original list, so
+ * a block that falls through continues with the next block in Blocks().
+ * Passes edit the blocks' instruction lists in place, call Analyze again
+ * if they changed the shape of the graph (added blocks, retargeted
+ * branches), and finally Flatten the function body back into a list.
+ */
+
+#ifndef _H_cfg
+#define _H_cfg
+
+#include <list>
+#include <vector>
+#include "tac.h"
+
+class Loop;
+
+class BasicBlock {
+  public:
+    int id;                           // position in layout order
+    std::list<Instruction*> code;
+    std::vector<BasicBlock*> preds, succs;
+    BasicBlock *idom;                 // NULL for entry and unreachable blocks
+    std::vector<BasicBlock*> domChildren;
+    std::vector<BasicBlock*> frontier;
+    Loop *loop;                       // innermost loop containing the block
+    bool reachable;
+
+    BasicBlock(int n) : id(n), idom(NULL), loop(NULL), reachable(false) {}
+
+         // The label the block starts with, NULL if it has none
+    const char *GetLabel();
+
+         // The branch/jump/return ending the block, NULL if it just runs
+         // into the next block
+    Instruction *GetTerminator();
+
+         // Whether control can reach the next block in layout order
+    bool FallsThrough();
+};
+
+class Loop {
+  public:
+    BasicBlock *header;
+    std::vector<BasicBlock*> blocks;  // in layout order, header included
+    std::vector<BasicBlock*> exiting; // blocks with a successor outside
+    std::vector<bool> member;         // indexed by block id
+    Loop *parent;                     // next enclosing loop, NULL if outermost
+    int depth;                        // 1 for an outermost loop
+
+    Loop(BasicBlock *h) : header(h), parent(NULL), depth(1) {}
+    bool Contains(BasicBlock *b);
+};
+
+class FlowGraph {
+  private:
+    std::vector<BasicBlock*> blocks;
+    std::vector<BasicBlock*> rpo;     // reachable blocks, reverse postorder
+    std::vector<Loop*> loops;         // innermost first
+
+    void ComputeEdges();
+    void ComputeDominators();
+    void ComputeFrontiers();
+    void FindLoops();
+
+  public:
+         // Builds blocks from the instructions in [first, last)
+    FlowGraph(std::list<Instruction*>::iterator first,
+              std::list<Instruction*>::iterator last);
+    ~FlowGraph();
+
+         // Recomputes edges, dominators, frontiers and loops from the
+         // current contents of the blocks
+    void Analyze();
+
+    std::vector<BasicBlock*> &Blocks()          { return blocks; }
+    std::vector<BasicBlock*> &ReversePostorder() { return rpo; }
+    std::vector<Loop*> &Loops()                 { return loops; }
+    BasicBlock *Entry()                         { return blocks.front(); }
+
+    bool Dominates(BasicBlock *a, BasicBlock *b);
+    int LoopDepth(BasicBlock *b) { return b->loop ? b->loop->depth : 0; }
+
+         // Inserts a new empty block at layout position pos. The caller
+         // is responsible for how control reaches it; call Analyze after.
+    BasicBlock *InsertBlock(int pos);
+
+         // Returns the loop's preheader: the header's only predecessor
+         // outside the loop, provided the header is its only successor.
+         // NULL if the loop has none.
+    BasicBlock *GetPreheader(Loop *loop);
+
+         // Gives every loop that lacks a preheader an empty one, where
+         // the header is entered by falling through. Reanalyzes the graph
+         // if anything was added, so earlier Loop pointers are invalid.
+    void AddPreheaders();
+
+         // Appends the instructions of all blocks, in layout order
+    void Flatten(std::list<Instruction*> &out);
+};
+
+#endif
@@ -0,0 +1,46 @@
+/* File: cha.cc
+ * ------------
+ * Implementation of class hierarchy analysis. Both questions are answered
+ * once per type (and method) and remembered, call sites on the same type
+ * are common.
+ */
+
+#include "cha.h"
+#include "ast_decl.h"
+#include <map>
+#include <string>
+#include <string.h>
+
+static std::map<std::string, List<ClassDecl*>*> possible;
+static std::map<std::string, const char*> unique;
+
+List<ClassDecl*> *PossibleClasses(const char *typeName)
+{
+  List<ClassDecl*> *&classes = possible[typeName];
+  if (classes) return classes;
+  classes = new List<ClassDecl*>;
+  const std::map<std::string, ClassDecl*> &all = ClassDecl::All();
+  std::map<std::string, ClassDecl*>::const_iterator it;
+  for (it = all.begin(); it != all.end(); ++it)
+    if (it->second->IsSubclassOf(typeName) || it->second->Implements(typeName))
+      classes->Append(it->second);
+  return classes;
+}
+
+const char *UniqueTarget(const char *typeName, const char *name)
+{
+  std::string key = std::string(typeName) + " " + name;
+  if (unique.count(key)) return unique[key];
+  List<ClassDecl*> *classes = PossibleClasses(typeName);
+  const char *target = NULL;
+  for (int i = 0; i < classes->NumElements(); i++) {
+    ClassDecl *cls = classes->Nth(i);
+    const char *label = cls->MethodLabel(cls->FindMember(name));
+    if (target && strcmp(target, label) != 0) {
+      target = NULL;
+      break;
+    }
+    target = label;
+  }
+  return unique[key] = target;
+}
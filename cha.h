@@ -0,0 +1,28 @@
+/* File: cha.h
+ * -----------
+ * Class hierarchy analysis. The whole program is compiled at once, so
+ * once every ClassDecl has been declared the set of classes an object of
+ * a given static type can belong to is known: the class itself and its
+ * subclasses, or for an interface every class implementing it (directly
+ * or through a superclass).
+ *
+ * A method call whose candidates all share one body (a leaf class, or a
+ * method no subclass overrides) needs no vtable lookup; Call::Emit turns
+ * it into a direct LCall of that body, which the inliner can then see.
+ */
+
+#ifndef _H_cha
+#define _H_cha
+
+#include "list.h"
+
+class ClassDecl;
+
+    // The classes an object of static type typeName may have at runtime
+List<ClassDecl*> *PossibleClasses(const char *typeName);
+
+    // The label of the only method body a call of "_name" on typeName can
+    // reach, or NULL when it depends on the object's class
+const char *UniqueTarget(const char *typeName, const char *name);
+
+#endif
@@ -10,13 +10,23 @@
 #include "tac.h"
 #include "mips.h"
 #include "symbol_table.h"
+#include "ast_type.h"
+#include "cfg.h"
+#include "licm.h"
+#include "bounds.h"
+#include "inline.h"
+#include "tacfile.h"
+#include "valnum.h"
+#include "ssa.h"
+#include "switch.h"
 
 Location* CodeGenerator::ThisPtr= new Location(fpRelative, 4, "this");
 int CodeGenerator::nextTempNum = 0;
+int CodeGenerator::nextLabelNum = 0;
 int CodeGenerator::fp = CodeGenerator::OffsetToFirstLocal;
 int CodeGenerator::gp = CodeGenerator::OffsetToFirstGlobal;
 
-CodeGenerator::CodeGenerator()
+CodeGenerator::CodeGenerator() : mips(NULL), tacFile(NULL)
 {
 
 }
@@ -30,27 +40,40 @@ Location *CodeGenerator::NewLabelWithCode() {
 
 char *CodeGenerator::NewLabel()
 {
-  static int nextLabelNum = 0;
-  char temp[10];
+  char temp[16];
   sprintf(temp, "_L%d", nextLabelNum++);
   return strdup(temp);
 }
 
 
-Location *CodeGenerator::GenTempVar()
+int CodeGenerator::SizeOf(Type *type)
 {
-  char temp[10];
+  return type == Type::doubleType ? DoubleSize : VarSize;
+}
+
+bool CodeGenerator::HoldsReference(Type *type)
+{
+  return type != Type::intType && type != Type::boolType
+      && type != Type::doubleType && type != Type::voidType;
+}
+
+Location *CodeGenerator::GenTempVar(Type *type)
+{
+  char temp[16];
   sprintf(temp, "_tmp%d", nextTempNum++);
   Segment current_segment = (SymbolTable::active->GetClassName())? fpRelative : gpRelative;
+  int size = SizeOf(type);
   Location * result;
   if(current_segment == fpRelative){
-    result = new Location(current_segment, fp, temp);
-    fp -= 4;
+    // a slot's offset is its lowest address, fp counts down
+    result = new Location(current_segment, fp - (size - VarSize), temp);
+    fp -= size;
   }
   else {
     result = new Location(current_segment, gp, temp);
-    gp += 4;
+    gp += size;
   }
+  if(type) result->SetType(type);
   /* pp5: need to create variable in proper location
      in stack frame for use as temporary. Until you
      do that, the assert below will always fail to remind
@@ -60,8 +83,12 @@ Location *CodeGenerator::GenTempVar()
   return result;
 }
 
-void CodeGenerator::ResetStackFrame() {
-  fp = OffsetToFirstLocal;
+void CodeGenerator::ResetStackFrame(int firstFreeOffset) {
+  fp = firstFreeOffset;
+}
+
+int CodeGenerator::FrameSize() {
+  return OffsetToFirstLocal - fp;
 }
 
 
@@ -69,6 +96,22 @@ Location *CodeGenerator::GenLoadConstant(int value)
 {
   Location *result = GenTempVar();
   code.push_back(new LoadConstant(result, value));
+  constants[result] = value;
+  return result;
+}
+
+bool CodeGenerator::IsConstant(Location *loc, int *value)
+{
+  std::map<Location*, int>::iterator found = constants.find(loc);
+  if (found == constants.end()) return false;
+  *value = found->second;
+  return true;
+}
+
+Location *CodeGenerator::GenLoadConstant(double value)
+{
+  Location *result = GenTempVar(Type::doubleType);
+  code.push_back(new LoadDoubleConstant(result, value));
   return result;
 }
 
@@ -93,13 +136,24 @@ void CodeGenerator::GenAssign(Location *dst, Location *src)
 }
 
 
-Location *CodeGenerator::GenLoad(Location *ref, int offset)
+Location *CodeGenerator::GenLoad(Location *ref, int offset, Type *type)
 {
-  Location *result = GenTempVar();
+  Location *result = GenTempVar(type);
   code.push_back(new Load(result, ref, offset));
   return result;
 }
 
+void CodeGenerator::GenBoundsCheck(Location *array, Location *index)
+{
+  code.push_back(new BoundsCheck(array, index));
+}
+
+void CodeGenerator::GenRuntimeError(const char *message)
+{
+  GenBuiltInCall(PrintString, GenLoadConstant(message));
+  GenBuiltInCall(Halt);
+}
+
 void CodeGenerator::GenStore(Location *dst,Location *src, int offset)
 {
   code.push_back(new Store(dst, src, offset));
@@ -109,8 +163,11 @@ void CodeGenerator::GenStore(Location *dst,Location *src, int offset)
 Location *CodeGenerator::GenBinaryOp(const char *opName, Location *op1,
                                      Location *op2)
 {
-  Location *result = GenTempVar();
-  code.push_back(new BinaryOp(BinaryOp::OpCodeForName(opName), result, op1, op2));
+  BinaryOp::OpCode opCode = BinaryOp::OpCodeForName(opName);
+  // arithmetic on doubles gives a double, comparisons always an int
+  bool isArith = opCode <= BinaryOp::Mod;
+  Location *result = GenTempVar(isArith && op1->IsDouble() ? Type::doubleType : NULL);
+  code.push_back(new BinaryOp(opCode, result, op1, op2));
   return result;
 }
 
@@ -125,6 +182,12 @@ void CodeGenerator::GenIfZ(Location *test, const char *label)
   code.push_back(new IfZ(test, label));
 }
 
+void CodeGenerator::GenIfCompare(IfCompare::RelOp relop, Location *op1,
+                                 Location *op2, const char *label)
+{
+  code.push_back(new IfCompare(relop, op1, op2, label));
+}
+
 void CodeGenerator::GenGoto(const char *label)
 {
   code.push_back(new Goto(label));
@@ -136,9 +199,9 @@ void CodeGenerator::GenReturn(Location *val)
 }
 
 
-BeginFunc *CodeGenerator::GenBeginFunc()
+BeginFunc *CodeGenerator::GenBeginFunc(bool isEntry)
 {
-  BeginFunc *result = new BeginFunc;
+  BeginFunc *result = new BeginFunc(isEntry);
   code.push_back(result);
   return result;
 }
@@ -146,6 +209,7 @@ BeginFunc *CodeGenerator::GenBeginFunc()
 void CodeGenerator::GenEndFunc()
 {
   code.push_back(new EndFunc());
+  if (IsDebugOn("stream")) FlushCode();
 }
 
 void CodeGenerator::GenPushParam(Location *param)
@@ -160,16 +224,18 @@ void CodeGenerator::GenPopParams(int numBytesOfParams)
     code.push_back(new PopParams(numBytesOfParams));
 }
 
-Location *CodeGenerator::GenLCall(const char *label, bool fnHasReturnValue)
+Location *CodeGenerator::GenLCall(const char *label, bool fnHasReturnValue,
+                                  Type *returnType)
 {
-  Location *result = fnHasReturnValue ? GenTempVar() : NULL;
+  Location *result = fnHasReturnValue ? GenTempVar(returnType) : NULL;
   code.push_back(new LCall(label, result));
   return result;
 }
 
-Location *CodeGenerator::GenACall(Location *fnAddr, bool fnHasReturnValue)
+Location *CodeGenerator::GenACall(Location *fnAddr, bool fnHasReturnValue,
+                                  Type *returnType)
 {
-  Location *result = fnHasReturnValue ? GenTempVar() : NULL;
+  Location *result = fnHasReturnValue ? GenTempVar(returnType) : NULL;
   code.push_back(new ACall(fnAddr, result));
   return result;
 }
@@ -187,6 +253,8 @@ static struct _builtin {
    {"_PrintInt", 1, false},
    {"_PrintString", 1, false},
    {"_PrintBool", 1, false},
+   {"_PrintDouble", 1, false},
+   {"_Print", -1, false},       // any number, see GenPrint
    {"_Halt", 0, false}};
 
 Location *CodeGenerator::GenBuiltInCall(BuiltIn bn,Location *arg1, Location *arg2)
@@ -194,19 +262,122 @@ Location *CodeGenerator::GenBuiltInCall(BuiltIn bn,Location *arg1, Location *arg
   Assert(bn >= 0 && bn < NumBuiltIns);
   struct _builtin *b = &builtins[bn];
   Location *result = NULL;
+  int bytes;
+  if (bn == Alloc && IsConstant(arg1, &bytes) && bytes >= 0 && bytes <= MaxInlineAlloc)
+    return GenInlineAlloc(arg1, bytes, 0);
 
   if (b->hasReturn) result = GenTempVar();
   // verify appropriate number of non-NULL arguments given
   Assert((b->numArgs == 0 && !arg1 && !arg2)
          || (b->numArgs == 1 && arg1 && !arg2)
          || (b->numArgs == 2 && arg1 && arg2));
-  if (arg2) code.push_back(new PushParam(arg2));
-  if (arg1) code.push_back(new PushParam(arg1));
+  int paramBytes = 0;
+  if (arg2) {
+    code.push_back(new PushParam(arg2));
+    paramBytes += SizeOf(arg2->GetType());
+  }
+  if (arg1) {
+    code.push_back(new PushParam(arg1));
+    paramBytes += SizeOf(arg1->GetType());
+  }
   code.push_back(new LCall(b->label, result));
-  GenPopParams(VarSize*b->numArgs);
+  GenPopParams(paramBytes);
+  return result;
+}
+
+void CodeGenerator::GenPrint(const char *format, List<Location*> *values)
+{
+  Assert((int)strlen(format) == values->NumElements());
+  char *quoted = (char *)malloc(strlen(format) + 3);
+  sprintf(quoted, "\"%s\"", format);
+  Location *fmt = GenLoadConstant(quoted);
+  int paramBytes = VarSize;
+  for (int i = values->NumElements() - 1; i >= 0; i--) {
+    code.push_back(new PushParam(values->Nth(i)));
+    paramBytes += format[i] == 'd' ? DoubleSize : VarSize;
+  }
+  code.push_back(new PushParam(fmt));
+  code.push_back(new LCall(builtins[Print].label, NULL));
+  GenPopParams(paramBytes);
+}
+
+Location *CodeGenerator::GenArrayBytes(Location *length, int elemSize,
+                                       Location *wordSize)
+{
+  int n;
+  if (IsConstant(length, &n) && n > 0 && n <= MaxArrayLength(elemSize))
+    return GenLoadConstant(n * elemSize + VarSize);
+  Location *elemBytes = GenBinaryOp("*", length, GenLoadConstant(elemSize));
+  return GenBinaryOp("+", elemBytes, wordSize);
+}
+
+Location *CodeGenerator::GenAlloc(Location *bytes, bool holdsReferences)
+{
+  int flags = holdsReferences ? 0 : NoScanFlag;
+  int n;
+  if (IsConstant(bytes, &n) && n >= 0 && n <= MaxInlineAlloc)
+    return GenInlineAlloc(bytes, n, flags);
+  Location *result = GenBuiltInCall(Alloc, bytes);
+  if (flags) {
+    Location *header = GenLoad(result, -VarSize);
+    GenStore(result, GenBinaryOp("+", header, GenLoadConstant(flags)), -VarSize);
+  }
+  return result;
+}
+
+static const char *HeapNextLabel = "_heap_next";
+
+/* Method: GenInlineAlloc
+ * ----------------------
+ * The bump-pointer fast path of _Alloc (see defs.asm) for a request of
+ * a known number of bytes: take the block from _heap_next if it fits
+ * below _heap_end (the word after it), write its size header (plus
+ * flags) and skip past it. Otherwise fall back to calling _Alloc, which
+ * reuses a free block, collects or gets a new chunk.
+ */
+Location *CodeGenerator::GenInlineAlloc(Location *size, int bytes, int flags)
+{
+  int blockSize = (bytes + 2*VarSize - 1) & ~(VarSize - 1);
+  Location *result = GenTempVar();
+  char *slow = NewLabel(), *done = NewLabel();
+
+  Location *heapNext = GenLoadLabel(HeapNextLabel);
+  Location *block = GenLoad(heapNext);
+  Location *blockBytes = GenLoadConstant(blockSize);
+  Location *after = GenBinaryOp("+", block, blockBytes);
+  Location *heapEnd = GenLoad(heapNext, VarSize);
+  GenIfCompare(IfCompare::Greater, after, heapEnd, slow);
+  GenStore(heapNext, after);
+  GenStore(block, flags ? GenLoadConstant(blockSize + flags) : blockBytes);
+  GenAssign(result, GenBinaryOp("+", block, GenLoadConstant(VarSize)));
+  GenGoto(done);
+
+  GenLabel(slow);
+  code.push_back(new PushParam(size));
+  Location *called = GenTempVar();
+  code.push_back(new LCall(builtins[Alloc].label, called));
+  GenPopParams(VarSize);
+  if (flags) {
+    Location *header = GenLoad(called, -VarSize);
+    GenStore(called, GenBinaryOp("+", header, GenLoadConstant(flags)), -VarSize);
+  }
+  GenAssign(result, called);
+  GenLabel(done);
   return result;
 }
 
+bool CodeGenerator::IsBuiltIn(const char *label)
+{
+  for (int i = 0; i < NumBuiltIns; i++)
+    if (strcmp(builtins[i].label, label) == 0) return true;
+  return false;
+}
+
+bool CodeGenerator::IsRuntimeLabel(const char *label)
+{
+  return IsBuiltIn(label) || strcmp(label, HeapNextLabel) == 0;
+}
+
 
 void CodeGenerator::GenVTable(const char *className, List<const char *> *methodLabels)
 {
@@ -214,20 +385,102 @@ void CodeGenerator::GenVTable(const char *className, List<const char *> *methodL
 }
 
 
-void CodeGenerator::DoFinalCodeGen()
+/* Method: Optimize
+ * ----------------
+ * Inlines calls across the whole program, then builds a flow graph for
+ * the body of each function (the instructions between BeginFunc and
+ * EndFunc), runs the passes over it (in SSA form first), and splices
+ * the result back in place of the original body.
+ */
+void CodeGenerator::Optimize()
 {
+  if (!IsDebugOn("noinline") && !IsDebugOn("stream")) InlineCalls(this, code);
+  std::list<Instruction*>::iterator p = code.begin();
+  while (p != code.end()) {
+    if (!dynamic_cast<BeginFunc*>(*p)) {
+      ++p;
+      continue;
+    }
+    BeginFunc *func = dynamic_cast<BeginFunc*>(*p);
+    std::list<Instruction*>::iterator first = ++p, end = first;
+    while (!dynamic_cast<EndFunc*>(*end)) ++end;
+
+    FlowGraph graph(first, end);
+    if (!IsDebugOn("nossa")) OptimizeSSA(&graph, func, this);
+    HoistLoopInvariants(&graph);
+    EliminateBoundsChecks(&graph);
+    NumberValues(&graph);
+    LowerSwitches(&graph, this);
+
+    std::list<Instruction*> body;
+    graph.Flatten(body);
+    code.erase(first, end);
+    code.splice(end, body);
+    p = ++end;
+  }
+}
+
+void CodeGenerator::EmitCode()
+{
+  std::list<Instruction*>::iterator p;
   if (IsDebugOn("tac")) { // if debug don't translate to mips, just print Tac
-    std::list<Instruction*>::iterator p;
     for (p= code.begin(); p != code.end(); ++p) {
       (*p)->Print();
     }
-  }  else {
-    Mips mips;
-    mips.EmitPreamble();
-
-    std::list<Instruction*>::iterator p;
+  } else if (IsDebugOn("tacfile")) {
+    for (p= code.begin(); p != code.end(); ++p)
+      GetTacWriter()->Append(*p);
+  } else {
+    GetMips();
     for (p= code.begin(); p != code.end(); ++p) {
-      (*p)->Emit(&mips);
+      (*p)->Emit(mips);
     }
   }
+  for (p= code.begin(); p != code.end(); ++p)
+    delete *p;
+  code.clear();
+  constants.clear();    // its temps are all gone
+}
+
+void CodeGenerator::FlushCode()
+{
+  if (!IsDebugOn("noopt")) Optimize();
+  EmitCode();
+}
+
+Mips *CodeGenerator::GetMips()
+{
+  if (!mips) {
+    mips = new Mips;
+    mips->EmitPreamble();
+  }
+  return mips;
+}
+
+TacWriter *CodeGenerator::GetTacWriter()
+{
+  if (!tacFile) tacFile = new TacWriter;
+  return tacFile;
+}
+
+void CodeGenerator::DoFinalCodeGen()
+{
+  FlushCode();
+  if (IsDebugOn("tac")) return;
+
+  SymbolTable *globals = SymbolTable::active;
+  while (globals->GetParent()) globals = globals->GetParent();
+  List<int> roots;
+  std::list<Location*>::const_iterator g;
+  for (g = globals->GetSymbols().begin(); g != globals->GetSymbols().end(); ++g)
+    if (HoldsReference((*g)->GetType())) roots.Append((*g)->GetOffset());
+  if (IsDebugOn("tacfile")) {
+    GetTacWriter()->SetRoots(&roots);
+    GetTacWriter()->Write(stdout);
+    return;
+  }
+  mips->EmitGcRoots(&roots);
+  mips->EmitStringPool();
+  mips->EmitDoublePool();
+  mips->EmitJumpTables();
 }
@@ -14,21 +14,47 @@
 #ifndef _H_codegen
 #define _H_codegen
 
+#include <climits>
 #include <cstdlib>
 #include <list>
+#include <map>
 #include "tac.h"
 
+class TacWriter;
 
 
               // These codes are used to identify the built-in functions
 typedef enum { Alloc, ReadLine, ReadInteger, StringEqual,
-               PrintInt, PrintString, PrintBool, Halt, NumBuiltIns } BuiltIn;
+               PrintInt, PrintString, PrintBool, PrintDouble, Print, Halt,
+               NumBuiltIns } BuiltIn;
 
 class CodeGenerator {
   private:
     std::list<Instruction*> code;
     //SymbolTree symbols;
 
+         // Integer constants loaded into temps so far, by temp. A temp
+         // written by LoadConstant is never reassigned, so this is what
+         // it holds everywhere.
+    std::map<Location*, int> constants;
+    bool IsConstant(Location *loc, int *value);
+
+         // Allocations of at most this many bytes with a size known at
+         // compile time bump the heap pointer inline (see GenInlineAlloc)
+    static const int MaxInlineAlloc = 256;
+    Location *GenInlineAlloc(Location *size, int bytes, int flags);
+
+         // Runs the Tac optimization passes over each function body
+    void Optimize();
+         // Translates the instructions in code (or prints them, under
+         // -d tac) and deletes them. The Mips object lives from the
+         // first call to the end, it collects the string constants.
+    Mips *mips;
+    void EmitCode();
+         // Under -d tacfile the instructions go here instead, to be
+         // written out as a Tac file (see tacfile.h) by DoFinalCodeGen
+    TacWriter *tacFile;
+
   public:
            // Here are some class constants to remind you of the offsets
            // used for globals, locals, and parameters. You will be
@@ -39,17 +65,34 @@ class CodeGenerator {
            // "this" passed in first param slot at fp+4, all normal params
            // are shifted up by 4.)  First global is at offset 0 from global
            // pointer, all subsequent at +4, +8, etc.
-           // Conveniently, all vars are 4 bytes in size for code generation
+           // All vars are 4 bytes in size for code generation except
+           // doubles, which take 8. A Location's offset is the lowest
+           // address of its slot, so a double local declared first is
+           // at fp-12 (covering fp-12 to fp-5).
     static const int OffsetToFirstLocal = -8,
                      OffsetToFirstParam = 4,
                      OffsetToFirstGlobal = 0;
 
     static int fp, gp;
 
-    static const int VarSize = 4;
+    static const int VarSize = 4,
+                     DoubleSize = 8;
+
+         // Bytes of storage for a value of type (NULL is a plain word)
+    static int SizeOf(Type *type);
+         // The longest array of elemSize-byte elements whose size in bytes,
+         // length word included, still fits in an int
+    static int MaxArrayLength(int elemSize) { return (INT_MAX - VarSize) / elemSize; }
+
+         // Whether a value of type may be a reference into the heap, which
+         // the garbage collector in defs.asm must follow
+    static bool HoldsReference(Type *type);
+
+         // Heap block header flag (see defs.asm): no references inside
+    static const int NoScanFlag = 2;
 
     static Location* ThisPtr;
-    static int nextTempNum;
+    static int nextTempNum, nextLabelNum;
 
     CodeGenerator();
 
@@ -62,10 +105,16 @@ class CodeGenerator {
 
 
          // Creates and returns a Location for a new uniquely named
-         // temp variable. Does not generate any Tac instructions
-    Location *GenTempVar();
+         // temp variable, sized for type (a word if NULL). Does not
+         // generate any Tac instructions
+    Location *GenTempVar(Type *type = NULL);
 
-    static void ResetStackFrame();
+         // Starts temp allocation for a new function frame. Locals are
+         // given their slots when declared, so temps begin at the first
+         // offset the function's locals left free. FrameSize reports the
+         // bytes used so far, for backpatching BeginFunc.
+    static void ResetStackFrame(int firstFreeOffset = OffsetToFirstLocal);
+    static int FrameSize();
 
          // Generates Tac instructions to load a constant value. Creates
          // a new temp var to hold the result. The constant
@@ -77,6 +126,7 @@ class CodeGenerator {
          // Each of the methods returns a Location for the temp var
          // where the constant was loaded.
     Location *GenLoadConstant(int value);
+    Location *GenLoadConstant(double value);
     Location *GenLoadConstant(const char *str);
     Location *GenLoadLabel(const char *label);
 
@@ -97,8 +147,17 @@ class CodeGenerator {
          // field offset calculation). Returns the Location for the new
          // temporary variable where the result was stored. The optional
          // offset argument can be used to offset the addr by a positive or
-         // negative number of bytes. If not given, 0 is assumed.
-    Location *GenLoad(Location *addr, int offset = 0);
+         // negative number of bytes. If not given, 0 is assumed. type
+         // is that of the value loaded, when it isn't a plain word.
+    Location *GenLoad(Location *addr, int offset = 0, Type *type = NULL);
+
+         // Generates the Tac instruction that halts with a runtime error
+         // unless 0 <= index < the length of array (stored in the word
+         // before array's first element).
+    void GenBoundsCheck(Location *array, Location *index);
+
+         // Generates Tac instructions to print message and halt.
+    void GenRuntimeError(const char *message);
 
 
          // Generates Tac instructions to perform one of the binary ops
@@ -126,14 +185,16 @@ class CodeGenerator {
          // true,  a new temp var is created, the fn result is stored
          // there and that Location is returned. If false, no temp is
          // created and NULL is returned
-    Location *GenLCall(const char *label, bool fnHasReturnValue);
+    Location *GenLCall(const char *label, bool fnHasReturnValue,
+                       Type *returnType = NULL);
 
          // Generates the Tac instructions for ACall, a jump to an
          // address computed at runtime. Works similarly to LCall,
          // described above, in terms of return type.
          // The fnAddr Location is expected to hold the address of
          // the code to jump to (typically it was read from the vtable)
-    Location *GenACall(Location *fnAddr, bool fnHasReturnValue);
+    Location *GenACall(Location *fnAddr, bool fnHasReturnValue,
+                       Type *returnType = NULL);
 
          // Generates the Tac instructions to call one of
          // the built-in functions (Read, Print, Alloc, etc.) Although
@@ -143,24 +204,58 @@ class CodeGenerator {
          // fewer than 2 args to pass. The method returns a Location
          // for the new temp var holding the result.  For those
          // built-ins with no return value (Print/Halt), no temporary
-         // is created and NULL is returned.
+         // is created and NULL is returned. _Alloc of a constant size
+         // gets the allocator's fast path inline.
     Location *GenBuiltInCall(BuiltIn b, Location *arg1 = NULL, Location *arg2 = NULL);
 
+         // Generates one call to the runtime's _Print for all the values
+         // of a Print statement. format has a letter per value: i for
+         // int or bool, s for string, d for double.
+    void GenPrint(const char *format, List<Location*> *values);
+
+         // Allocates bytes on the heap like GenBuiltInCall(Alloc, bytes),
+         // additionally telling the collector not to scan the block when
+         // it can't hold references (arrays of int, bool or double).
+    Location *GenAlloc(Location *bytes, bool holdsReferences = true);
+
+         // The bytes NewArray allocates for length elements of elemSize
+         // bytes and the length word (wordSize holds VarSize) in front of
+         // them. A constant length from 1 to MaxArrayLength gives a
+         // constant, so GenAlloc can allocate the array inline.
+    Location *GenArrayBytes(Location *length, int elemSize, Location *wordSize);
+
+         // Whether label names one of the built-in functions. Builtins
+         // never touch program variables or objects, which the
+         // optimizer relies on when deciding what a call may change.
+    static bool IsBuiltIn(const char *label);
+         // Whether label is defined by the runtime in defs.asm: the
+         // built-in functions and the heap pointer of the inline allocator
+    static bool IsRuntimeLabel(const char *label);
+
 
          // These methods generate the Tac instructions for various
          // control flow (branches, jumps, returns, labels)
+         // GenIfCompare branches when "op1 relop op2" holds, which lets
+         // a condition branch directly without a 0/1 temp.
          // One minor detail to mention is that you can pass NULL
          // (or omit arg) to GenReturn for a return that does not
          // return a value
     void GenIfZ(Location *test, const char *label);
+    void GenIfCompare(IfCompare::RelOp relop, Location *op1, Location *op2,
+                      const char *label);
     void GenGoto(const char *label);
     void GenReturn(Location *val = NULL);
     void GenLabel(const char *label);
 
 
          // These methods generate the Tac instructions that mark the start
-         // and end of a function/method definition.
-    BeginFunc *GenBeginFunc();
+         // and end of a function/method definition. isEntry marks the
+         // program's entry point, main. With -d stream, GenEndFunc
+         // optimizes and emits the function (and anything generated
+         // before it) right away and frees its Tac, so the Tac held at
+         // any time is about one function's worth. Functions are not
+         // inlined into each other in that mode.
+    BeginFunc *GenBeginFunc(bool isEntry = false);
     void GenEndFunc();
 
 
@@ -179,6 +274,16 @@ class CodeGenerator {
          // but instead just print the untranslated Tac. It may be
          // useful in debugging to first make sure your Tac is correct.
     void DoFinalCodeGen();
+
+         // Optimizes and emits everything generated so far, as
+         // GenEndFunc does under -d stream. The compilation cache calls
+         // it after each declaration to capture all of its code.
+    void FlushCode();
+         // The Mips object, created (and the preamble emitted) on the
+         // first call
+    Mips *GetMips();
+         // Where the code goes under -d tacfile, created on the first call
+    TacWriter *GetTacWriter();
 };
 
 #endif
@@ -1,11 +1,13 @@
+# Output is buffered: the print routines append to _out_buf, which is
+# written out with one syscall when it fills up, every 64 lines, before
+# reading input, at _Halt and when main returns (_FlushOutput).
 _PrintInt:
         subu $sp, $sp, 8
         sw $fp, 8($sp)
         sw $ra, 4($sp)
         addiu $fp, $sp, 8
-        li   $v0, 1
-        lw   $a0, 4($fp)
-        syscall
+        lw $a0, 4($fp)
+        jal out_int
         move $sp, $fp
         lw $ra, -4($fp)
         lw $fp, 0($fp)
@@ -16,107 +18,650 @@ _PrintString:
         sw $fp, 8($sp)
         sw $ra, 4($sp)
         addiu $fp, $sp, 8
-        li   $v0, 4
         lw $a0, 4($fp)
-        syscall
+        jal out_str
         move $sp, $fp
         lw $ra, -4($fp)
         lw $fp, 0($fp)
         jr $ra
         
+_PrintDouble:
+        subu $sp, $sp, 8
+        sw $fp, 8($sp)
+        sw $ra, 4($sp)
+        addiu $fp, $sp, 8
+        jal _FlushOutput        # formatted by the syscall, so keep order
+        li   $v0, 3
+        lwc1 $f12, 4($fp)       # the param is only word aligned,
+        lwc1 $f13, 8($fp)       # so load it a half at a time
+        syscall
+        move $sp, $fp
+        lw $ra, -4($fp)
+        lw $fp, 0($fp)
+        jr $ra
+
 _PrintBool:
 	subu $sp, $sp, 8
 	sw $fp, 8($sp)
 	sw $ra, 4($sp)
         addiu $fp, $sp, 8
 	lw $t1, 4($fp)
-	blez $t1, fbr
-	li   $v0, 4		# system call for print_str
-	la   $a0, TRUE		# address of str to print
-	syscall			
-	b end
-fbr:	li   $v0, 4		# system call for print_str
-	la   $a0, FALSE		# address of str to print
-	syscall				
-end:	move $sp, $fp
+	la   $a0, TRUE
+	bgtz $t1, pbool
+	la   $a0, FALSE
+pbool:	jal out_str
+	move $sp, $fp
 	lw $ra, -4($fp)
 	lw $fp, 0($fp)
 	jr $ra
 
+# _Print(format, args...) prints all the values of one Print statement.
+# format has a letter per value: i for int (and bool, printed as 0/1),
+# s for string, d for double (which takes two words of the arguments).
+_Print:
+        subu $sp, $sp, 8
+        sw $fp, 8($sp)
+        sw $ra, 4($sp)
+        addiu $fp, $sp, 8
+        subu $sp, $sp, 8
+        sw $s0, -8($fp)
+        sw $s1, -12($fp)
+        lw $s0, 4($fp)          # format
+        addiu $s1, $fp, 8       # next argument
+print_next:
+        lbu $t0, 0($s0)
+        addiu $s0, $s0, 1
+        beqz $t0, print_done
+        beq $t0, 115, print_str # 's'
+        beq $t0, 100, print_dbl # 'd'
+        lw $a0, 0($s1)
+        addiu $s1, $s1, 4
+        jal out_int
+        b print_next
+print_str:
+        lw $a0, 0($s1)
+        addiu $s1, $s1, 4
+        jal out_str
+        b print_next
+print_dbl:
+        jal _FlushOutput
+        lwc1 $f12, 0($s1)
+        lwc1 $f13, 4($s1)
+        addiu $s1, $s1, 8
+        li $v0, 3
+        syscall
+        b print_next
+print_done:
+        lw $s0, -8($fp)
+        lw $s1, -12($fp)
+        move $sp, $fp
+        lw $ra, -4($fp)
+        lw $fp, 0($fp)
+        jr $ra
+
+out_int:                        # appends $a0 in decimal (uses $t8 for $ra)
+        move $t8, $ra
+        la $t2, _out_digits
+        addiu $t2, $t2, 11
+        sb $zero, 0($t2)
+        move $t1, $a0
+        bgez $t1, out_digit
+        negu $t1, $t1           # -2^31 too, read as unsigned
+out_digit:
+        remu $t4, $t1, 10
+        divu $t1, $t1, 10
+        addiu $t4, $t4, 48
+        subu $t2, $t2, 1
+        sb $t4, 0($t2)
+        bnez $t1, out_digit
+        bgez $a0, out_num
+        li $t4, 45              # '-'
+        subu $t2, $t2, 1
+        sb $t4, 0($t2)
+out_num:
+        move $a0, $t2
+        jal out_str
+        jr $t8
+
+out_str:                        # appends the string at $a0 (uses $t9 for $ra)
+        move $t9, $ra
+        la $t2, _out_buf
+        lw $t1, _out_len
+out_char:
+        lbu $t0, 0($a0)
+        beqz $t0, out_end
+        addu $t3, $t2, $t1
+        sb $t0, 0($t3)
+        addiu $t1, $t1, 1
+        addiu $a0, $a0, 1
+        bne $t0, 10, out_room
+        lw $t3, _out_lines
+        addiu $t3, $t3, 1
+        sw $t3, _out_lines
+        bge $t3, 64, out_full
+out_room:
+        blt $t1, 4095, out_char
+out_full:
+        sw $t1, _out_len
+        jal _FlushOutput
+        li $t1, 0
+        b out_char
+out_end:
+        sw $t1, _out_len
+        jr $t9
+
+_FlushOutput:                   # writes out the buffer; only $v0, $v1 change
+        lw $v0, _out_len
+        beqz $v0, flush_end
+        move $v1, $a0
+        la $a0, _out_buf
+        addu $v0, $a0, $v0
+        sb $zero, 0($v0)
+        li $v0, 4
+        syscall
+        move $a0, $v1
+        sw $zero, _out_len
+        sw $zero, _out_lines
+flush_end:
+        jr $ra
+
+# Heap layout: every block starts with a header word holding the block's
+# size in bytes (header included, a multiple of 4), and _Alloc returns
+# the address just past the header. The two low bits of the header are
+# flags: bit 0 is the collector's mark, bit 1 says the block holds no
+# references (set by the compiler for arrays of int, bool and double).
+# Blocks are carved from big chunks obtained with sbrk by bumping
+# _heap_next towards _heap_end; the compiler inlines that fast path for
+# allocations of constant size, so the two words must stay adjacent.
+# Free blocks (from _Free or the collector) go on a list per size in
+# words up to 16, or on one list of larger blocks that are split to fit,
+# and are handed out again, zeroed, before bumping. When the chunk is
+# full and the heap is at least twice what survived the last collection,
+# _GcCollect runs before the heap is grown.
 _Alloc:
         subu $sp, $sp, 8
         sw $fp, 8($sp)
         sw $ra, 4($sp)
         addiu $fp, $sp, 8
-        li   $v0, 9
-        lw $a0, 4($fp)
-	syscall
+        subu $sp, $sp, 4
+        sw $zero, -8($fp)       # set once we've collected
+alloc_retry:
+        lw $a0, 4($fp)          # bytes requested
+        addiu $a0, $a0, 7       # plus header, rounded up to a word
+        li $t0, -4
+        and $a0, $a0, $t0
+
+        srl $t0, $a0, 2         # size class = block size in words
+        bgt $t0, 16, alloc_big
+        sll $t0, $t0, 2
+        la $t1, _free_lists
+        addu $t1, $t1, $t0
+        lw $v0, 0($t1)          # a free block of this size?
+        beqz $v0, alloc_big
+        lw $t2, 4($v0)          # unlink it (link is the first user word)
+        sw $t2, 0($t1)
+        b alloc_clear
+
+alloc_big:                      # first fit among the larger free blocks
+        la $t1, _free_lists
+        addiu $t1, $t1, 68
+alloc_bloop:
+        lw $v0, 0($t1)
+        beqz $v0, alloc_bump
+        lw $t2, 0($v0)
+        bgeu $t2, $a0, alloc_fit
+        addiu $t1, $v0, 4
+        b alloc_bloop
+alloc_fit:
+        lw $t3, 4($v0)          # unlink it
+        sw $t3, 0($t1)
+        subu $t3, $t2, $a0      # bytes left over
+        bge $t3, 8, alloc_split
+        move $a0, $t2           # too few to be a block, keep them
+        b alloc_clear
+alloc_split:                    # the rest goes back on its list
+        addu $t4, $v0, $a0
+        sw $t3, 0($t4)
+        srl $t5, $t3, 2
+        ble $t5, 16, alloc_rest
+        li $t5, 17
+alloc_rest:
+        sll $t5, $t5, 2
+        la $t6, _free_lists
+        addu $t6, $t6, $t5
+        lw $t7, 0($t6)
+        sw $t7, 4($t4)
+        sw $t4, 0($t6)
+alloc_clear:                    # zero the user words of a reused block
+        addu $t2, $v0, $a0
+        addiu $t3, $v0, 4
+alloc_zero:
+        bgeu $t3, $t2, alloc_header
+        sw $zero, 0($t3)
+        addiu $t3, $t3, 4
+        b alloc_zero
+
+alloc_bump:
+        lw $v0, _heap_next
+        lw $t1, _heap_end
+        addu $t2, $v0, $a0
+        bgtu $t2, $t1, alloc_chunk
+alloc_take:
+        sw $t2, _heap_next
+alloc_header:
+        sw $a0, 0($v0)          # header: block size
+        addiu $v0, $v0, 4
         move $sp, $fp
         lw $ra, -4($fp)
         lw $fp, 0($fp) 
         jr $ra
 
+alloc_chunk:                    # out of room: collect, or sbrk another chunk
+        lw $t0, -8($fp)
+        bnez $t0, alloc_grow
+        lw $t0, _heap_start
+        beqz $t0, alloc_grow
+        lw $t1, _heap_end
+        subu $t1, $t1, $t0
+        lw $t2, _gc_live
+        sll $t2, $t2, 1
+        bltu $t1, $t2, alloc_grow  # mostly live last time: grow instead
+        jal _GcCollect
+        li $t0, 1
+        sw $t0, -8($fp)
+        b alloc_retry
+alloc_grow:
+        move $t3, $a0
+        bge $t3, 65536, alloc_sbrk
+        li $t3, 65536
+alloc_sbrk:
+        move $t4, $a0
+        move $a0, $t3
+        li $v0, 9
+        syscall
+        move $a0, $t4
+        lw $t1, _heap_end
+        addu $t3, $v0, $t3
+        sw $t3, _heap_end
+        bnez $t1, alloc_more
+        sw $v0, _heap_start     # first chunk
+        b alloc_fresh
+alloc_more:
+        bne $v0, $t1, alloc_gap
+        lw $v0, _heap_next      # contiguous: just extend the old chunk
+        b alloc_fresh
+alloc_gap:                      # not contiguous: cover the old chunk's tail
+        lw $t2, _heap_next      # and the gap with a dead block so the heap
+        subu $t1, $v0, $t2      # stays walkable (header sizes chain through)
+        sw $t1, 0($t2)
+alloc_fresh:
+        addu $t2, $v0, $a0
+        b alloc_take
+
+_Free:                          # returns a block from _Alloc to its free list
+        subu $sp, $sp, 8
+        sw $fp, 8($sp)
+        sw $ra, 4($sp)
+        addiu $fp, $sp, 8
+        lw $t0, 4($fp)
+        subu $t0, $t0, 4        # block start
+        lw $t1, 0($t0)
+        li $t2, -4
+        and $t1, $t1, $t2       # drop the flags
+        sw $t1, 0($t0)
+        srl $t1, $t1, 2
+        ble $t1, 16, free_push
+        li $t1, 17
+free_push:
+        sll $t1, $t1, 2
+        la $t2, _free_lists
+        addu $t2, $t2, $t1
+        lw $t3, 0($t2)
+        sw $t3, 4($t0)
+        sw $t0, 0($t2)
+        move $sp, $fp
+        lw $ra, -4($fp)
+        lw $fp, 0($fp) 
+        jr $ra
+
+# Mark-sweep collection of the heap. The roots are the globals listed in
+# _gc_roots (a count, then the $gp offsets of the globals whose type can
+# hold a reference, emitted by the compiler) and every word of the stack
+# from $sp up to _stack_base, the frame of main. Stack words are taken
+# conservatively, since temps carry no type: a word is a reference if it
+# points just past the header of a block (an object) or past its length
+# word as well (an array). Marked blocks are scanned the same way unless
+# their header says they hold no references.
+# Block starts are found in a bitmap, one bit per heap word, rebuilt by
+# walking the heap at each collection. The bitmap itself is an unscanned
+# heap block, kept alive by the sweep; it is replaced by one twice the
+# size when the heap outgrows it. The mark
+# stack has a fixed size; blocks marked when it is full are picked up by
+# walking the heap for marked blocks once it empties.
+# Runs of dead blocks are merged and put on the free lists, and a run at
+# the end of the heap goes back to the bump region.
+#   $t4 _heap_start, $t5 bitmap, $t6/$t7 mark stack end/top,
+#   $t8 _heap_next, $t9 -4
+_GcCollect:
+        subu $sp, $sp, 8
+        sw $fp, 8($sp)
+        sw $ra, 4($sp)
+        addiu $fp, $sp, 8
+        lw $t0, _stack_base
+        beqz $t0, gc_done       # main hasn't recorded its frame
+        li $t9, -4
+        lw $t4, _heap_start
+        lw $t8, _heap_next
+
+        lw $t1, _heap_end       # bitmap bytes the heap needs now
+        subu $t1, $t1, $t4
+        srl $t1, $t1, 5
+        addiu $t1, $t1, 3
+        and $t1, $t1, $t9
+        lw $t6, _gc_bitmap
+        beqz $t6, gc_newmap
+        lw $t3, 0($t6)
+        and $t3, $t3, $t9
+        subu $t3, $t3, 4
+        bgeu $t3, $t1, gc_map
+gc_newmap:                      # a bigger one, at the end of the heap
+        sll $t1, $t1, 1
+        addiu $t1, $t1, 4
+        move $t2, $t8
+        addu $t8, $t8, $t1
+        lw $t3, _heap_end
+        bleu $t8, $t3, gc_place
+        subu $a0, $t8, $t3
+        li $v0, 9
+        syscall
+        bne $v0, $t3, gc_done   # not contiguous, give up this time
+        sw $t8, _heap_end
+gc_place:
+        sw $t8, _heap_next
+        ori $t1, $t1, 2
+        sw $t1, 0($t2)
+        sw $t2, _gc_bitmap
+        beqz $t6, gc_map
+        lw $t3, 0($t6)          # the old one is swept with the garbage
+        and $t3, $t3, $t9
+        sw $t3, 0($t6)
+
+gc_map:
+        lw $t5, _gc_bitmap
+        lw $t1, 0($t5)
+        and $t1, $t1, $t9
+        addu $t1, $t5, $t1
+        addiu $t5, $t5, 4
+        move $t0, $t5
+gc_clear:
+        bgeu $t0, $t1, gc_starts
+        sw $zero, 0($t0)
+        addiu $t0, $t0, 4
+        b gc_clear
+gc_starts:                      # set the bit of each block start
+        move $t0, $t4
+        li $t3, 1
+gc_start:
+        bgeu $t0, $t8, gc_roots
+        subu $t1, $t0, $t4
+        srl $t1, $t1, 2
+        srl $t2, $t1, 5
+        sll $t2, $t2, 2
+        addu $t2, $t5, $t2
+        lw $a0, 0($t2)
+        sllv $a1, $t3, $t1
+        or $a0, $a0, $a1
+        sw $a0, 0($t2)
+        lw $t1, 0($t0)
+        and $t1, $t1, $t9
+        addu $t0, $t0, $t1
+        b gc_start
+
+gc_roots:
+        la $t7, _gc_stack
+        addiu $t6, $t7, 1024
+        la $t0, _gc_roots
+        lw $t1, 0($t0)
+gc_globals:
+        beqz $t1, gc_stack
+        addiu $t0, $t0, 4
+        lw $t2, 0($t0)
+        addu $t2, $t2, $gp
+        lw $a0, 0($t2)
+        jal gc_consider
+        subu $t1, $t1, 1
+        b gc_globals
+gc_stack:
+        move $t0, $sp
+        lw $t1, _stack_base
+gc_words:
+        bgeu $t0, $t1, gc_trace
+        lw $a0, 0($t0)
+        jal gc_consider
+        addiu $t0, $t0, 4
+        b gc_words
+
+gc_trace:                       # scan the blocks on the mark stack
+        la $t2, _gc_stack
+        beq $t7, $t2, gc_rescan
+        subu $t7, $t7, 4
+        lw $t0, 0($t7)
+        jal gc_scan
+        b gc_trace
+gc_rescan:                      # some marked blocks didn't fit on the
+        lw $t0, _gc_overflowed  # stack: scan all marked blocks again
+        beqz $t0, gc_sweep
+        sw $zero, _gc_overflowed
+        move $t2, $t4
+gc_rewalk:
+        bgeu $t2, $t8, gc_trace
+        lw $t0, 0($t2)
+        and $t1, $t0, $t9
+        andi $a0, $t0, 1
+        move $t0, $t2
+        addu $t2, $t2, $t1
+        beqz $a0, gc_rewalk
+        jal gc_scan
+        b gc_rewalk
+
+gc_sweep:
+        lw $t0, _gc_bitmap      # the bitmap survives
+        lw $t1, 0($t0)
+        ori $t1, $t1, 1
+        sw $t1, 0($t0)
+        la $t0, _free_lists     # the lists are rebuilt from scratch
+        addiu $t1, $t0, 72
+gc_unlist:
+        sw $zero, 0($t0)
+        addiu $t0, $t0, 4
+        bltu $t0, $t1, gc_unlist
+        move $t0, $t4
+        li $t3, 0               # start of the current run of dead blocks
+        li $t5, 0               # live bytes
+gc_block:
+        bgeu $t0, $t8, gc_tail
+        lw $t1, 0($t0)
+        and $t2, $t1, $t9
+        andi $a0, $t1, 1
+        beqz $a0, gc_dead
+        addu $t5, $t5, $t2
+        xori $t1, $t1, 1        # live: unmark
+        sw $t1, 0($t0)
+        beqz $t3, gc_next
+        move $a0, $t3
+        subu $a1, $t0, $t3
+        jal gc_release
+        li $t3, 0
+        b gc_next
+gc_dead:
+        bnez $t3, gc_next
+        move $t3, $t0
+gc_next:
+        addu $t0, $t0, $t2
+        b gc_block
+gc_tail:
+        sw $t5, _gc_live
+        beqz $t3, gc_done
+        sw $t3, _heap_next      # dead run at the end: back to bumping,
+gc_zero:                        # which expects zeroed memory
+        bgeu $t3, $t8, gc_done
+        sw $zero, 0($t3)
+        addiu $t3, $t3, 4
+        b gc_zero
+gc_done:
+        move $sp, $fp
+        lw $ra, -4($fp)
+        lw $fp, 0($fp)
+        jr $ra
+
+gc_scan:                        # considers each word of the block at $t0
+        move $t3, $ra
+        lw $t1, 0($t0)
+        andi $a0, $t1, 2
+        bnez $a0, gc_scanned    # holds no references
+        and $t1, $t1, $t9
+        addu $t1, $t0, $t1
+        addiu $t0, $t0, 4
+gc_field:
+        bgeu $t0, $t1, gc_scanned
+        lw $a0, 0($t0)
+        jal gc_consider
+        addiu $t0, $t0, 4
+        b gc_field
+gc_scanned:
+        jr $t3
+
+gc_consider:                    # marks the block $a0 refers to, if any
+        andi $a1, $a0, 3
+        bnez $a1, gc_ret
+        li $a3, 4               # try 4 back (object), then 8 (array)
+gc_try:
+        subu $a0, $a0, 4
+        bltu $a0, $t4, gc_ret
+        bgeu $a0, $t8, gc_ret
+        subu $a1, $a0, $t4
+        srl $a1, $a1, 2
+        srl $a2, $a1, 5
+        sll $a2, $a2, 2
+        addu $a2, $t5, $a2
+        lw $a2, 0($a2)
+        srlv $a2, $a2, $a1
+        andi $a2, $a2, 1
+        bnez $a2, gc_found
+        addiu $a3, $a3, 4
+        ble $a3, 8, gc_try
+        jr $ra
+gc_found:
+        lw $v1, 0($a0)
+        andi $a2, $v1, 1
+        bnez $a2, gc_ret        # already marked
+        and $a2, $v1, $t9
+        bge $a3, $a2, gc_ret    # points past the end of the block
+        ori $v1, $v1, 1
+        sw $v1, 0($a0)
+        beq $t7, $t6, gc_full
+        sw $a0, 0($t7)
+        addiu $t7, $t7, 4
+        jr $ra
+gc_full:
+        li $a2, 1
+        sw $a2, _gc_overflowed
+gc_ret:
+        jr $ra
+
+gc_release:                     # puts the dead run at $a0, $a1 bytes long,
+        sw $a1, 0($a0)          # on its free list
+        srl $a2, $a1, 2
+        ble $a2, 1, gc_ret      # a lone header has no room for the link
+        ble $a2, 16, gc_list
+        li $a2, 17
+gc_list:
+        sll $a2, $a2, 2
+        la $a3, _free_lists
+        addu $a3, $a3, $a2
+        lw $v1, 0($a3)
+        sw $v1, 4($a0)
+        sw $a0, 0($a3)
+        jr $ra
 
 _StringEqual:
 	subu $sp, $sp, 8      # decrement sp to make space to save ra, fp
 	sw $fp, 8($sp)        # save fp
 	sw $ra, 4($sp)        # save ra
 	addiu $fp, $sp, 8     # set up new fp
-	subu $sp, $sp, 4      # decrement sp to make space for locals/temps
 
-	li $v0,0
-
-	#Determine length string 1
-	lw $t0, 4($fp)       
-	li $t3,0
-bloop1: 
-	lb $t5, ($t0) 
-	beqz $t5, eloop1	
-	addi $t0, 1
-	addi $t3, 1
-	b bloop1
-eloop1:
-
-	#Determine length string 2
-	lw $t1, 8($fp)
-	li $t4,0
-bloop2: 
-	lb $t5, ($t1) 
-	beqz $t5, eloop2	
-	addi $t1, 1
-	addi $t4, 1
-	b bloop2
-eloop2:
-	bne $t3,$t4,end1       #Check String Lengths Same
-
-	lw $t0, 4($fp)       
-	lw $t1, 8($fp)
-	li $t3, 0     		
-bloop3:	
-	lb $t5, ($t0) 
-	lb $t6, ($t1) 
-	bne $t5, $t6, end1
-	addi $t3, 1
-	addi $t0, 1
-	addi $t1, 1
-	bne $t3,$t4,bloop3
-eloop3:	li $v0,1
+	# One pass over both strings, stopping at the first difference or
+	# at the terminator. When the two start at the same offset within
+	# a word, compare a word at a time once aligned; an aligned lw never
+	# crosses into the next page, so reading past the terminator inside
+	# the last word is safe.
+	lw $t0, 4($fp)        # s1
+	lw $t1, 8($fp)        # s2
+	li $v0, 0
+	xor $t2, $t0, $t1
+	andi $t2, $t2, 3
+	bnez $t2, streq_bytes # different alignment, bytes only
+
+streq_head:               # bytes until s1 (and so s2) is word aligned
+	andi $t2, $t0, 3
+	beqz $t2, streq_words
+	lbu $t3, 0($t0)
+	lbu $t4, 0($t1)
+	bne $t3, $t4, streq_end
+	beqz $t3, streq_true
+	addiu $t0, $t0, 1
+	addiu $t1, $t1, 1
+	b streq_head
 
-end1:	move $sp, $fp         # pop callee frame off stack
+streq_words:
+	li $t5, 0x01010101
+	sll $t6, $t5, 7       # 0x80808080
+streq_wloop:
+	lw $t3, 0($t0)
+	lw $t4, 0($t1)
+	bne $t3, $t4, streq_bytes  # differs in this word, find where below
+	subu $t2, $t3, $t5    # (w - 0x01010101) & ~w & 0x80808080 is
+	nor $t7, $t3, $zero   # nonzero iff some byte of w is zero
+	and $t2, $t2, $t7
+	and $t2, $t2, $t6
+	addiu $t0, $t0, 4
+	addiu $t1, $t1, 4
+	beqz $t2, streq_wloop
+	b streq_true          # equal words holding the terminator
+
+streq_bytes:
+	lbu $t3, 0($t0)
+	lbu $t4, 0($t1)
+	addiu $t0, $t0, 1
+	addiu $t1, $t1, 1
+	bne $t3, $t4, streq_end
+	bnez $t3, streq_bytes
+
+streq_true:
+	li $v0, 1
+streq_end:
+	move $sp, $fp         # pop callee frame off stack
 	lw $ra, -4($fp)       # restore saved ra
 	lw $fp, 0($fp)        # restore saved fp
 	jr $ra                # return from function
 
 _Halt:
+        jal _FlushOutput
         li $v0, 10
         syscall
 
+_BoundsError:                   # reached from array subscript checks
+        la $a0, BOUNDS
+        jal out_str
+        b _Halt
+
 _ReadInteger:
 	subu $sp, $sp, 8      # decrement sp to make space to save ra, fp
 	sw $fp, 8($sp)        # save fp
 	sw $ra, 4($sp)        # save ra
 	addiu $fp, $sp, 8     # set up new fp
 	subu $sp, $sp, 4      # decrement sp to make space for locals/temps
+	jal _FlushOutput      # show any prompt first
 	li $v0, 5
 	syscall
 	move $sp, $fp         # pop callee frame off stack
@@ -131,6 +676,7 @@ _ReadLine:
 	sw $ra, 4($sp)        # save ra
 	addiu $fp, $sp, 8     # set up new fp
 	subu $sp, $sp, 4      # decrement sp to make space for locals/temps
+	jal _FlushOutput      # show any prompt first
 	li $a1, 40
 	la $a0, SPACE
 	li $v0, 8
@@ -155,6 +701,21 @@ eloop4:
 	
 
 	.data
+	.align 2
+_heap_start: .word 0
+_heap_next: .word 0
+_heap_end: .word 0
+_free_lists: .space 72          # heads by size in words (2..16), then >16
+_gc_live: .word 0               # bytes that survived the last collection
+_stack_base: .word 0            # $fp of main, stored on entry
+_gc_bitmap: .word 0             # block holding the block-start bitmap
+_gc_overflowed: .word 0         # set when the mark stack was full
+_gc_stack: .space 1024          # the mark stack
+_out_len: .word 0               # bytes waiting in _out_buf
+_out_lines: .word 0             # newlines among them
+_out_buf: .space 4096
+_out_digits: .space 12          # out_int builds numbers here
 TRUE:.asciiz "true"
 FALSE:.asciiz "false"
+BOUNDS:.asciiz "Decaf runtime error: Array subscript out of bounds\n"
 SPACE:.asciiz "Making Space For Inputed Values Is Fun."
@@ -11,6 +11,7 @@
 using namespace std;
 
 #include "scanner.h" // for GetLineNumbered
+#include "utility.h" // for the source files
 #include "ast_type.h"
 #include "ast_expr.h"
 #include "ast_stmt.h"
@@ -32,7 +33,13 @@ void ReportError::OutputError(yyltype *loc, string msg) {
     numErrors++;
     fflush(stdout); // make sure any buffered text has been output
     if (loc) {
-        cerr << endl << "*** Error line " << loc->first_line << "." << endl;
+        cerr << endl << "*** Error ";
+        if (NumSourceFiles() > 0) {
+            int file = SourceFileForLine(loc->first_line);
+            cerr << "in " << NthSourceFile(file) << " line "
+                 << loc->first_line - FirstLineOfSourceFile(file) + 1 << "." << endl;
+        } else
+            cerr << "line " << loc->first_line << "." << endl;
         UnderlineErrorInLine(GetLineNumbered(loc->first_line), loc);
     } else
         cerr << endl << "*** Error." << endl;
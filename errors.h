@@ -124,5 +124,6 @@ class ReportError
 // Wording to use for runtime error messages
 static const char *err_arr_out_of_bounds = "Decaf runtime error: Array subscript out of bounds\\n";
 static const char *err_arr_bad_size = "Decaf runtime error: Array size is <= 0\\n";
+static const char *err_no_implementation = "Decaf runtime error: Method called on an interface no class implements\\n";
 
 #endif
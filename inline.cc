@@ -0,0 +1,226 @@
+/* File: inline.cc
+ * ---------------
+ * Implementation of the inliner. Each function is known by the label in
+ * front of its BeginFunc; the BeginFunc and EndFunc themselves are never
+ * removed, so iterators to them stay valid while bodies are rewritten.
+ */
+
+#include "inline.h"
+#include "codegen.h"
+#include "cfg.h"
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::list<Instruction*>::iterator Iter;
+
+struct Function {
+  Iter begin, end;          // the BeginFunc and EndFunc
+  int originalSize;
+  int grown;                // instructions inlined into it so far
+  int selfInlined;
+};
+
+static int BodySize(Function *fn)
+{
+  int size = 0;
+  Iter p = fn->begin;
+  for (++p; p != fn->end; ++p)
+    if (!dynamic_cast<Label*>(*p)) size++;
+  return size;
+}
+
+static int ParamBytes(Location *param)
+{
+  return param->IsDouble() ? CodeGenerator::DoubleSize : CodeGenerator::VarSize;
+}
+
+
+class Inliner {
+  private:
+    CodeGenerator *gen;
+    std::list<Instruction*> &code;
+    std::map<std::string, Function> functions;
+
+    struct Site {
+      Iter call;
+      Function *callee;
+      int depth;            // loops around the call
+    };
+
+    void FindSites(Function *caller, std::vector<Site> &sites);
+    bool ShouldInline(Function *caller, Site &site, int calleeSize);
+    void InlineSite(Function *caller, Site &site);
+
+  public:
+    Inliner(CodeGenerator *g, std::list<Instruction*> &c);
+    bool Round();
+};
+
+Inliner::Inliner(CodeGenerator *g, std::list<Instruction*> &c) : gen(g), code(c)
+{
+  Label *label = NULL;
+  for (Iter p = code.begin(); p != code.end(); ++p) {
+    if (!dynamic_cast<BeginFunc*>(*p)) {
+      label = dynamic_cast<Label*>(*p);
+      continue;
+    }
+    Function fn;
+    fn.begin = p;
+    while (!dynamic_cast<EndFunc*>(*p)) ++p;
+    fn.end = p;
+    fn.grown = fn.selfInlined = 0;
+    fn.originalSize = BodySize(&fn);
+    if (label) functions[label->text()] = fn;
+    label = NULL;
+  }
+}
+
+void Inliner::FindSites(Function *caller, std::vector<Site> &sites)
+{
+  Iter first = caller->begin;
+  ++first;
+  FlowGraph graph(first, caller->end);
+  std::vector<BasicBlock*> &blocks = graph.Blocks();
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    std::list<Instruction*>::iterator p;
+    for (p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p) {
+      LCall *call = dynamic_cast<LCall*>(*p);
+      if (!call || !functions.count(call->GetLabel())) continue;
+      Site site;
+      site.callee = &functions[call->GetLabel()];
+      site.depth = blocks[i]->loop ? blocks[i]->loop->depth : 0;
+      sites.push_back(site);
+    }
+  }
+  // the graph holds copies of the instruction pointers, find them in the
+  // list itself (same order) to get iterators
+  int n = 0;
+  for (Iter p = first; p != caller->end && n < (int)sites.size(); ++p)
+    if (LCall *call = dynamic_cast<LCall*>(*p))
+      if (functions.count(call->GetLabel())) sites[n++].call = p;
+}
+
+bool Inliner::ShouldInline(Function *caller, Site &site, int calleeSize)
+{
+  if (site.callee == caller && caller->selfInlined >= InlineMaxRecursion)
+    return false;
+  int budget = caller->originalSize * InlineMaxGrowthPercent / 100;
+  if (budget < InlineMinGrowth) budget = InlineMinGrowth;
+  if (caller->grown + calleeSize > budget) return false;
+  return calleeSize <= InlineAlwaysSize || calleeSize <= InlineLoopSize * site.depth;
+}
+
+/* Method: InlineSite
+ * ------------------
+ * The pushes are the instructions right before the LCall: the last one
+ * pushed is the first parameter (at 4($fp) in the callee) and each one
+ * before it sits above the previous. The copy of the body is built in a
+ * separate list first, the callee may be the caller itself.
+ */
+void Inliner::InlineSite(Function *caller, Site &site)
+{
+  LCall *call = dynamic_cast<LCall*>(*site.call);
+  Iter pop = site.call;
+  ++pop;
+  PopParams *popParams = dynamic_cast<PopParams*>(*pop);
+  int bytes = popParams ? popParams->GetNumBytes() : 0;
+
+  std::map<int, Location*> actuals;   // by the callee's parameter offset
+  Iter firstPush = site.call;
+  int offset = CodeGenerator::OffsetToFirstParam;
+  while (bytes > 0) {
+    --firstPush;
+    PushParam *push = dynamic_cast<PushParam*>(*firstPush);
+    Assert(push);
+    actuals[offset] = push->GetSrc(0);
+    offset += ParamBytes(push->GetSrc(0));
+    bytes -= ParamBytes(push->GetSrc(0));
+  }
+
+  BeginFunc *begin = dynamic_cast<BeginFunc*>(*caller->begin);
+  CodeGenerator::ResetStackFrame(CodeGenerator::OffsetToFirstLocal - begin->GetFrameSize());
+
+  Iter first = site.callee->begin, last = site.callee->end;
+  ++first;
+  std::map<Location*, bool> assigned;
+  for (Iter p = first; p != last; ++p)
+    if ((*p)->GetDst()) assigned[(*p)->GetDst()] = true;
+
+  std::list<Instruction*> copy;
+  std::map<Location*, Location*> renamed;
+  std::map<std::string, const char*> labels;
+  for (Iter p = first; p != last; ++p)
+    if (Label *label = dynamic_cast<Label*>(*p))
+      labels[label->text()] = gen->NewLabel();
+  const char *done = gen->NewLabel();
+
+  for (Iter p = first; p != last; ++p) {
+    Instruction *instr = (*p)->Clone();
+    int numLocs = instr->NumSrcs() + 1;
+    for (int i = 0; i < numLocs; i++) {
+      Location *loc = (i == 0) ? instr->GetDst() : instr->GetSrc(i - 1);
+      if (!loc || loc->GetSegment() != fpRelative) continue;
+      Location *&to = renamed[loc];
+      if (!to && loc->GetOffset() > 0) {
+        Location *actual = actuals[loc->GetOffset()];
+        Assert(actual);
+        if (assigned[loc] || actual->GetSegment() == gpRelative) {
+          to = gen->GenTempVar(loc->GetType());
+          copy.push_front(new Assign(to, actual));
+        } else {
+          to = actual;
+        }
+      } else if (!to) {
+        to = gen->GenTempVar(loc->GetType());
+      }
+      if (i == 0) instr->SetDst(to);
+      else instr->SetSrc(i - 1, to);
+    }
+    if (Label *label = dynamic_cast<Label*>(instr))
+      label->SetText(labels[label->text()]);
+    else if (instr->branch_label())
+      instr->SetBranchLabel(labels[instr->branch_label()]);
+
+    if (Return *ret = dynamic_cast<Return*>(instr)) {
+      if (call->GetDst() && ret->NumSrcs())
+        copy.push_back(new Assign(call->GetDst(), ret->GetSrc(0)));
+      Iter next = p;
+      if (++next != last) copy.push_back(new Goto(done));
+      continue;
+    }
+    copy.push_back(instr);
+  }
+  copy.push_back(new Label(done));
+
+  begin->SetFrameSize(CodeGenerator::FrameSize());
+  if (site.callee == caller) caller->selfInlined++;
+  caller->grown += BodySize(site.callee);
+  code.erase(firstPush, popParams ? ++pop : pop);
+  code.splice(pop, copy);
+}
+
+bool Inliner::Round()
+{
+  bool changed = false;
+  std::map<std::string, Function>::iterator it;
+  for (it = functions.begin(); it != functions.end(); ++it) {
+    Function *caller = &it->second;
+    std::vector<Site> sites;
+    FindSites(caller, sites);
+    for (int i = 0; i < (int)sites.size(); i++) {
+      if (!ShouldInline(caller, sites[i], BodySize(sites[i].callee))) continue;
+      InlineSite(caller, sites[i]);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+
+void InlineCalls(CodeGenerator *gen, std::list<Instruction*> &code)
+{
+  Inliner inliner(gen, code);
+  for (int round = 0; round < InlineRounds; round++)
+    if (!inliner.Round()) break;
+}
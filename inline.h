@@ -0,0 +1,43 @@
+/* File: inline.h
+ * --------------
+ * Inlining of calls to the program's own functions and methods, done on
+ * the Tac of the whole program before the per-function passes.
+ *
+ * A call site "PushParam ... ; dst = LCall f ; PopParams n" is replaced
+ * by a copy of f's body between its BeginFunc and EndFunc. The copy gets
+ * fresh temps (in the caller's frame) for f's locals and temps, and fresh
+ * labels; each parameter becomes the pushed value, or a copy of it when
+ * f assigns to the parameter. A Return becomes an assignment to dst and
+ * a jump past the copy.
+ *
+ * The cost model compares the callee's size (its instructions, labels
+ * not counted) against a limit that grows with the loop depth of the
+ * call site, so small functions are inlined anywhere and larger ones only
+ * where they run often. The limits below bound the result:
+ */
+
+#ifndef _H_inline
+#define _H_inline
+
+#include <list>
+
+class Instruction;
+class CodeGenerator;
+
+    // a callee this small costs no more than the call sequence it replaces
+static const int InlineAlwaysSize = 12;
+    // a callee up to this size per level of loop nesting around the call
+static const int InlineLoopSize = 40;
+    // a caller may grow by this percent of its original size, or by
+    // InlineMinGrowth instructions when that is more
+static const int InlineMaxGrowthPercent = 100;
+static const int InlineMinGrowth = 60;
+    // calls copied in by one round are considered by the next, so this
+    // many rounds bounds how deep inlining nests
+static const int InlineRounds = 3;
+    // how many times a function may be inlined into its own body
+static const int InlineMaxRecursion = 0;
+
+void InlineCalls(CodeGenerator *gen, std::list<Instruction*> &code);
+
+#endif
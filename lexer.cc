@@ -0,0 +1,459 @@
+/* File: lexer.cc
+ * --------------
+ * A hand-written scanner that produces the same tokens, yylval values
+ * and yylloc positions as the flex scanner in scanner.l, including the
+ * same errors. Build with "make LEXER=hand" to use it in place of
+ * lex.yy.o.
+ *
+ * The whole input is read into one buffer with some zero bytes after it,
+ * so the scanner can look a few characters ahead (and the SSE2 loops can
+ * load 16 bytes at a time) without checking for the end; a '\0' before
+ * the end of the input is an unrecognized char, as it is for flex.
+ * Keywords (and true/false) are told from identifiers with one probe of
+ * a perfect hash table. Runs of spaces and the bodies of comments are
+ * skipped 16 bytes at a time where SSE2 is available.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scanner.h"
+#include "utility.h" // for PrintDebug()
+#include "errors.h"
+#include "parser.h" // for token codes, yylval
+#include "list.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TAB_SIZE 8
+#define PADDING 16
+
+char *yytext = (char *)"";      // only set for lexemes errors are reported on
+
+static char *source;            // the whole input, then PADDING zero bytes
+static int sourceLength;
+static const char *cur;         // next character to scan
+static int curLineNum, curColNum;
+static List<int> lineStarts;    // offset of each line into source
+
+static void ReadSource(FILE *fp)
+{
+    int capacity = 1 << 16;
+    source = (char *)realloc(source, capacity);
+    sourceLength = 0;
+    size_t n;
+    while ((n = fread(source + sourceLength, 1, capacity - sourceLength - PADDING, fp)) > 0) {
+        sourceLength += n;
+        if (capacity - sourceLength - PADDING < 4096) {
+            capacity *= 2;
+            source = (char *)realloc(source, capacity);
+        }
+    }
+    memset(source + sourceLength, 0, PADDING);
+    cur = source;
+}
+
+static bool AtEnd(const char *p) { return p >= source + sourceLength; }
+
+
+/* Keywords
+ * --------
+ * KeywordHash is perfect on the 24 words below: no two of them land in
+ * the same one of the 64 slots. An identifier is looked up by checking
+ * the one word in its slot. The table is filled in by the compiler, and
+ * a keyword added here that collides with another fails the build.
+ */
+struct Keyword {
+    const char *name;
+    int token;
+};
+
+static constexpr Keyword keywords[] = {
+    {"void", T_Void}, {"int", T_Int}, {"double", T_Double}, {"bool", T_Bool},
+    {"string", T_String}, {"null", T_Null}, {"class", T_Class},
+    {"extends", T_Extends}, {"this", T_This}, {"interface", T_Interface},
+    {"implements", T_Implements}, {"while", T_While}, {"for", T_For},
+    {"if", T_If}, {"else", T_Else}, {"return", T_Return}, {"break", T_Break},
+    {"New", T_New}, {"NewArray", T_NewArray}, {"Print", T_Print},
+    {"ReadInteger", T_ReadInteger}, {"ReadLine", T_ReadLine},
+    {"true", T_BoolConstant}, {"false", T_BoolConstant},
+};
+static const int NumKeywords = sizeof(keywords) / sizeof(keywords[0]);
+static const int MinKeywordLen = 2, MaxKeywordLen = 11;
+
+static constexpr int KeywordHash(const char *s, int len)
+{
+    return (2 * s[0] + 2 * s[1] + s[len - 1] + len) & 63;
+}
+
+static constexpr int Length(const char *s)
+{
+    int len = 0;
+    while (s[len]) len++;
+    return len;
+}
+
+struct KeywordTable {
+    const Keyword *slots[64];
+    bool perfect;               // no two keywords wanted the same slot
+};
+
+static constexpr KeywordTable BuildKeywordTable()
+{
+    KeywordTable table = {};
+    table.perfect = true;
+    for (int i = 0; i < NumKeywords; i++) {
+        int h = KeywordHash(keywords[i].name, Length(keywords[i].name));
+        if (table.slots[h]) table.perfect = false;
+        table.slots[h] = &keywords[i];
+    }
+    return table;
+}
+
+static constexpr KeywordTable keywordTable = BuildKeywordTable();
+static_assert(keywordTable.perfect, "KeywordHash has a collision, pick a new one");
+
+static inline const Keyword *FindKeyword(const char *s, int len)
+{
+    if (len < MinKeywordLen || len > MaxKeywordLen) return NULL;
+    const Keyword *k = keywordTable.slots[KeywordHash(s, len)];
+    if (k && strncmp(k->name, s, len) == 0 && k->name[len] == '\0') return k;
+    return NULL;
+}
+
+
+/* Character classes
+ * -----------------
+ * Looked up in one table instead of through <ctype.h>, whose results
+ * depend on the locale.
+ */
+enum { Alpha = 1, Digit = 2, HexDigit = 4, Underscore = 8 };
+static unsigned char charClass[256];
+
+static void BuildCharClasses()
+{
+    for (int c = 0; c < 256; c++) {
+        unsigned char cls = 0;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) cls |= Alpha;
+        if (c >= '0' && c <= '9') cls |= Digit | HexDigit;
+        if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) cls |= HexDigit;
+        if (c == '_') cls |= Underscore;
+        charClass[c] = cls;
+    }
+}
+
+static inline bool Is(char c, int cls) { return charClass[(unsigned char)c] & cls; }
+
+
+/* Skipping
+ * --------
+ * SkipSpaces returns the first character at or after p that isn't a
+ * space. FindAny returns the first one that is one of a, b, c or '\0'
+ * (every search stops at the padding). Both only ever read into the
+ * padding, never past it.
+ */
+static const char *SkipSpaces(const char *p)
+{
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' ');
+    for (;; p += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        int other = ~_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, space)) & 0xFFFF;
+        if (other) return p + __builtin_ctz(other);
+    }
+#else
+    while (*p == ' ') p++;
+    return p;
+#endif
+}
+
+static const char *FindAny(const char *p, char a, char b, char c)
+{
+#ifdef __SSE2__
+    const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c), zero = _mm_setzero_si128();
+    for (;; p += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va),
+                                                _mm_cmpeq_epi8(chunk, vb)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(chunk, vc),
+                                                _mm_cmpeq_epi8(chunk, zero)));
+        int found = _mm_movemask_epi8(hit);
+        if (found) return p + __builtin_ctz(found);
+    }
+#else
+    while (*p != a && *p != b && *p != c && *p != '\0') p++;
+    return p;
+#endif
+}
+
+
+/* Positions
+ * ---------
+ * Each lexeme, returned or not, advances the column by its length (what
+ * DoBeforeEachAction does in scanner.l); a newline starts the next line
+ * and a tab moves on as the tab rule there does.
+ */
+static inline void Locate(int len)
+{
+    yylloc.first_line = yylloc.last_line = curLineNum;
+    yylloc.first_column = curColNum;
+    yylloc.last_column = curColNum + len - 1;
+    curColNum += len;
+}
+
+static void NewLine(const char *p)
+{
+    curLineNum++;
+    curColNum = 1;
+    lineStarts.Append(p + 1 - source);
+}
+
+static void Tab()
+{
+    curColNum += 1;
+    curColNum += TAB_SIZE - curColNum%TAB_SIZE + 1;
+}
+
+//sets yytext to a copy of the len characters at p, for an error message
+static void SetText(const char *p, int len)
+{
+    static char *text;
+    text = (char *)realloc(text, len + 1);
+    memcpy(text, p, len);
+    text[len] = '\0';
+    yytext = text;
+}
+
+/* Function: SkipComment
+ * ---------------------
+ * Called with cur just past the comment opener. Returns false when the
+ * input ends before the "*" "/" that closes it.
+ */
+static bool SkipComment()
+{
+    for (;;) {
+        const char *p = FindAny(cur, '*', '\n', '\t');
+        curColNum += p - cur;
+        cur = p;
+        switch (*p) {
+          case '\n': NewLine(p); cur++; break;
+          case '\t': Tab(); cur++; break;
+          case '*':
+            if (p[1] == '/') {
+                curColNum += 2;
+                cur += 2;
+                return true;
+            }
+            curColNum++;
+            cur++;
+            break;
+          default:
+            if (AtEnd(p)) return false;
+            curColNum++;        // a '\0' in the middle of the input
+            cur++;
+        }
+    }
+}
+
+static void SkipLineComment()
+{
+    const char *p = cur;
+    while (true) {
+        p = FindAny(p, '\n', '\n', '\n');
+        if (*p == '\n' || AtEnd(p)) break;
+        p++;
+    }
+    curColNum += p - cur;
+    cur = p;
+}
+
+static int ScanIdentifier()
+{
+    const char *p = cur + 1;
+    while (Is(*p, Alpha | Digit | Underscore)) p++;
+    int len = p - cur;
+    Locate(len);
+    const Keyword *k = FindKeyword(cur, len);
+    if (k && k->token == T_BoolConstant) {
+        yylval.boolConstant = (cur[0] == 't');
+    } else if (!k) {
+        if (len > MaxIdentLen) {
+            SetText(cur, len);
+            ReportError::LongIdentifier(&yylloc, yytext);
+        }
+        int copy = len < MaxIdentLen ? len : MaxIdentLen;
+        memcpy(yylval.identifier, cur, copy);
+        yylval.identifier[copy] = '\0';
+    }
+    cur = p;
+    return k ? k->token : T_Identifier;
+}
+
+static int ScanNumber()
+{
+    const char *p = cur;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && Is(p[2], HexDigit)) {
+        p += 3;
+        while (Is(*p, HexDigit)) p++;
+        Locate(p - cur);
+        yylval.integerConstant = strtol(cur, NULL, 16);
+        cur = p;
+        return T_IntConstant;
+    }
+    while (Is(*p, Digit)) p++;
+    if (*p != '.') {
+        Locate(p - cur);
+        yylval.integerConstant = strtol(cur, NULL, 10);
+        cur = p;
+        return T_IntConstant;
+    }
+    p++;
+    while (Is(*p, Digit)) p++;
+    if (*p == 'e' || *p == 'E') {
+        const char *q = p + 1;
+        if (*q == '+' || *q == '-') q++;
+        if (Is(*q, Digit)) {
+            while (Is(*q, Digit)) q++;
+            p = q;
+        }
+    }
+    Locate(p - cur);
+    yylval.doubleConstant = atof(cur);
+    cur = p;
+    return T_DoubleConstant;
+}
+
+//returns 0 for a string that isn't closed on its line, after reporting it
+static int ScanString()
+{
+    const char *p = cur + 1;
+    while (*p != '"' && *p != '\n' && !AtEnd(p)) p++;
+    if (*p == '"') {
+        p++;
+        Locate(p - cur);
+        yylval.stringConstant = (char *)malloc(p - cur + 1);
+        memcpy(yylval.stringConstant, cur, p - cur);
+        yylval.stringConstant[p - cur] = '\0';
+        cur = p;
+        return T_StringConstant;
+    }
+    Locate(p - cur);
+    SetText(cur, p - cur);
+    ReportError::UntermString(&yylloc, yytext);
+    cur = p;
+    return 0;
+}
+
+static int TwoCharOperator(char a, char b)
+{
+    switch (a) {
+      case '<': return b == '=' ? T_LessEqual : 0;
+      case '>': return b == '=' ? T_GreaterEqual : 0;
+      case '=': return b == '=' ? T_Equal : 0;
+      case '!': return b == '=' ? T_NotEqual : 0;
+      case '&': return b == '&' ? T_And : 0;
+      case '|': return b == '|' ? T_Or : 0;
+      case '[': return b == ']' ? T_Dims : 0;
+      default:  return 0;
+    }
+}
+
+static bool IsOperator(char c)
+{
+    return c != '\0' && strchr("-+/*%=.,;!<>()[]{}", c) != NULL;
+}
+
+
+/* Function: yylex
+ * ---------------
+ * Returns the next token, 0 at the end of the input (or of an
+ * unterminated comment).
+ */
+int yylex()
+{
+    for (;;) {
+        char c = *cur;
+        switch (c) {
+          case ' ': {
+            const char *p = SkipSpaces(cur);
+            curColNum += p - cur;
+            cur = p;
+            continue;
+          }
+          case '\t': Tab(); cur++; continue;
+          case '\n': NewLine(cur); cur++; continue;
+          case '"':
+            if (int token = ScanString()) return token;
+            continue;
+          case '/':
+            if (cur[1] == '*') {
+                curColNum += 2;
+                cur += 2;
+                if (SkipComment()) continue;
+                ReportError::UntermComment();
+                return 0;
+            }
+            if (cur[1] == '/') {
+                SkipLineComment();
+                continue;
+            }
+            break;
+          case '\0':
+            if (AtEnd(cur)) return 0;
+            break;
+        }
+        if (Is(c, Alpha)) return ScanIdentifier();
+        if (Is(c, Digit)) return ScanNumber();
+        if (int token = TwoCharOperator(c, cur[1])) {
+            Locate(2);
+            cur += 2;
+            return token;
+        }
+        Locate(1);
+        cur++;
+        if (IsOperator(c)) return c;
+        ReportError::UnrecogChar(&yylloc, c);
+    }
+}
+
+
+/* Function: InitScanner
+ * ---------------------
+ * Reads the input (the source files, or standard input) and
+ * sets up the character classes.
+ */
+void InitScanner()
+{
+    PrintDebug("lex", "Initializing scanner");
+    BuildCharClasses();
+    yyrestart(OpenSourceFiles());
+}
+
+void yyrestart(FILE *fp)
+{
+    ReadSource(fp);
+    lineStarts = List<int>();
+    lineStarts.Append(0);
+    curLineNum = 1;
+    curColNum = 1;
+}
+
+
+/* Function: GetLineNumbered()
+ * ---------------------------
+ * Returns string with contents of line numbered n or NULL if the
+ * contents of that line are not available. The line is copied out of
+ * the source on demand, into a buffer that the next call reuses.
+ */
+const char *GetLineNumbered(int num) {
+    static char *line;
+    if (num <= 0 || num > lineStarts.NumElements()) return NULL;
+    const char *start = source + lineStarts.Nth(num-1), *end = start;
+    while (!AtEnd(end) && *end != '\n') end++;
+    line = (char *)realloc(line, end - start + 1);
+    memcpy(line, start, end - start);
+    line[end - start] = '\0';
+    return line;
+}
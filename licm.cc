@@ -0,0 +1,216 @@
+/* File: licm.cc
+ * -------------
+ * Implementation of loop-invariant code motion. Loops are visited
+ * innermost first so code hoisted into an inner preheader (which is part
+ * of the outer loop) gets a chance to move out further.
+ *
+ * An instruction is moved when:
+ *   - it loads a constant or label, or is an Assign, a Load,
+ *     or a BinaryOp that can't trap (anything but / and %)
+ *   - it writes a local or temp that has no other definition in the
+ *     function, and every use of that Location is dominated by it, so
+ *     executing it earlier can't change what any use sees
+ *   - each operand is either never written inside the loop or is itself
+ *     the result of an instruction already hoisted (globals are treated
+ *     as written by any call the loop makes)
+ *   - for a Load, additionally the loop never writes memory, the load
+ *     is in a block that runs on every trip through the loop, and nothing
+ *     that can end the program with a runtime error (a BoundsCheck, a
+ *     / or %, a call) stays in the loop ahead of it, earlier in its block
+ *     or in a block dominating it. A check that guards the address is
+ *     never left behind the load it guards, and hoisting can't introduce
+ *     a fault on a path that didn't have one.
+ */
+
+#include "licm.h"
+#include "cfg.h"
+#include "codegen.h"
+#include <map>
+
+typedef std::map<Location*, int> CountMap;
+
+static bool IsLocalSlot(Location *loc)
+{
+  return loc->GetSegment() == fpRelative && loc->GetOffset() < 0;
+}
+
+static bool WritesMemory(Instruction *instr)
+{
+  if (dynamic_cast<Store*>(instr) || dynamic_cast<ACall*>(instr))
+    return true;
+  if (LCall *call = dynamic_cast<LCall*>(instr))
+    return !CodeGenerator::IsBuiltIn(call->GetLabel());
+  return false;
+}
+
+static bool CanHalt(Instruction *instr)
+{
+  if (dynamic_cast<BoundsCheck*>(instr) || dynamic_cast<LCall*>(instr)
+      || dynamic_cast<ACall*>(instr))
+    return true;
+  if (BinaryOp *op = dynamic_cast<BinaryOp*>(instr))
+    return op->GetOpCode() == BinaryOp::Div || op->GetOpCode() == BinaryOp::Mod;
+  return false;
+}
+
+static bool IsMovableKind(Instruction *instr)
+{
+  if (dynamic_cast<LoadConstant*>(instr) || dynamic_cast<LoadDoubleConstant*>(instr)
+      || dynamic_cast<LoadStringConstant*>(instr)
+      || dynamic_cast<LoadLabel*>(instr) || dynamic_cast<Assign*>(instr)
+      || dynamic_cast<Load*>(instr))
+    return true;
+  if (BinaryOp *op = dynamic_cast<BinaryOp*>(instr))
+    return op->GetOpCode() != BinaryOp::Div && op->GetOpCode() != BinaryOp::Mod;
+  return false;
+}
+
+class LoopHoister {
+  private:
+    FlowGraph *graph;
+    CountMap defs;
+    std::map<Location*, std::vector<Instruction*> > uses;
+    std::map<Instruction*, BasicBlock*> blockOf;
+    std::map<Instruction*, int> indexOf;
+
+    Loop *loop;
+    CountMap loopDefs;
+    bool loopWritesMemory;
+    std::vector<BasicBlock*> halting;   // loop blocks holding a CanHalt
+
+    bool DominatesUses(Instruction *instr, BasicBlock *b);
+    bool IsInvariant(Location *src);
+    bool RunsEveryTrip(BasicBlock *b);
+    bool FollowsHalt(Instruction *instr, BasicBlock *b);
+    bool CanHoist(Instruction *instr, BasicBlock *b);
+
+  public:
+    LoopHoister(FlowGraph *g);
+    void Hoist(Loop *l, BasicBlock *preheader);
+};
+
+LoopHoister::LoopHoister(FlowGraph *g) : graph(g)
+{
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    int index = 0;
+    std::list<Instruction*>::iterator p;
+    for (p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p) {
+      Instruction *instr = *p;
+      blockOf[instr] = blocks[i];
+      indexOf[instr] = index++;
+      if (instr->GetDst()) defs[instr->GetDst()]++;
+      for (int s = 0; s < instr->NumSrcs(); s++)
+        uses[instr->GetSrc(s)].push_back(instr);
+    }
+  }
+}
+
+bool LoopHoister::DominatesUses(Instruction *instr, BasicBlock *b)
+{
+  std::vector<Instruction*> &users = uses[instr->GetDst()];
+  for (int i = 0; i < (int)users.size(); i++) {
+    BasicBlock *ub = blockOf[users[i]];
+    if (ub == b) {
+      if (indexOf[users[i]] <= indexOf[instr]) return false;
+    } else if (!graph->Dominates(b, ub)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoopHoister::IsInvariant(Location *src)
+{
+  if (loopDefs[src] != 0) return false;
+  return !(src->GetSegment() == gpRelative && loopWritesMemory);
+}
+
+bool LoopHoister::RunsEveryTrip(BasicBlock *b)
+{
+  for (int i = 0; i < (int)loop->exiting.size(); i++)
+    if (!graph->Dominates(b, loop->exiting[i])) return false;
+  return true;
+}
+
+bool LoopHoister::FollowsHalt(Instruction *instr, BasicBlock *b)
+{
+  std::list<Instruction*>::iterator p;
+  for (p = b->code.begin(); *p != instr; ++p)
+    if (CanHalt(*p)) return true;
+  for (int i = 0; i < (int)halting.size(); i++)
+    if (halting[i] != b && graph->Dominates(halting[i], b)) return true;
+  return false;
+}
+
+bool LoopHoister::CanHoist(Instruction *instr, BasicBlock *b)
+{
+  if (!IsMovableKind(instr)) return false;
+  Location *dst = instr->GetDst();
+  if (!IsLocalSlot(dst) || defs[dst] != 1) return false;
+  for (int s = 0; s < instr->NumSrcs(); s++)
+    if (!IsInvariant(instr->GetSrc(s))) return false;
+  if (dynamic_cast<Load*>(instr)
+      && (loopWritesMemory || !RunsEveryTrip(b) || FollowsHalt(instr, b)))
+    return false;
+  return DominatesUses(instr, b);
+}
+
+void LoopHoister::Hoist(Loop *l, BasicBlock *preheader)
+{
+  loop = l;
+  loopDefs.clear();
+  loopWritesMemory = false;
+  halting.clear();
+  std::vector<BasicBlock*> order;   // loop blocks, dominators first
+  std::vector<BasicBlock*> &rpo = graph->ReversePostorder();
+  for (int i = 0; i < (int)rpo.size(); i++)
+    if (loop->Contains(rpo[i])) order.push_back(rpo[i]);
+  for (int i = 0; i < (int)order.size(); i++) {
+    bool halts = false;
+    std::list<Instruction*>::iterator p;
+    for (p = order[i]->code.begin(); p != order[i]->code.end(); ++p) {
+      if ((*p)->GetDst()) loopDefs[(*p)->GetDst()]++;
+      if (WritesMemory(*p)) loopWritesMemory = true;
+      if (CanHalt(*p)) halts = true;
+    }
+    if (halts) halting.push_back(order[i]);
+  }
+
+  std::list<Instruction*> &pre = preheader->code;
+  std::list<Instruction*>::iterator insertAt = pre.end();
+  if (preheader->GetTerminator()) --insertAt;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < (int)order.size(); i++) {
+      std::list<Instruction*> &code = order[i]->code;
+      std::list<Instruction*>::iterator p = code.begin();
+      while (p != code.end()) {
+        Instruction *instr = *p;
+        if (!CanHoist(instr, order[i])) {
+          ++p;
+          continue;
+        }
+        p = code.erase(p);
+        pre.insert(insertAt, instr);
+        blockOf[instr] = preheader;
+        loopDefs[instr->GetDst()]--;
+        changed = true;
+      }
+    }
+  }
+}
+
+
+void HoistLoopInvariants(FlowGraph *graph)
+{
+  graph->AddPreheaders();
+  LoopHoister hoister(graph);
+  std::vector<Loop*> &loops = graph->Loops();
+  for (int i = 0; i < (int)loops.size(); i++) {
+    BasicBlock *preheader = graph->GetPreheader(loops[i]);
+    if (preheader) hoister.Hoist(loops[i], preheader);
+  }
+}
@@ -0,0 +1,19 @@
+/* File: licm.h
+ * ------------
+ * Loop-invariant code motion over the Tac of one function.
+ *
+ * Instructions inside a loop whose result is the same on every iteration
+ * (constants, labels such as vtables, arithmetic on values not changed by
+ * the loop, and loads of fields/vtable slots from such values when the
+ * loop never writes memory) are moved into the loop's preheader so they
+ * execute once per entry instead of once per iteration.
+ */
+
+#ifndef _H_licm
+#define _H_licm
+
+class FlowGraph;
+
+void HoistLoopInvariants(FlowGraph *graph);
+
+#endif
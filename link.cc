@@ -0,0 +1,213 @@
+/* File: link.cc
+ * -------------
+ * Implementation of separate compilation and linking.
+ */
+
+#include "link.h"
+#include "ast_decl.h"
+#include "cache.h"
+#include "codegen.h"
+#include "errors.h"
+#include "mips.h"
+#include "scanner.h" // for GetLineNumbered
+#include "tacfile.h"
+#include "utility.h"
+#include <limits.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+struct Unit {
+  const char *source;
+  std::string object, key;
+  List<Decl*> decls;
+  TacReader *reader;
+};
+
+//a.decaf, dir/a.decaf to a.dco, dir/a.dco
+static std::string ObjectFor(const char *source)
+{
+  std::string name = source;
+  size_t dot = name.rfind('.'), slash = name.rfind('/');
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    name.erase(dot);
+  return name + ".dco";
+}
+
+//the text of source file n, as the scanner read it
+static std::string SourceText(int n)
+{
+  int end = (n + 1 < NumSourceFiles()) ? FirstLineOfSourceFile(n + 1) : INT_MAX;
+  std::string text;
+  const char *line;
+  for (int l = FirstLineOfSourceFile(n); l < end && (line = GetLineNumbered(l)); l++) {
+    text += line;
+    text += "\n";
+  }
+  return text;
+}
+
+
+/* Function: Compile
+ * -----------------
+ * Runs in the child process for unit: generates the code of its decls as
+ * a Tac file (see CodeGenerator::DoFinalCodeGen), written under a
+ * temporary name and renamed to the object when complete.
+ */
+static void Compile(Unit *unit)
+{
+  char temp[32];
+  sprintf(temp, ".%d", (int)getpid());
+  std::string path = unit->object + temp;
+  if (!freopen(path.c_str(), "wb", stdout)) {
+    perror(path.c_str());
+    _exit(1);
+  }
+  SetDebugForKey("tac", false);
+  SetDebugForKey("tacfile", true);
+  CodeGenerator &gen = Node::GENERATOR;
+  gen.GetTacWriter()->SetKey(unit->key);
+  for (int i = 0; i < unit->decls.NumElements(); i++)
+    unit->decls.Nth(i)->Emit();
+  gen.DoFinalCodeGen();
+  if (fclose(stdout) != 0 || rename(path.c_str(), unit->object.c_str()) != 0) {
+    remove(path.c_str());
+    _exit(1);
+  }
+  _exit(0);
+}
+
+//waits for one of the running compiles, false if it failed
+static bool Reap(std::map<pid_t, Unit*> *running)
+{
+  int status;
+  pid_t pid = waitpid(-1, &status, 0);
+  Assert(running->count(pid));
+  Unit *unit = (*running)[pid];
+  running->erase(pid);
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0) return true;
+  ReportError::Formatted(NULL, "Compiling %s failed", unit->source);
+  return false;
+}
+
+//compiles the units whose objects are out of date, in parallel
+static bool CompileAll(std::vector<Unit*> &units)
+{
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  if (jobs < 1) jobs = 1;
+  std::map<pid_t, Unit*> running;
+  bool ok = true;
+  fflush(stdout);
+  fflush(stderr);
+  for (size_t i = 0; i < units.size(); i++) {
+    Unit *unit = units[i];
+    if (TacReader::KeyOf(unit->object.c_str()) == unit->key) {
+      PrintDebug("dev", "%s is up to date", unit->object.c_str());
+      continue;
+    }
+    PrintDebug("dev", "compiling %s", unit->source);
+    fflush(stdout);
+    while ((long)running.size() >= jobs)
+      ok = Reap(&running) && ok;
+    pid_t pid = fork();
+    if (pid == 0) Compile(unit);
+    if (pid < 0) Failure("Can't start a process to compile %s", unit->source);
+    running[pid] = unit;
+  }
+  while (!running.empty())
+    ok = Reap(&running) && ok;
+  return ok;
+}
+
+
+/* Function: Resolve
+ * -----------------
+ * Opens each object and checks its labels against the others, reporting
+ * a label defined twice or referred to but never defined.
+ */
+static bool Resolve(std::vector<Unit*> &units)
+{
+  std::map<std::string, Unit*> definedBy;
+  for (size_t i = 0; i < units.size(); i++) {
+    FILE *fp = fopen(units[i]->object.c_str(), "rb");
+    if (!fp) {
+      ReportError::Formatted(NULL, "Can't read %s", units[i]->object.c_str());
+      return false;
+    }
+    units[i]->reader = TacReader::Open(fp);
+    fclose(fp);
+    List<const char *> labels;
+    units[i]->reader->GetDefined(&labels);
+    for (int j = 0; j < labels.NumElements(); j++) {
+      Unit *&definer = definedBy[labels.Nth(j)];
+      if (definer)
+        ReportError::Formatted(NULL, "%s is defined in both %s and %s", labels.Nth(j),
+                               definer->source, units[i]->source);
+      else
+        definer = units[i];
+    }
+  }
+  for (size_t i = 0; i < units.size(); i++) {
+    List<const char *> labels;
+    units[i]->reader->GetReferenced(&labels);
+    for (int j = 0; j < labels.NumElements(); j++)
+      if (!definedBy.count(labels.Nth(j)) && !CodeGenerator::IsRuntimeLabel(labels.Nth(j)))
+        ReportError::Formatted(NULL, "Undefined reference to %s in %s", labels.Nth(j),
+                               units[i]->source);
+  }
+  return ReportError::NumErrors() == 0;
+}
+
+static void Link(std::vector<Unit*> &units)
+{
+  bool printTac = IsDebugOn("tac");
+  Mips *mips = printTac ? NULL : Node::GENERATOR.GetMips();
+  for (size_t i = 0; i < units.size(); i++) {
+    TacReader *reader = units[i]->reader;
+    reader->RenumberLabels(&CodeGenerator::nextLabelNum);
+    for (int j = 0; j < reader->NumInstructions(); j++) {
+      Instruction *instr = reader->Read(j);
+      if (printTac)
+        instr->Print();
+      else
+        instr->Emit(mips);
+      delete instr;
+    }
+  }
+  if (printTac) return;
+  List<int> roots;
+  units[0]->reader->GetRoots(&roots);      // the same in every object
+  mips->EmitGcRoots(&roots);
+  mips->EmitStringPool();
+  mips->EmitDoublePool();
+  mips->EmitJumpTables();
+}
+
+void CompileAndLink(List<Decl*> *decls)
+{
+  std::ostringstream layout;
+  DescribeCompiler(layout);
+  for (int i = 0; i < decls->NumElements(); i++)
+    decls->Nth(i)->PrintLayout(layout);
+
+  std::vector<Unit*> units;
+  for (int n = 0; n < NumSourceFiles(); n++) {
+    Unit *unit = new Unit;
+    unit->source = NthSourceFile(n);
+    unit->object = ObjectFor(unit->source);
+    unit->key = HashKey(layout.str() + SourceText(n));
+    unit->reader = NULL;
+    units.push_back(unit);
+  }
+  for (int i = 0; i < decls->NumElements(); i++) {
+    Decl *decl = decls->Nth(i);
+    units[SourceFileForLine(decl->GetSpan()->first_line)]->decls.Append(decl);
+  }
+
+  if (CompileAll(units) && Resolve(units))
+    Link(units);
+}
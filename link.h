@@ -0,0 +1,37 @@
+/* File: link.h
+ * ------------
+ * Separate compilation of a program split over several source files
+ * ("dcc a.decaf b.decaf ..."), and the link step that puts it together.
+ *
+ * The files are parsed and declared together, as one program, so each
+ * sees the classes, functions and globals of the others and all agree on
+ * object layouts and global offsets. Code is then generated for each file
+ * apart, in a child process per file (as many at once as there are
+ * processors), into an object file next to the source (a.dco for
+ * a.decaf): the optimized Tac of the file's functions and vtables in the
+ * format of tacfile.h, with the labels it defines and those it refers to.
+ *
+ * An object is written under a key, a hash of the file's source, the
+ * layout of the whole program, the debug keys and the compiler, made as
+ * for the compilation cache (cache.h). While the key still matches the
+ * object is used as it is, and its file isn't compiled again.
+ *
+ * Linking checks that every label referred to is defined by exactly one
+ * object or the runtime, renumbers the local labels of each object so
+ * they don't clash, and runs the Mips backend over the objects in order,
+ * so the string constants and doubles of all of them are pooled once.
+ * Under -d tac the linked Tac is printed instead.
+ *
+ * Functions are only inlined into callers in the same file.
+ */
+
+#ifndef _H_link
+#define _H_link
+
+#include "list.h"
+
+class Decl;
+
+void CompileAndLink(List<Decl*> *decls);
+
+#endif
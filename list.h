@@ -2,15 +2,19 @@
  * ------------
  * Simple list class for storing a linear collection of elements. It
  * supports operations similar in name to the CS107 DArray -- nth, insert,
- * append, remove, etc.  This class is nothing more than a very thin
- * cover of a STL deque, with some added range-checking. Given not everyone
- * is familiar with the C++ templates, this class provides a more familiar
- * interface.
+ * append, remove, etc.  The elements are kept in one contiguous array,
+ * with some added range-checking. Room for the first few is part of the
+ * List itself, so the many short lists in the AST (actuals, formals, the
+ * statements of a small block) need no allocation of their own; past that
+ * the array is allocated and doubles in size as it fills. Given not
+ * everyone is familiar with the C++ templates, this class provides a more
+ * familiar interface.
  *
- * It can handle elements of any type, the typename for a List includes the
- * element type in angle brackets, e.g.  to store elements of type double,
- * you would use the type name List<double>, to store elements of type
- * Decl *, it woud be List<Decl*> and so on.
+ * It can handle elements of any type that can be default constructed and
+ * copied, the typename for a List includes the element type in angle
+ * brackets, e.g.  to store elements of type double, you would use the
+ * type name List<double>, to store elements of type Decl *, it woud be
+ * List<Decl*> and so on.
  *
  * Here is some sample code illustrating the usage of a List of integers
  *
@@ -23,12 +27,13 @@
  *       }
  *       return sum;
  *    }
+ *
+ * or, the same loop, "for (int val : *list) sum += val;".
  */
 
 #ifndef _H_list
 #define _H_list
 
-#include <deque>
 #include "utility.h"  // for Assert()
 
 class Node;
@@ -36,37 +41,79 @@ class Node;
 template<class Element> class List {
 
  private:
-    std::deque<Element> elems;
+    static const int InlineCount = 4;   // elements held without allocating
+    Element inlineElems[InlineCount];
+    Element *elems;                     // inlineElems, or allocated
+    int numElems, capacity;
+
+    void Reserve(int needed)
+        { if (needed <= capacity) return;
+          int newCapacity = capacity * 2;
+          if (newCapacity < needed) newCapacity = needed;
+          Element *grown = new Element[newCapacity];
+          for (int i = 0; i < numElems; i++) grown[i] = elems[i];
+          if (elems != inlineElems) delete[] elems;
+          elems = grown;
+          capacity = newCapacity; }
 
  public:
            // Create a new empty list
-    List() {}
+    List() : elems(inlineElems), numElems(0), capacity(InlineCount) {}
+
+    List(const List &other) : elems(inlineElems), numElems(0), capacity(InlineCount)
+        { *this = other; }
+
+    List &operator=(const List &other)
+        { if (this == &other) return *this;
+          Reserve(other.numElems);
+          for (int i = 0; i < other.numElems; i++) elems[i] = other.elems[i];
+          numElems = other.numElems;
+          return *this; }
+
+    ~List()
+        { if (elems != inlineElems) delete[] elems; }
 
            // Returns count of elements currently in list
     int NumElements() const
-	{ return elems.size(); }
+	{ return numElems; }
 
           // Returns element at index in list. Indexing is 0-based.
           // Raises an assert if index is out of range.
-    Element Nth(int index) const
-	{ Assert(index >= 0 && index < NumElements());
+    const Element &Nth(int index) const
+	{ Assert(index >= 0 && index < numElems);
 	  return elems[index]; }
 
           // Inserts element at index, shuffling over others
           // Raises assert if index out of range
     void InsertAt(const Element &elem, int index)
-	{ Assert(index >= 0 && index <= NumElements());
-	  elems.insert(elems.begin() + index, elem); }
+	{ Assert(index >= 0 && index <= numElems);
+	  Element copy = elem;          // elem may be in the list
+	  Reserve(numElems + 1);
+	  for (int i = numElems; i > index; i--) elems[i] = elems[i-1];
+	  elems[index] = copy;
+	  numElems++; }
 
           // Adds element to list end
     void Append(const Element &elem)
-	{ elems.push_back(elem); }
+	{ if (numElems == capacity) {
+	    Element copy = elem;
+	    Reserve(numElems + 1);
+	    elems[numElems++] = copy;
+	  } else
+	    elems[numElems++] = elem; }
 
          // Removes element at index, shuffling down others
          // Raises assert if index out of range
     void RemoveAt(int index)
-	{ Assert(index >= 0 && index < NumElements());
-	  elems.erase(elems.begin() + index); }
+	{ Assert(index >= 0 && index < numElems);
+	  for (int i = index; i < numElems - 1; i++) elems[i] = elems[i+1];
+	  elems[--numElems] = Element(); }
+
+         // For range-based for loops, "for (Decl *d : *decls) ..."
+    Element *begin() { return elems; }
+    Element *end() { return elems + numElems; }
+    const Element *begin() const { return elems; }
+    const Element *end() const { return elems + numElems; }
 
        // These are some specific methods useful for lists of ast nodes
        // They will only work on lists of elements that respond to the
@@ -74,15 +121,11 @@ template<class Element> class List {
        // you can still have Lists of ints, chars*, as long as you
        // don't try to SetParentAll on that list.
     void SetParentAll(Node *p)
-        { for (int i = 0; i < NumElements(); i++)
-             Nth(i)->SetParent(p); }
+        { for (Element &elem : *this)
+             elem->SetParent(p); }
     void EmitForAll(){
-      for (int i = 0; i < NumElements(); i++)
-        Nth(i)->Emit();
-    }
-    void DeclareForAll(){
-      for (int i = 0; i < NumElements(); i++)
-        Nth(i)->Declare();
+      for (Element &elem : *this)
+        elem->Emit();
     }
 
 };
@@ -9,13 +9,16 @@
 #include "utility.h"
 #include "errors.h"
 #include "parser.h"
+#include "tacfile.h"
 
 
 /* Function: main()
  * ----------------
  * Entry point to the entire program.  We parse the command line and turn
  * on any debugging flags requested by the user when invoking the program.
- * InitScanner() is used to set up the scanner.
+ * With -d fromtac the input is a Tac file to translate, not a program.
+ * InitScanner() is used to set up the scanner; with -d scan the input is
+ * only tokenized and the number of tokens printed.
  * InitParser() is used to set up the parser. The call to yyparse() will
  * attempt to parse a complete program from the input.
  */
@@ -23,8 +26,18 @@ int main(int argc, char *argv[])
 {
     SetDebugForKey("dev", false);
     ParseCommandLine(argc, argv);
+    if (IsDebugOn("fromtac")) { // translate a Tac file, see tacfile.h
+        EmitTacFile(stdin);
+        return 0;
+    }
 
     InitScanner();
+    if (IsDebugOn("scan")) { // just run the scanner, for bench/scan.sh
+        int numTokens = 0;
+        while (yylex() != 0) numTokens++;
+        printf("%d tokens\n", numTokens);
+        return 0;
+    }
     InitParser();
     yyparse();
     return (ReportError::NumErrors() == 0? 0 : -1);
@@ -23,6 +23,7 @@
 #include "mips.h"
 #include <stdarg.h>
 #include <cstring>
+#include <algorithm>
 
 
 
@@ -69,24 +70,104 @@ void Mips::FillRegister(Location *src, Register reg)
 }
 
 
+/* Method: FillFloatRegister / SpillFloatRegister
+ * -----------------------------------------------
+ * Move a double between memory and an FPU register pair. Stack and heap
+ * slots are only word aligned, so each half moves separately (l.d/s.d
+ * need 8-byte alignment).
+ */
+void Mips::FillFloatRegister(Location *src, FloatRegister reg)
+{
+  Assert(src && src->IsDouble());
+  const char *base = src->GetSegment() == fpRelative? regs[fp].name : regs[gp].name;
+  Emit("lwc1 $f%d, %d(%s)\t# fill %s to %s from %s%+d", 2*reg,
+       src->GetOffset(), base, src->GetName(), fregs[reg].name, base,
+       src->GetOffset());
+  Emit("lwc1 $f%d, %d(%s)", 2*reg + 1, src->GetOffset() + 4, base);
+}
+
+void Mips::SpillFloatRegister(FloatRegister reg)
+{
+  Location *dst = fregs[reg].var;
+  if (!fregs[reg].isDirty) return;
+  const char *base = dst->GetSegment() == fpRelative? regs[fp].name : regs[gp].name;
+  Emit("swc1 $f%d, %d(%s)\t# spill %s from %s to %s%+d", 2*reg,
+       dst->GetOffset(), base, dst->GetName(), fregs[reg].name, base,
+       dst->GetOffset());
+  Emit("swc1 $f%d, %d(%s)", 2*reg + 1, dst->GetOffset() + 4, base);
+  fregs[reg].isDirty = false;
+}
+
+/* Method: SpillFloatRegisters
+ * ---------------------------
+ * Writes every modified double back to memory. Done at the end of each
+ * basic block (before a branch, at a label) and around calls. With
+ * discard set the registers are also forgotten, for when the code that
+ * follows can be reached from somewhere else or the callee clobbers them.
+ */
+void Mips::SpillFloatRegisters(bool discard)
+{
+  for (int i = 0; i < NumFloatRegs; i++) {
+    if (fregs[i].var) SpillFloatRegister((FloatRegister)i);
+    if (discard) fregs[i].var = NULL;
+  }
+}
+
+/* Method: GetFloatRegister
+ * ------------------------
+ * Returns the FPU register holding var, loading it first when it is to
+ * be read and isn't already in one. A register holding nothing is used
+ * if there is one, otherwise one is taken round-robin (never avoid, the
+ * other operand of the instruction being emitted) and spilled if dirty.
+ * A register returned ForWrite is marked dirty.
+ */
+Mips::FloatRegister Mips::GetFloatRegister(Location *var, Reason reason,
+                                           FloatRegister avoid)
+{
+  int reg = -1;
+  for (int i = 0; i < NumFloatRegs && reg < 0; i++)
+    if (LocationsAreSame(fregs[i].var, var)) reg = i;
+  if (reg < 0) {
+    for (int i = 0; i < NumFloatRegs && reg < 0; i++)
+      if (!fregs[i].var && i != avoid) reg = i;
+    while (reg < 0) {
+      int victim = nextVictim;
+      nextVictim = (nextVictim + 1) % NumFloatRegs;
+      if (victim != avoid) reg = victim;
+    }
+    if (fregs[reg].var) SpillFloatRegister((FloatRegister)reg);
+    if (reason == ForRead) FillFloatRegister(var, (FloatRegister)reg);
+    fregs[reg].var = var;
+    fregs[reg].isDirty = false;
+  }
+  if (reason == ForWrite) fregs[reg].isDirty = true;
+  return (FloatRegister)reg;
+}
+
+
 /* Method: Emit
  * ------------
  * General purpose helper used to emit assembly instructions in
  * a reasonable tidy manner.  Takes printf-style formatting strings
  * and variable arguments.
  */
+std::string *Mips::capture = NULL;
+
 void Mips::Emit(const char *fmt, ...)
 {
   va_list args;
-  char buf[1024];
+  char buf[1024], line[1040];
   
   va_start(args, fmt);
   vsprintf(buf, fmt, args);
   va_end(args);
-  if (buf[strlen(buf) - 1] != ':') printf("\t"); // don't tab in labels
-  if (buf[0] != '#') printf("  ");   // outdent comments a little
-  printf("%s", buf);
-  if (buf[strlen(buf)-1] != '\n') printf("\n"); // end with a newline
+  sprintf(line, "%s%s%s%s",
+          buf[strlen(buf) - 1] != ':' ? "\t" : "", // don't tab in labels
+          buf[0] != '#' ? "  " : "",                // outdent comments a little
+          buf,
+          buf[strlen(buf)-1] != '\n' ? "\n" : ""); // end with a newline
+  if (capture) capture->append(line);
+  else fputs(line, stdout);
 }
 
 
@@ -107,23 +188,61 @@ void Mips::EmitLoadConstant(Location *dst, int val)
 
 /* Method: EmitLoadStringConstant
  * ------------------------------
- * Used to assign a variable a pointer to string constant. Emits
- * assembly directives to create a new null-terminated string in the
- * data segment and assigns it a unique label. Slaves dst into a register
- * and loads that label address into the register.
+ * Used to assign a variable a pointer to string constant. Each distinct
+ * string gets a unique label the first time it is seen and is added to
+ * the pool that EmitStringPool lays out in the data segment; repeats
+ * reuse the label. The pool keeps its own copy of the string, since
+ * the cache interns strings it loaded from disk. Slaves dst into a
+ * register and loads that label address into the register.
  */
+int Mips::InternString(const char *str)
+{
+  if (usedStrings && std::find(usedStrings->begin(), usedStrings->end(), str) == usedStrings->end())
+    usedStrings->push_back(str);
+  std::map<std::string, int>::iterator found = stringLabels.find(str);
+  if (found != stringLabels.end()) return found->second;
+  int strNum = pooledStrings.NumElements() + 1;
+  stringLabels[str] = strNum;
+  pooledStrings.Append(strdup(str));
+  return strNum;
+}
+
 void Mips::EmitLoadStringConstant(Location *dst, const char *str)
 {
-  static int strNum = 1;
   char label[16];
-  sprintf(label, "_string%d", strNum++);
-  Emit(".data\t\t\t# create string constant marked with label");
-  Emit("%s: .asciiz %s", label, str);
-  Emit(".text");
+  sprintf(label, "_string%d", InternString(str));
   EmitLoadLabel(dst, label);
 }
 
 
+/* Method: EmitLoadDoubleConstant
+ * ------------------------------
+ * Used to assign a double constant. As with strings, each distinct value
+ * (by bit pattern, so 0.0 and -0.0 stay apart) is labeled once and added
+ * to the pool that EmitDoublePool lays out in the data segment.
+ */
+int Mips::InternDouble(double val)
+{
+  unsigned long long bits;
+  memcpy(&bits, &val, sizeof(bits));
+  if (usedDoubles) {
+    size_t i = 0;
+    while (i < usedDoubles->size() && memcmp(&(*usedDoubles)[i], &val, sizeof(val)) != 0) i++;
+    if (i == usedDoubles->size()) usedDoubles->push_back(val);
+  }
+  std::map<unsigned long long, int>::iterator found = doubleLabels.find(bits);
+  if (found != doubleLabels.end()) return found->second;
+  pooledDoubles.push_back(val);
+  return doubleLabels[bits] = pooledDoubles.size();
+}
+
+void Mips::EmitLoadDoubleConstant(Location *dst, double val)
+{
+  FloatRegister reg = GetFloatRegister(dst, ForWrite);
+  Emit("l.d %s, _double%d\t# load double constant", fregs[reg].name, InternDouble(val));
+}
+
+
 /* Method: EmitLoadLabel
  * ---------------------
  * Used to load a label (ie address in text/data segment) into a variable.
@@ -144,6 +263,13 @@ void Mips::EmitLoadLabel(Location *dst, const char *label)
  */
 void Mips::EmitCopy(Location *dst, Location *src)
 {
+  if (dst->IsDouble()) {
+    FloatRegister from = GetFloatRegister(src, ForRead);
+    FloatRegister to = GetFloatRegister(dst, ForWrite, from);
+    Emit("mov.d %s, %s\t\t# copy %s", fregs[to].name, fregs[from].name,
+         src->GetName());
+    return;
+  }
   FillRegister(src, rd);
   SpillRegister(dst, rd);
 }
@@ -160,6 +286,13 @@ void Mips::EmitCopy(Location *dst, Location *src)
 void Mips::EmitLoad(Location *dst, Location *reference, int offset)
 {
   FillRegister(reference, rs);
+  if (dst->IsDouble()) {
+    FloatRegister reg = GetFloatRegister(dst, ForWrite);
+    Emit("lwc1 $f%d, %d(%s) \t# load double with offset", 2*reg, offset,
+         regs[rs].name);
+    Emit("lwc1 $f%d, %d(%s)", 2*reg + 1, offset + 4, regs[rs].name);
+    return;
+  }
   Emit("lw %s, %d(%s) \t# load with offset", regs[rd].name,
 	 offset, regs[rs].name);
   SpillRegister(dst, rd);
@@ -176,6 +309,14 @@ void Mips::EmitLoad(Location *dst, Location *reference, int offset)
  */
 void Mips::EmitStore(Location *reference, Location *value, int offset)
 {
+  if (value->IsDouble()) {
+    FloatRegister reg = GetFloatRegister(value, ForRead);
+    FillRegister(reference, rd);
+    Emit("swc1 $f%d, %d(%s) \t# store double with offset", 2*reg, offset,
+         regs[rd].name);
+    Emit("swc1 $f%d, %d(%s)", 2*reg + 1, offset + 4, regs[rd].name);
+    return;
+  }
   FillRegister(value, rs);
   FillRegister(reference, rd);
   Emit("sw %s, %d(%s) \t# store with offset",
@@ -183,6 +324,23 @@ void Mips::EmitStore(Location *reference, Location *value, int offset)
 }
 
 
+/* Method: EmitBoundsCheck
+ * -----------------------
+ * Used to check an array subscript before the element is accessed. The
+ * length lives in the word before the first element. Comparing unsigned
+ * catches a negative index too (it looks like a huge number), so one
+ * branch to the runtime error routine covers both ends of the range.
+ */
+void Mips::EmitBoundsCheck(Location *array, Location *index)
+{
+  FillRegister(array, rs);
+  FillRegister(index, rt);
+  Emit("lw %s, -4(%s)\t# load array length", regs[rd].name, regs[rs].name);
+  Emit("bgeu %s, %s, _BoundsError\t# subscript out of range",
+       regs[rt].name, regs[rd].name);
+}
+
+
 /* Method: EmitBinaryOp
  * --------------------
  * Used to perform a binary operation on 2 operands and store result
@@ -194,6 +352,10 @@ void Mips::EmitStore(Location *reference, Location *value, int offset)
 void Mips::EmitBinaryOp(BinaryOp::OpCode code, Location *dst, 
 				 Location *op1, Location *op2)
 {
+  if (op1->IsDouble()) {
+    EmitFloatBinaryOp(code, dst, op1, op2);
+    return;
+  }
   FillRegister(op1, rs);
   FillRegister(op2, rt);
   Emit("%s %s, %s, %s\t", NameForTac(code), regs[rd].name,
@@ -202,6 +364,33 @@ void Mips::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
 }
 
 
+/* Method: EmitFloatBinaryOp
+ * -------------------------
+ * The double version of the above. Arithmetic leaves its result in an
+ * FPU register; < and == set the FPU condition flag, which is turned
+ * into a 0/1 integer result with a short branch around the li of 0.
+ */
+void Mips::EmitFloatBinaryOp(BinaryOp::OpCode code, Location *dst,
+                             Location *op1, Location *op2)
+{
+  FloatRegister left = GetFloatRegister(op1, ForRead);
+  FloatRegister right = GetFloatRegister(op2, ForRead, left);
+  if (code != BinaryOp::Less && code != BinaryOp::Eq) {
+    Assert(floatName[code] != NULL);
+    FloatRegister result = GetFloatRegister(dst, ForWrite, left);
+    Emit("%s %s, %s, %s\t", floatName[code], fregs[result].name,
+         fregs[left].name, fregs[right].name);
+    return;
+  }
+  Emit("%s %s, %s\t", floatName[code], fregs[left].name, fregs[right].name);
+  Emit("li %s, 1", regs[rd].name);
+  Emit("bc1t _fcmp%d", nextCompareNum);
+  Emit("li %s, 0", regs[rd].name);
+  Emit("_fcmp%d:", nextCompareNum++);
+  SpillRegister(dst, rd);
+}
+
+
 /* Method: EmitLabel
  * -----------------
  * Used to emit label marker. Before a label, we spill all registers since
@@ -211,7 +400,7 @@ void Mips::EmitBinaryOp(BinaryOp::OpCode code, Location *dst,
  */
 void Mips::EmitLabel(const char *label)
 {
- 
+  SpillFloatRegisters(true);
   Emit("%s:", label);
 }
 
@@ -225,7 +414,7 @@ void Mips::EmitLabel(const char *label)
  */
 void Mips::EmitGoto(const char *label)
 {
- 
+  SpillFloatRegisters(true);
   Emit("b %s\t\t# unconditional branch", label);
 }
 
@@ -239,12 +428,49 @@ void Mips::EmitGoto(const char *label)
  */
 void Mips::EmitIfZ(Location *test, const char *label)
 {
+  SpillFloatRegisters(false);
   FillRegister(test, rs);
   Emit("beqz %s, %s\t# branch if %s is zero ", regs[rs].name, label,
 	 test->GetName());
 }
 
 
+/* Method: EmitIfCompare
+ * ---------------------
+ * Used for a fused compare-and-branch. Both operands are slaved to
+ * registers and compared directly by one of the branch pseudo-instructions
+ * (blt, bge, beq, ...), so no 0/1 result is ever stored and reloaded.
+ */
+void Mips::EmitIfCompare(IfCompare::RelOp code, Location *op1,
+                         Location *op2, const char *label)
+{
+  if (op1->IsDouble()) {
+    // the FPU only tests ==, < and <=: > and >= swap the operands,
+    // != branches on == being false
+    FloatRegister left = GetFloatRegister(op1, ForRead);
+    FloatRegister right = GetFloatRegister(op2, ForRead, left);
+    if (code == IfCompare::Greater || code == IfCompare::GreaterEq) {
+      FloatRegister swap = left;
+      left = right;
+      right = swap;
+    }
+    const char *test = (code == IfCompare::Less || code == IfCompare::Greater)? "c.lt.d"
+      : (code == IfCompare::LessEq || code == IfCompare::GreaterEq)? "c.le.d" : "c.eq.d";
+    Emit("%s %s, %s\t", test, fregs[left].name, fregs[right].name);
+    SpillFloatRegisters(false);
+    Emit("%s %s\t# branch if %s %s %s", code == IfCompare::NotEq? "bc1f" : "bc1t",
+         label, op1->GetName(), IfCompare::opToken[code], op2->GetName());
+    return;
+  }
+  SpillFloatRegisters(false);
+  FillRegister(op1, rs);
+  FillRegister(op2, rt);
+  Emit("%s %s, %s, %s\t# branch if %s %s %s", branchName[code],
+       regs[rs].name, regs[rt].name, label, op1->GetName(),
+       IfCompare::opToken[code], op2->GetName());
+}
+
+
 /* Method: EmitParam
  * -----------------
  * Used to push a parameter on the stack in anticipation of upcoming
@@ -254,6 +480,13 @@ void Mips::EmitIfZ(Location *test, const char *label)
  */
 void Mips::EmitParam(Location *arg)
 { 
+  if (arg->IsDouble()) {
+    FloatRegister reg = GetFloatRegister(arg, ForRead);
+    Emit("subu $sp, $sp, 8\t# decrement sp to make space for double param");
+    Emit("swc1 $f%d, 4($sp)\t# copy param value to stack", 2*reg);
+    Emit("swc1 $f%d, 8($sp)", 2*reg + 1);
+    return;
+  }
   Emit("subu $sp, $sp, 4\t# decrement sp to make space for param");
   FillRegister(arg, rs);
   Emit("sw %s, 4($sp)\t# copy param value to stack", regs[rs].name);
@@ -273,8 +506,13 @@ void Mips::EmitParam(Location *arg)
  */
 void Mips::EmitCallInstr(Location *result, const char *fn, bool isLabel)
 {
+  SpillFloatRegisters(true);
   Emit("%s %-15s\t# jump to function", isLabel? "jal": "jalr", fn);
-  if (result != NULL) {
+  if (result != NULL && result->IsDouble()) {
+    // double results come back in $f0
+    fregs[f0].var = result;
+    fregs[f0].isDirty = true;
+  } else if (result != NULL) {
     Emit("move %s, %s\t\t# copy function return value from $v0",
     regs[rd].name, regs[v0].name);
     SpillRegister(result, rd);
@@ -318,11 +556,22 @@ void Mips::EmitPopParams(int bytes)
  * which is to remove our locals/temps from the stack, remove
  * saved registers ($fp and $ra) and restore previous values of
  * $fp and $ra so everything is returned to the state we entered.
- * We then emit jr to jump to the saved $ra.
+ * We then emit jr to jump to the saved $ra. Returning from main ends
+ * the program, so output still buffered by the runtime is flushed first.
  */
  void Mips::EmitReturn(Location *returnVal)
 { 
-  if (returnVal != NULL) 
+  if (returnVal != NULL && returnVal->IsDouble()) {
+    FloatRegister reg = GetFloatRegister(returnVal, ForRead);
+    SpillFloatRegisters(true);
+    if (reg != f0)
+      Emit("mov.d $f0, %s\t\t# assign return value into $f0", fregs[reg].name);
+  } else {
+    SpillFloatRegisters(true);
+  }
+  if (inEntry)
+    Emit("jal _FlushOutput\t# write out buffered output before exit");
+  if (returnVal != NULL && !returnVal->IsDouble())
     {
       FillRegister(returnVal, rd);
       Emit("move $v0, %s\t\t# assign return value into $v0",
@@ -341,15 +590,21 @@ void Mips::EmitPopParams(int bytes)
  * upon entering a new function. We decrement the $sp to make space
  * and then save the current values of $fp and $ra (since we are
  * going to change them), then set up the $fp and bump the $sp down
- * to make space for all our locals/temps.
+ * to make space for all our locals/temps. The program's entry (main)
+ * also records its $fp as the top of the stack the collector scans.
  */
-void Mips::EmitBeginFunction(int stackFrameSize)
+void Mips::EmitBeginFunction(int stackFrameSize, bool isEntry)
 {
   Assert(stackFrameSize >= 0);
+  SpillFloatRegisters(true);
+  nextVictim = 0;       // so a function's code doesn't depend on the one before
   Emit("subu $sp, $sp, 8\t# decrement sp to make space to save ra, fp");
   Emit("sw $fp, 8($sp)\t# save fp");
   Emit("sw $ra, 4($sp)\t# save ra");
   Emit("addiu $fp, $sp, 8\t# set up new fp");
+  inEntry = isEntry;
+  if (isEntry)
+    Emit("sw $fp, _stack_base\t# collector scans the stack up to here");
 
   if (stackFrameSize != 0)
     Emit("subu $sp, $sp, %d\t# decrement sp to make space for locals/temps",
@@ -367,10 +622,41 @@ void Mips::EmitEndFunction()
 { 
   Emit("# (below handles reaching end of fn body with no explicit return)");
   EmitReturn(NULL);
+  inEntry = false;
 }
 
 
 
+/* Method: EmitJumpTable
+ * ---------------------
+ * value - low is compared unsigned against the number of labels, so one
+ * branch catches values on either side of the table. The table itself
+ * is added to pooledTables, which EmitJumpTables lays out at the end.
+ */
+void Mips::EmitJumpTable(Location *value, int low, const char *table,
+                         List<const char*> *labels, const char *otherwise)
+{
+  SpillFloatRegisters(true);
+  FillRegister(value, rs);
+  if (low != 0) {
+    Emit("li %s, %d\t\t# lowest case", regs[rt].name, low);
+    Emit("subu %s, %s, %s", regs[rs].name, regs[rs].name, regs[rt].name);
+  }
+  Emit("li %s, %d\t\t# number of cases", regs[rt].name, labels->NumElements());
+  Emit("bgeu %s, %s, %s\t# no case for %s", regs[rs].name, regs[rt].name,
+       otherwise, value->GetName());
+  Emit("sll %s, %s, 2", regs[rs].name, regs[rs].name);
+  Emit("lw %s, %s(%s)\t# load the label of the case", regs[rd].name, table,
+       regs[rs].name);
+  Emit("jr %s\t\t# jump to the case", regs[rd].name);
+  std::string *saved = capture;
+  capture = &pooledTables;
+  Emit("%s:\t\t# jump table", table);
+  for (int i = 0; i < labels->NumElements(); i++)
+    Emit(".word %s", labels->Nth(i));
+  capture = saved;
+}
+
 /* Method: EmitVTable
  * ------------------
  * Used to layout a vtable. Uses assembly directives to set up new
@@ -388,6 +674,73 @@ void Mips::EmitVTable(const char *label, List<const char*> *methodLabels)
 }
 
 
+/* Method: EmitGcRoots
+ * -------------------
+ * Lays out the table of global roots read by the collector in defs.asm:
+ * a count followed by the $gp offset of each global that can hold a
+ * reference into the heap.
+ */
+void Mips::EmitGcRoots(List<int> *globalOffsets)
+{
+  Emit(".data");
+  Emit(".align 2");
+  Emit("_gc_roots:\t\t# globals the collector treats as roots");
+  Emit(".word %d", globalOffsets->NumElements());
+  for (int i = 0; i < globalOffsets->NumElements(); i++)
+    Emit(".word %d", globalOffsets->Nth(i));
+  Emit(".text");
+}
+
+
+/* Method: EmitStringPool
+ * ----------------------
+ * Used at the end of the program to lay out all the string constants
+ * loaded by EmitLoadStringConstant, once each, in a single stretch of
+ * the data segment.
+ */
+void Mips::EmitStringPool()
+{
+  if (pooledStrings.NumElements() == 0) return;
+  Emit(".data\t\t\t# string constants");
+  for (int i = 0; i < pooledStrings.NumElements(); i++)
+    Emit("_string%d: .asciiz %s", i + 1, pooledStrings.Nth(i));
+  Emit(".text");
+}
+
+
+/* Method: EmitDoublePool
+ * ----------------------
+ * Used at the end of the program to lay out the double constants loaded
+ * by EmitLoadDoubleConstant, 8-byte aligned so each can be fetched with
+ * one l.d.
+ */
+void Mips::EmitDoublePool()
+{
+  if (pooledDoubles.empty()) return;
+  Emit(".data\t\t\t# double constants");
+  Emit(".align 3");
+  for (size_t i = 0; i < pooledDoubles.size(); i++)
+    Emit("_double%d: .double %.17g", (int)i + 1, pooledDoubles[i]);
+  Emit(".text");
+}
+
+
+/* Method: EmitJumpTables
+ * ----------------------
+ * Used at the end of the program to lay out the jump tables made by
+ * EmitJumpTable, together in one stretch of the data segment.
+ */
+void Mips::EmitJumpTables()
+{
+  if (pooledTables.empty()) return;
+  Emit(".data\t\t\t# jump tables");
+  Emit(".align 2");
+  if (capture) capture->append(pooledTables);
+  else fputs(pooledTables.c_str(), stdout);
+  Emit(".text");
+}
+
+
 /* Method: EmitPreamble
  * --------------------
  * Used to emit the starting sequence needed for a program. Not much
@@ -432,6 +785,28 @@ Mips::Mips() {
   mipsName[BinaryOp::Less] = "slt";
   mipsName[BinaryOp::And] = "and";
   mipsName[BinaryOp::Or] = "or";
+  branchName[IfCompare::Eq] = "beq";
+  branchName[IfCompare::NotEq] = "bne";
+  branchName[IfCompare::Less] = "blt";
+  branchName[IfCompare::LessEq] = "ble";
+  branchName[IfCompare::Greater] = "bgt";
+  branchName[IfCompare::GreaterEq] = "bge";
+  floatName[BinaryOp::Add] = "add.d";
+  floatName[BinaryOp::Sub] = "sub.d";
+  floatName[BinaryOp::Mul] = "mul.d";
+  floatName[BinaryOp::Div] = "div.d";
+  floatName[BinaryOp::Eq] = "c.eq.d";
+  floatName[BinaryOp::Less] = "c.lt.d";
+  static const char *fregName[NumFloatRegs] =
+    {"$f0", "$f2", "$f4", "$f6", "$f8", "$f10", "$f12", "$f14",
+     "$f16", "$f18", "$f20", "$f22", "$f24", "$f26", "$f28", "$f30"};
+  for (int i = 0; i < NumFloatRegs; i++)
+    fregs[i] = (FloatRegContents){false, NULL, fregName[i]};
+  nextVictim = 0;
+  inEntry = false;
+  usedStrings = NULL;
+  usedDoubles = NULL;
+  nextCompareNum = 1;
   regs[zero] = (RegContents){false, NULL, "$zero", false};
   regs[at] = (RegContents){false, NULL, "$at", false};
   regs[v0] = (RegContents){false, NULL, "$v0", false};
@@ -468,5 +843,7 @@ Mips::Mips() {
 
 }
 const char *Mips::mipsName[BinaryOp::NumOps];
+const char *Mips::branchName[IfCompare::NumRelOps];
+const char *Mips::floatName[BinaryOp::NumOps];
 
 
@@ -18,6 +18,9 @@
 #ifndef _H_mips
 #define _H_mips
 
+#include <map>
+#include <string>
+#include <vector>
 #include "tac.h"
 #include "list.h"
 class Location;
@@ -39,28 +42,87 @@ class Mips {
 
     Register rs, rt, rd;
 
+      // Doubles live in the even/odd FPU register pairs, named by the
+      // even half. Unlike the integer registers these are allocated
+      // across instructions: a double stays in its register until the
+      // end of the basic block or until the register is needed again.
+    typedef enum {f0, f2, f4, f6, f8, f10, f12, f14,
+                  f16, f18, f20, f22, f24, f26, f28, f30,
+                  NumFloatRegs } FloatRegister;
+
+    struct FloatRegContents {
+	bool isDirty;
+	Location *var;
+	const char *name;
+    } fregs[NumFloatRegs];
+    int nextVictim;
+
     typedef enum { ForRead, ForWrite } Reason;
     
     void FillRegister(Location *src, Register reg);
     void SpillRegister(Location *dst, Register reg);
 
+    FloatRegister GetFloatRegister(Location *var, Reason reason,
+                                   FloatRegister avoid = NumFloatRegs);
+    void FillFloatRegister(Location *src, FloatRegister reg);
+    void SpillFloatRegister(FloatRegister reg);
+    void SpillFloatRegisters(bool discard);
+    void EmitFloatBinaryOp(BinaryOp::OpCode code, Location *dst,
+                           Location *op1, Location *op2);
+
     void EmitCallInstr(Location *dst, const char *fn, bool isL);
     
     static const char *mipsName[BinaryOp::NumOps];
     static const char *NameForTac(BinaryOp::OpCode code);
+    static const char *branchName[IfCompare::NumRelOps];
+    static const char *floatName[BinaryOp::NumOps];
+
+      // String literals by contents (quotes included, as in the
+      // source), each labeled once and emitted by EmitStringPool
+    std::map<std::string, int> stringLabels;
+    List<const char*> pooledStrings;
+      // Double constants by bit pattern, likewise labeled once and
+      // emitted by EmitDoublePool
+    std::map<unsigned long long, int> doubleLabels;
+    std::vector<double> pooledDoubles;
+
+    bool inEntry;       // emitting main, whose return ends the program
+
+      // Strings and doubles loaded while usedStrings and usedDoubles
+      // are set, in first-load order
+    std::vector<std::string> *usedStrings;
+    std::vector<double> *usedDoubles;
 
     Instruction* currentInstruction;
  public:
     Mips();
 
     static void Emit(const char *fmt, ...);
+
+      // Support for the compilation cache (cache.cc). While capture is
+      // set, Emit appends to it instead of printing. The number of the
+      // next _fcmp label is kept here so the cache can relocate code it
+      // saved and move it past what it splices in.
+    static std::string *capture;
+    int nextCompareNum;
+      // The jump tables emitted so far, as text for EmitJumpTables. The
+      // cache keeps what each function adds and appends it when reused.
+    std::string pooledTables;
+    void NoteStrings(std::vector<std::string> *used) { usedStrings = used; }
+    void NoteDoubles(std::vector<double> *used) { usedDoubles = used; }
+         // The number of str's _string label, pooling it if it's new
+    int InternString(const char *str);
+         // The number of val's _double label, pooling it if it's new
+    int InternDouble(double val);
     
     void EmitLoadConstant(Location *dst, int val);
     void EmitLoadStringConstant(Location *dst, const char *str);
+    void EmitLoadDoubleConstant(Location *dst, double val);
     void EmitLoadLabel(Location *dst, const char *label);
 
     void EmitLoad(Location *dst, Location *reference, int offset);
     void EmitStore(Location *reference, Location *value, int offset);
+    void EmitBoundsCheck(Location *array, Location *index);
     void EmitCopy(Location *dst, Location *src);
 
     void EmitBinaryOp(BinaryOp::OpCode code, Location *dst, 
@@ -69,9 +131,13 @@ class Mips {
     void EmitLabel(const char *label);
     void EmitGoto(const char *label);
     void EmitIfZ(Location *test, const char*label);
+    void EmitIfCompare(IfCompare::RelOp code, Location *op1, Location *op2,
+                       const char *label);
+    void EmitJumpTable(Location *value, int low, const char *table,
+                       List<const char*> *labels, const char *otherwise);
     void EmitReturn(Location *returnVal);
 
-    void EmitBeginFunction(int frameSize);
+    void EmitBeginFunction(int frameSize, bool isEntry = false);
     void EmitEndFunction();
 
     void EmitParam(Location *arg);
@@ -80,6 +146,10 @@ class Mips {
     void EmitPopParams(int bytes);
 
     void EmitVTable(const char *label, List<const char*> *methodLabels);
+    void EmitGcRoots(List<int> *globalOffsets);
+    void EmitStringPool();
+    void EmitDoublePool();
+    void EmitJumpTables();
 
     void EmitPreamble();
 
@@ -99,17 +99,18 @@ Program   :    DeclList            {
                                       @1;
                                       Program *program = new Program($1);
                                       // if no errors, advance to next phase
+                                      if (ReportError::NumErrors() == 0)
+                                          program->Declare();
                                       if (ReportError::NumErrors() == 0)
                                           program->Check();
                                       if (ReportError::NumErrors() == 0)
-                                          program->Declare();
                                           program->Emit();
                                     }
           ;
 
 
-DeclList  :    DeclList Decl        { ($$=$1)->Append($2); }
-          |    Decl                 { ($$ = new List<Decl*>)->Append($1); }
+DeclList  :    DeclList Decl        { ($$=$1)->Append($2); $2->SetSpan(@2); }
+          |    Decl                 { ($$ = new List<Decl*>)->Append($1); $1->SetSpan(@1); }
           ;
 
 Decl      :    ClassDecl
@@ -127,9 +128,7 @@ Variable  :    Type T_Identifier    { $$ = new VarDecl(new Identifier(@2, $2), $
 Type      :    T_Int                { $$ = Type::intType; }
           |    T_Bool               { $$ = Type::boolType; }
           |    T_String             { $$ = Type::stringType; }
-          |    T_Double
-                                    { ReportError::Formatted(&@1, "No code gen for doubles");
-                                      $$ = Type::errorType; }
+          |    T_Double             { $$ = Type::doubleType; }
           |    T_Identifier         { $$ = new NamedType(new Identifier(@1,$1)); }
           |    Type T_Dims          { $$ = new ArrayType(Join(@1, @2), $1); }
           ;
@@ -186,7 +185,8 @@ FormalList:    FormalList ',' Variable
           |    Variable             { ($$ = new List<VarDecl*>)->Append($1); }
           ;
 
-FnDecl    :    FnHeader StmtBlock   { ($$=$1)->SetFunctionBody($2); }
+FnDecl    :    FnHeader             { Node::BeginBody(); }
+               StmtBlock            { ($$=$1)->SetFunctionBody($3, Node::EndBody()); }
           ;
 
 StmtBlock :    '{' VarDecls StmtList '}'
@@ -268,10 +268,7 @@ Expr      :    LValue               { $$ = $1; }
 
 Constant  :    T_IntConstant        { $$ = new IntConstant(@1,$1); }
           |    T_BoolConstant       { $$ = new BoolConstant(@1,$1); }
-          |    T_DoubleConstant
-
-                                    { ReportError::Formatted(&@1, "No code gen for doubles");
-                                      $$ = new IntConstant(@1,$1); }
+          |    T_DoubleConstant     { $$ = new DoubleConstant(@1,$1); }
           |    T_StringConstant     { $$ = new StringConstant(@1,$1); }
           |    T_Null               { $$ = new NullConstant(@1); }
           ;
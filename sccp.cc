@@ -0,0 +1,359 @@
+/* File: sccp.cc
+ * -------------
+ * Optimizations on a function in SSA form.
+ *
+ * PropagateConstants is Wegman and Zadeck's sparse conditional constant
+ * propagation: values start unknown (Top), and only instructions in
+ * blocks found executable, and phi sources along executable edges, can
+ * lower them to a constant or to Bottom. A branch on a constant makes
+ * only one of its edges executable, so code behind a branch that always
+ * goes the other way never counts against a value. Afterwards constant
+ * results are loaded directly, constant branches become a Goto or
+ * disappear, and blocks never found executable are emptied.
+ *
+ * PropagateCopies replaces each use of a copy (or of a phi whose sources
+ * are all one Location) by the Location copied, which is safe in SSA
+ * form since neither is written again. RemoveDeadCode then deletes the
+ * copies and other side-effect free instructions left without uses.
+ */
+
+#include "ssa.h"
+#include "cfg.h"
+#include "codegen.h"
+#include <limits.h>
+#include <string.h>
+
+typedef std::list<Instruction*>::iterator Iter;
+typedef std::pair<BasicBlock*, BasicBlock*> Edge;
+
+struct Value {
+  enum { Top, Constant, Bottom } kind;
+  int constant;
+};
+
+static bool Fold(BinaryOp::OpCode code, int a, int b, int *result)
+{
+  switch (code) {
+    case BinaryOp::Add: *result = (int)((unsigned)a + (unsigned)b); return true;
+    case BinaryOp::Sub: *result = (int)((unsigned)a - (unsigned)b); return true;
+    case BinaryOp::Mul: *result = (int)((unsigned)a * (unsigned)b); return true;
+    case BinaryOp::Div:
+    case BinaryOp::Mod:
+      if (b == 0 || (a == INT_MIN && b == -1)) return false;
+      *result = (code == BinaryOp::Div) ? a / b : a % b;
+      return true;
+    case BinaryOp::Eq:   *result = (a == b); return true;
+    case BinaryOp::Less: *result = (a < b); return true;
+    case BinaryOp::And:  *result = a & b; return true;
+    case BinaryOp::Or:   *result = a | b; return true;
+    default: return false;
+  }
+}
+
+static bool Compare(IfCompare::RelOp code, int a, int b)
+{
+  switch (code) {
+    case IfCompare::Eq:      return a == b;
+    case IfCompare::NotEq:   return a != b;
+    case IfCompare::Less:    return a < b;
+    case IfCompare::LessEq:  return a <= b;
+    case IfCompare::Greater: return a > b;
+    default:                 return a >= b;
+  }
+}
+
+
+class ConstantPropagator {
+  private:
+    SSAForm *ssa;
+    std::vector<BasicBlock*> &blocks;
+    std::map<Location*, Value> values;
+    std::map<Location*, std::vector<std::pair<Instruction*, BasicBlock*> > > uses;
+    std::set<BasicBlock*> executable;
+    std::set<Edge> edges;
+    std::vector<Edge> flowWork;
+    std::vector<std::pair<Instruction*, BasicBlock*> > ssaWork;
+
+    Value ValueOf(Location *loc);
+    void Lower(Location *loc, Value v);
+    int Decide(Instruction *branch);
+    BasicBlock *Target(BasicBlock *b);
+    BasicBlock *Next(BasicBlock *b);
+    void VisitExits(BasicBlock *b);
+    void Visit(Instruction *instr, BasicBlock *b);
+    void Rewrite();
+
+  public:
+    ConstantPropagator(SSAForm *s);
+    void Run();
+};
+
+ConstantPropagator::ConstantPropagator(SSAForm *s)
+  : ssa(s), blocks(s->Graph()->Blocks())
+{
+  Value top = { Value::Top, 0 };
+  for (int i = 0; i < (int)blocks.size(); i++)
+    for (Iter p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p) {
+      if (SSAForm::IsRenamed((*p)->GetDst())) values[(*p)->GetDst()] = top;
+      for (int s = 0; s < (*p)->NumSrcs(); s++)
+        uses[(*p)->GetSrc(s)].push_back(std::make_pair(*p, blocks[i]));
+    }
+}
+
+//anything never written here (a global, or a variable's entry value) is
+//Bottom
+Value ConstantPropagator::ValueOf(Location *loc)
+{
+  std::map<Location*, Value>::iterator found = values.find(loc);
+  if (found != values.end()) return found->second;
+  Value bottom = { Value::Bottom, 0 };
+  return bottom;
+}
+
+void ConstantPropagator::Lower(Location *loc, Value v)
+{
+  Value old = ValueOf(loc);
+  if (old.kind == v.kind && (v.kind != Value::Constant || old.constant == v.constant))
+    return;
+  if (old.kind == Value::Constant && v.kind == Value::Constant)
+    v.kind = Value::Bottom;       // two different constants
+  values[loc] = v;
+  std::vector<std::pair<Instruction*, BasicBlock*> > &users = uses[loc];
+  for (int i = 0; i < (int)users.size(); i++)
+    if (executable.count(users[i].second)) ssaWork.push_back(users[i]);
+}
+
+//1 if the branch is taken, 0 if not, -1 if not known yet, 2 if it can go
+//either way
+int ConstantPropagator::Decide(Instruction *branch)
+{
+  if (IfZ *test = dynamic_cast<IfZ*>(branch)) {
+    Value v = ValueOf(test->GetSrc(0));
+    if (v.kind == Value::Top) return -1;
+    if (v.kind == Value::Bottom) return 2;
+    return v.constant == 0;
+  }
+  if (IfCompare *cmp = dynamic_cast<IfCompare*>(branch)) {
+    Value a = ValueOf(cmp->GetSrc(0)), b = ValueOf(cmp->GetSrc(1));
+    if (a.kind == Value::Bottom || b.kind == Value::Bottom || cmp->GetSrc(0)->IsDouble())
+      return 2;
+    if (a.kind == Value::Top || b.kind == Value::Top) return -1;
+    return Compare(cmp->GetRelOp(), a.constant, b.constant);
+  }
+  return 1;   // Goto
+}
+
+BasicBlock *ConstantPropagator::Target(BasicBlock *b)
+{
+  const char *label = b->GetTerminator()->branch_label();
+  for (int i = 0; i < (int)b->succs.size(); i++) {
+    const char *l = b->succs[i]->GetLabel();
+    if (l && !strcmp(l, label)) return b->succs[i];
+  }
+  return NULL;
+}
+
+BasicBlock *ConstantPropagator::Next(BasicBlock *b)
+{
+  if (!b->FallsThrough() || b->id + 1 >= (int)blocks.size()) return NULL;
+  return blocks[b->id + 1];
+}
+
+void ConstantPropagator::VisitExits(BasicBlock *b)
+{
+  Instruction *last = b->GetTerminator();
+  BasicBlock *next = Next(b);
+  if (!last || !last->branch_label()) {
+    if (next) flowWork.push_back(Edge(b, next));
+    return;
+  }
+  int taken = Decide(last);
+  BasicBlock *target = Target(b);
+  if ((taken == 1 || taken == 2) && target) flowWork.push_back(Edge(b, target));
+  if ((taken == 0 || taken == 2) && next) flowWork.push_back(Edge(b, next));
+}
+
+void ConstantPropagator::Visit(Instruction *instr, BasicBlock *b)
+{
+  if (instr == b->GetTerminator()) {
+    VisitExits(b);
+    return;
+  }
+  Location *dst = instr->GetDst();
+  if (!SSAForm::IsRenamed(dst)) return;
+  Value v = { Value::Bottom, 0 };
+  if (Phi *phi = dynamic_cast<Phi*>(instr)) {
+    v.kind = Value::Top;
+    for (int k = 0; k < phi->NumSrcs() && v.kind != Value::Bottom; k++) {
+      if (!edges.count(Edge(ssa->PhiPred(phi, k), b))) continue;
+      Value arg = ValueOf(phi->GetSrc(k));
+      if (arg.kind == Value::Top) continue;
+      if (v.kind == Value::Top || arg.kind == Value::Bottom) v = arg;
+      else if (arg.constant != v.constant) v.kind = Value::Bottom;
+    }
+  } else if (LoadConstant *load = dynamic_cast<LoadConstant*>(instr)) {
+    v.kind = Value::Constant;
+    v.constant = load->GetValue();
+  } else if (dynamic_cast<Assign*>(instr)) {
+    v = ValueOf(instr->GetSrc(0));
+  } else if (BinaryOp *op = dynamic_cast<BinaryOp*>(instr)) {
+    Value a = ValueOf(op->GetSrc(0)), c = ValueOf(op->GetSrc(1));
+    if (a.kind == Value::Top || c.kind == Value::Top) {
+      if (a.kind != Value::Bottom && c.kind != Value::Bottom) return;
+    } else if (a.kind == Value::Constant && c.kind == Value::Constant
+               && Fold(op->GetOpCode(), a.constant, c.constant, &v.constant)) {
+      v.kind = Value::Constant;
+    }
+  }
+  Lower(dst, v);
+}
+
+void ConstantPropagator::Run()
+{
+  flowWork.push_back(Edge(NULL, blocks.front()));
+  while (!flowWork.empty() || !ssaWork.empty()) {
+    if (!flowWork.empty()) {
+      Edge edge = flowWork.back();
+      flowWork.pop_back();
+      if (edges.count(edge)) continue;
+      edges.insert(edge);
+      BasicBlock *b = edge.second;
+      bool first = !executable.count(b);
+      executable.insert(b);
+      for (Iter p = b->code.begin(); p != b->code.end(); ++p)
+        if (first || dynamic_cast<Phi*>(*p)) Visit(*p, b);
+      if (first && !b->GetTerminator()) VisitExits(b);
+    } else {
+      std::pair<Instruction*, BasicBlock*> work = ssaWork.back();
+      ssaWork.pop_back();
+      Visit(work.first, work.second);
+    }
+  }
+  Rewrite();
+}
+
+void ConstantPropagator::Rewrite()
+{
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    BasicBlock *b = blocks[i];
+    if (!executable.count(b)) {
+      Iter first = b->code.begin();
+      if (first != b->code.end() && dynamic_cast<Label*>(*first)) ++first;
+      b->code.erase(first, b->code.end());
+      ssa->MarkDead(b);
+      continue;
+    }
+    Iter p = b->code.begin();
+    while (p != b->code.end()) {
+      Instruction *instr = *p;
+      Value v = ValueOf(instr->GetDst());
+      if (instr->GetDst() && v.kind == Value::Constant
+          && (dynamic_cast<Phi*>(instr) || dynamic_cast<Assign*>(instr)
+              || dynamic_cast<BinaryOp*>(instr))) {
+        *p = new LoadConstant(instr->GetDst(), v.constant);
+      } else if (instr->branch_label() && instr->FallsThrough()) {
+        int taken = Decide(instr);
+        if (taken == 1 && Target(b) != Next(b)) {
+          *p = new Goto(instr->branch_label());
+        } else if (taken == 0 || taken == 1) {
+          p = b->code.erase(p);
+          continue;
+        }
+      }
+      ++p;
+    }
+  }
+}
+
+
+void PropagateConstants(SSAForm *ssa)
+{
+  ConstantPropagator propagator(ssa);
+  propagator.Run();
+}
+
+
+static Location *Resolve(std::map<Location*, Location*> &copyOf, Location *loc)
+{
+  for (int steps = 0; copyOf.count(loc) && steps < (int)copyOf.size(); steps++)
+    loc = copyOf[loc];
+  return loc;
+}
+
+void PropagateCopies(SSAForm *ssa)
+{
+  std::vector<BasicBlock*> &blocks = ssa->Graph()->Blocks();
+  std::map<Location*, Location*> copyOf;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < (int)blocks.size(); i++)
+      for (Iter p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p) {
+        Location *dst = (*p)->GetDst();
+        if (!SSAForm::IsRenamed(dst) || copyOf.count(dst)) continue;
+        Location *from = NULL;
+        if (dynamic_cast<Assign*>(*p)) {
+          from = Resolve(copyOf, (*p)->GetSrc(0));
+        } else if (dynamic_cast<Phi*>(*p)) {
+          for (int k = 0; k < (*p)->NumSrcs(); k++) {
+            Location *arg = Resolve(copyOf, (*p)->GetSrc(k));
+            if (arg == dst || arg == from) continue;
+            if (from) {
+              from = NULL;
+              break;
+            }
+            from = arg;
+          }
+        }
+        if (from && from != dst && SSAForm::IsRenamed(from)
+            && from->IsDouble() == dst->IsDouble()) {
+          copyOf[dst] = from;
+          changed = true;
+        }
+      }
+  }
+  for (int i = 0; i < (int)blocks.size(); i++)
+    for (Iter p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p)
+      for (int s = 0; s < (*p)->NumSrcs(); s++) {
+        Location *to = Resolve(copyOf, (*p)->GetSrc(s));
+        if (to != (*p)->GetSrc(s)) (*p)->SetSrc(s, to);
+      }
+}
+
+
+static bool HasNoSideEffect(Instruction *instr)
+{
+  if (BinaryOp *op = dynamic_cast<BinaryOp*>(instr))
+    return op->GetOpCode() != BinaryOp::Div && op->GetOpCode() != BinaryOp::Mod;
+  return dynamic_cast<Assign*>(instr) || dynamic_cast<Phi*>(instr)
+      || dynamic_cast<LoadConstant*>(instr) || dynamic_cast<LoadDoubleConstant*>(instr)
+      || dynamic_cast<LoadStringConstant*>(instr) || dynamic_cast<LoadLabel*>(instr);
+}
+
+void RemoveDeadCode(SSAForm *ssa)
+{
+  std::vector<BasicBlock*> &blocks = ssa->Graph()->Blocks();
+  std::map<Location*, int> numUses;
+  for (int i = 0; i < (int)blocks.size(); i++)
+    for (Iter p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p)
+      for (int s = 0; s < (*p)->NumSrcs(); s++)
+        numUses[(*p)->GetSrc(s)]++;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < (int)blocks.size(); i++) {
+      Iter p = blocks[i]->code.begin();
+      while (p != blocks[i]->code.end()) {
+        Location *dst = (*p)->GetDst();
+        if (!SSAForm::IsRenamed(dst) || numUses[dst] > 0 || !HasNoSideEffect(*p)) {
+          ++p;
+          continue;
+        }
+        for (int s = 0; s < (*p)->NumSrcs(); s++)
+          numUses[(*p)->GetSrc(s)]--;
+        p = blocks[i]->code.erase(p);
+        changed = true;
+      }
+    }
+  }
+}
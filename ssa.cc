@@ -0,0 +1,452 @@
+/* File: ssa.cc
+ * ------------
+ * Implementation of SSA construction (Cytron et al., phis on the
+ * iterated dominance frontier of each variable used across blocks,
+ * renaming along the dominator tree) and destruction (copies for the
+ * phis, then coalescing over an interference graph).
+ */
+
+#include "ssa.h"
+#include "cfg.h"
+#include "codegen.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+typedef std::list<Instruction*>::iterator Iter;
+typedef std::pair<Location*, Location*> Copy;     // dst, src
+
+SSAForm::SSAForm(FlowGraph *g, BeginFunc *f, CodeGenerator *c)
+  : graph(g), func(f), gen(c), nextVersion(0) {}
+
+bool SSAForm::IsRenamed(Location *loc)
+{
+  return loc != NULL && loc->GetSegment() == fpRelative && !loc->GetBase();
+}
+
+//a version shares its variable's slot until Destroy says otherwise
+Location *SSAForm::NewVersion(Location *var)
+{
+  char name[64];
+  snprintf(name, sizeof(name), "%s.%d", var->GetName(), ++nextVersion);
+  Location *version = new Location(fpRelative, var->GetOffset(), name);
+  version->SetType(var->GetType());
+  original[version] = var;
+  return version;
+}
+
+static Iter FirstInstruction(BasicBlock *b)
+{
+  Iter p = b->code.begin();
+  while (p != b->code.end() && (dynamic_cast<Label*>(*p) || dynamic_cast<Phi*>(*p)))
+    ++p;
+  return p;
+}
+
+void SSAForm::PlacePhis()
+{
+  std::vector<Location*> global;          // used in some block before its def there
+  std::set<Location*> isGlobal;
+  std::map<Location*, std::vector<BasicBlock*> > defBlocks;
+  std::vector<BasicBlock*> &rpo = graph->ReversePostorder();
+  for (int i = 0; i < (int)rpo.size(); i++) {
+    std::set<Location*> defined;
+    for (Iter p = rpo[i]->code.begin(); p != rpo[i]->code.end(); ++p) {
+      for (int s = 0; s < (*p)->NumSrcs(); s++) {
+        Location *src = (*p)->GetSrc(s);
+        if (IsRenamed(src) && !defined.count(src) && !isGlobal.count(src)) {
+          isGlobal.insert(src);
+          global.push_back(src);
+        }
+      }
+      Location *dst = (*p)->GetDst();
+      if (IsRenamed(dst) && !defined.count(dst)) {
+        defined.insert(dst);
+        defBlocks[dst].push_back(rpo[i]);
+      }
+    }
+  }
+
+  for (int v = 0; v < (int)global.size(); v++) {
+    Location *var = global[v];
+    std::vector<BasicBlock*> work = defBlocks[var];
+    std::set<BasicBlock*> queued(work.begin(), work.end()), hasPhi;
+    while (!work.empty()) {
+      BasicBlock *b = work.back();
+      work.pop_back();
+      for (int f = 0; f < (int)b->frontier.size(); f++) {
+        BasicBlock *join = b->frontier[f];
+        if (hasPhi.count(join)) continue;
+        hasPhi.insert(join);
+        std::vector<BasicBlock*> preds;
+        for (int k = 0; k < (int)join->preds.size(); k++)
+          if (join->preds[k]->reachable) preds.push_back(join->preds[k]);
+        Phi *phi = new Phi(var, preds.size());
+        phiVar[phi] = var;
+        phiPreds[phi] = preds;
+        Iter at = join->code.begin();
+        if (at != join->code.end() && dynamic_cast<Label*>(*at)) ++at;
+        join->code.insert(at, phi);
+        if (!queued.count(join)) {
+          queued.insert(join);
+          work.push_back(join);
+        }
+      }
+    }
+  }
+}
+
+void SSAForm::Rename(BasicBlock *b, std::map<Location*, std::vector<Location*> > &stacks)
+{
+  std::vector<Location*> pushed;
+  for (Iter p = b->code.begin(); p != b->code.end(); ++p) {
+    Instruction *instr = *p;
+    Phi *phi = dynamic_cast<Phi*>(instr);
+    if (!phi) {
+      for (int s = 0; s < instr->NumSrcs(); s++) {
+        std::vector<Location*> &stack = stacks[instr->GetSrc(s)];
+        if (IsRenamed(instr->GetSrc(s)) && !stack.empty())
+          instr->SetSrc(s, stack.back());
+      }
+    }
+    Location *dst = instr->GetDst();
+    if (IsRenamed(dst)) {
+      Location *var = phi ? phiVar[phi] : dst;
+      Location *version = NewVersion(var);
+      instr->SetDst(version);
+      stacks[var].push_back(version);
+      pushed.push_back(var);
+    }
+  }
+  for (int s = 0; s < (int)b->succs.size(); s++) {
+    BasicBlock *succ = b->succs[s];
+    for (Iter p = succ->code.begin(); p != FirstInstruction(succ); ++p) {
+      Phi *phi = dynamic_cast<Phi*>(*p);
+      if (!phi) continue;
+      std::vector<BasicBlock*> &preds = phiPreds[phi];
+      std::vector<Location*> &stack = stacks[phiVar[phi]];
+      for (int k = 0; k < (int)preds.size(); k++)
+        if (preds[k] == b)
+          phi->SetSrc(k, stack.empty() ? phiVar[phi] : stack.back());
+    }
+  }
+  for (int c = 0; c < (int)b->domChildren.size(); c++)
+    Rename(b->domChildren[c], stacks);
+  for (int i = 0; i < (int)pushed.size(); i++)
+    stacks[pushed[i]].pop_back();
+}
+
+/* Method: Build
+ * -------------
+ * Blocks that can't be reached have no place in the dominator tree, so
+ * their code (all but a leading label) is dropped first.
+ */
+void SSAForm::Build()
+{
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    if (blocks[i]->reachable) continue;
+    Iter first = blocks[i]->code.begin();
+    if (first != blocks[i]->code.end() && dynamic_cast<Label*>(*first)) ++first;
+    blocks[i]->code.erase(first, blocks[i]->code.end());
+    dead.insert(blocks[i]);
+  }
+  PlacePhis();
+  std::map<Location*, std::vector<Location*> > stacks;
+  Rename(graph->Entry(), stacks);
+}
+
+
+/* The copies of one edge happen at once: a destination may still be
+ * needed as the source of another copy, so copies are emitted once
+ * nothing else reads their destination, and a cycle (a swap) is broken
+ * by saving one destination in a temp first.
+ */
+static void Sequentialize(std::vector<Copy> copies, CodeGenerator *gen,
+                          std::list<Instruction*> &out)
+{
+  while (!copies.empty()) {
+    bool emitted = false;
+    for (int i = 0; i < (int)copies.size() && !emitted; i++) {
+      bool read = false;
+      for (int j = 0; j < (int)copies.size(); j++)
+        if (j != i && copies[j].second == copies[i].first) read = true;
+      if (read) continue;
+      out.push_back(new Assign(copies[i].first, copies[i].second));
+      copies.erase(copies.begin() + i);
+      emitted = true;
+    }
+    if (emitted) continue;
+    Location *dst = copies[0].first;
+    Location *temp = gen->GenTempVar(dst->GetType());
+    out.push_back(new Assign(temp, dst));
+    for (int j = 0; j < (int)copies.size(); j++)
+      if (copies[j].second == dst) copies[j].second = temp;
+  }
+}
+
+/* Method: InsertCopies
+ * --------------------
+ * The copies go at the end of from when it has no other successor. On a
+ * critical edge they get a block of their own: right after from when the
+ * edge is its fall through, otherwise at the end of the function (after a
+ * Return for a last block that would have run off the end).
+ */
+void SSAForm::InsertCopies(BasicBlock *from, BasicBlock *to, std::vector<Copy> &copies)
+{
+  std::list<Instruction*> seq;
+  Sequentialize(copies, gen, seq);
+  Instruction *last = from->GetTerminator();
+  bool conditional = last && last->branch_label() && last->FallsThrough();
+  if (from->succs.size() == 1 && !conditional) {
+    Iter at = from->code.end();
+    if (last) --at;
+    from->code.splice(at, seq);
+    return;
+  }
+
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  bool fallsInto = from->FallsThrough() && from->id + 1 < (int)blocks.size()
+                   && blocks[from->id + 1] == to;
+  const char *label = gen->NewLabel();
+  BasicBlock *split;
+  if (fallsInto) {
+    split = graph->InsertBlock(from->id + 1);
+    split->code.push_back(new Label(label));
+    split->code.splice(split->code.end(), seq);
+  } else {
+    if (blocks.back()->FallsThrough())
+      blocks.back()->code.push_back(new Return(NULL));
+    split = graph->InsertBlock(blocks.size());
+    split->code.push_back(new Label(label));
+    split->code.splice(split->code.end(), seq);
+    split->code.push_back(new Goto(to->GetLabel()));
+    jumps.push_back(std::make_pair(split, last));
+  }
+  if (last && last->branch_label() && to->GetLabel()
+      && !strcmp(last->branch_label(), to->GetLabel()))
+    last->SetBranchLabel(label);
+}
+
+//an edge block whose copies all coalesced away is only a jump: the
+//branch goes straight to its target again
+void SSAForm::RemoveEmptyJumps()
+{
+  for (int i = 0; i < (int)jumps.size(); i++) {
+    BasicBlock *split = jumps[i].first;
+    Goto *jump = dynamic_cast<Goto*>(split->GetTerminator());
+    if (split->code.size() != 2 || !jump) continue;
+    jumps[i].second->SetBranchLabel(jump->branch_label());
+    split->code.clear();
+  }
+  jumps.clear();
+}
+
+void SSAForm::Destroy()
+{
+  CodeGenerator::ResetStackFrame(CodeGenerator::OffsetToFirstLocal - func->GetFrameSize());
+  graph->Analyze();
+  std::vector<std::pair<BasicBlock*, BasicBlock*> > edges;
+  std::map<std::pair<BasicBlock*, BasicBlock*>, std::vector<Copy> > copies;
+  std::vector<BasicBlock*> blocks = graph->Blocks();
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    BasicBlock *b = blocks[i];
+    Iter p = b->code.begin();
+    while (p != b->code.end()) {
+      // constant propagation may have left loads among the phis
+      Phi *phi = dynamic_cast<Phi*>(*p);
+      if (!phi) {
+        ++p;
+        continue;
+      }
+      for (int k = 0; k < phi->NumSrcs(); k++) {
+        BasicBlock *pred = phiPreds[phi][k];
+        if (dead.count(pred) || phi->GetSrc(k) == phi->GetDst()
+            || std::find(b->preds.begin(), b->preds.end(), pred) == b->preds.end())
+          continue;
+        std::pair<BasicBlock*, BasicBlock*> edge(pred, b);
+        if (!copies.count(edge)) edges.push_back(edge);
+        copies[edge].push_back(Copy(phi->GetDst(), phi->GetSrc(k)));
+      }
+      p = b->code.erase(p);
+    }
+  }
+  for (int e = 0; e < (int)edges.size(); e++)
+    InsertCopies(edges[e].first, edges[e].second, copies[edges[e]]);
+  graph->Analyze();
+  Coalesce();
+  RemoveEmptyJumps();
+  func->SetFrameSize(CodeGenerator::FrameSize());
+  graph->Analyze();
+}
+
+
+static int Find(std::vector<int> &parent, int i)
+{
+  while (parent[i] != i) i = parent[i] = parent[parent[i]];
+  return i;
+}
+
+struct Candidate {
+  Assign *copy;
+  int depth;
+};
+
+static bool Deeper(const Candidate &a, const Candidate &b)
+{
+  return a.depth > b.depth;
+}
+
+/* Method: Coalesce
+ * ----------------
+ * Two Locations interfere when one is written while the other is live
+ * (except at a copy between them), or when both hold values on entry to
+ * the function. Copies are considered innermost loop first and join the
+ * classes of their operands when nothing in one class interferes with
+ * the other. A class keeps the slot of a variable in it (one live on
+ * entry if there is one), else of a variable one of its versions came
+ * from that no other class has; only what's left gets a new temp.
+ */
+void SSAForm::Coalesce()
+{
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  std::map<Location*, int> index;
+  std::vector<Location*> locs;
+  for (int i = 0; i < (int)blocks.size(); i++)
+    for (Iter p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p) {
+      Instruction *instr = *p;
+      for (int s = -1; s < instr->NumSrcs(); s++) {
+        Location *loc = (s < 0) ? instr->GetDst() : instr->GetSrc(s);
+        if (IsRenamed(loc) && !index.count(loc)) {
+          index[loc] = locs.size();
+          locs.push_back(loc);
+        }
+      }
+    }
+  int n = locs.size(), nb = blocks.size();
+
+  std::vector<std::vector<bool> > liveIn(nb, std::vector<bool>(n)), liveOut = liveIn;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = nb - 1; i >= 0; i--) {
+      std::vector<bool> live(n);
+      for (int s = 0; s < (int)blocks[i]->succs.size(); s++) {
+        std::vector<bool> &in = liveIn[blocks[i]->succs[s]->id];
+        for (int k = 0; k < n; k++) if (in[k]) live[k] = true;
+      }
+      liveOut[i] = live;
+      for (std::list<Instruction*>::reverse_iterator p = blocks[i]->code.rbegin();
+           p != blocks[i]->code.rend(); ++p) {
+        Location *dst = (*p)->GetDst();
+        if (IsRenamed(dst)) live[index[dst]] = false;
+        for (int s = 0; s < (*p)->NumSrcs(); s++)
+          if (IsRenamed((*p)->GetSrc(s))) live[index[(*p)->GetSrc(s)]] = true;
+      }
+      if (live != liveIn[i]) {
+        liveIn[i] = live;
+        changed = true;
+      }
+    }
+  }
+
+  std::vector<std::set<int> > interferes(n);
+  std::vector<Candidate> candidates;
+  for (int i = 0; i < nb; i++) {
+    std::vector<bool> live = liveOut[i];
+    for (std::list<Instruction*>::reverse_iterator p = blocks[i]->code.rbegin();
+         p != blocks[i]->code.rend(); ++p) {
+      Instruction *instr = *p;
+      Assign *copy = dynamic_cast<Assign*>(instr);
+      Location *dst = instr->GetDst();
+      if (IsRenamed(dst)) {
+        int d = index[dst];
+        int src = (copy && IsRenamed(copy->GetSrc(0))) ? index[copy->GetSrc(0)] : -1;
+        for (int k = 0; k < n; k++)
+          if (live[k] && k != d && k != src) {
+            interferes[d].insert(k);
+            interferes[k].insert(d);
+          }
+        live[d] = false;
+        if (src >= 0) {
+          Candidate c = { copy, graph->LoopDepth(blocks[i]) };
+          candidates.push_back(c);
+        }
+      }
+      for (int s = 0; s < instr->NumSrcs(); s++)
+        if (IsRenamed(instr->GetSrc(s))) live[index[instr->GetSrc(s)]] = true;
+    }
+  }
+  std::vector<bool> &atEntry = liveIn[graph->Entry()->id];
+  for (int a = 0; a < n; a++)
+    for (int b = a + 1; b < n && atEntry[a]; b++)
+      if (atEntry[b]) {
+        interferes[a].insert(b);
+        interferes[b].insert(a);
+      }
+
+  std::vector<int> parent(n);
+  for (int i = 0; i < n; i++) parent[i] = i;
+  std::stable_sort(candidates.begin(), candidates.end(), Deeper);
+  for (int c = 0; c < (int)candidates.size(); c++) {
+    int a = Find(parent, index[candidates[c].copy->GetDst()]);
+    int b = Find(parent, index[candidates[c].copy->GetSrc(0)]);
+    if (a == b || locs[a]->IsDouble() != locs[b]->IsDouble()) continue;
+    bool conflict = false;
+    std::set<int>::iterator k;
+    for (k = interferes[a].begin(); k != interferes[a].end() && !conflict; ++k)
+      conflict = (Find(parent, *k) == b);
+    if (conflict) continue;
+    parent[b] = a;
+    interferes[a].insert(interferes[b].begin(), interferes[b].end());
+  }
+
+  std::vector<Location*> slot(n, (Location*)NULL);
+  for (int i = 0; i < n; i++) {
+    int root = Find(parent, i);
+    if (original.count(locs[i])) continue;
+    if (!slot[root] || (atEntry[i] && !atEntry[index[slot[root]]]))
+      slot[root] = locs[i];
+  }
+  std::set<Location*> taken(slot.begin(), slot.end());
+  for (int i = 0; i < n; i++) {
+    int root = Find(parent, i);
+    if (slot[root] || !original.count(locs[i]) || taken.count(original[locs[i]]))
+      continue;
+    slot[root] = original[locs[i]];
+    taken.insert(slot[root]);
+  }
+  for (int i = 0; i < n; i++) {
+    int root = Find(parent, i);
+    if (!slot[root]) slot[root] = gen->GenTempVar(locs[root]->GetType());
+  }
+
+  for (int i = 0; i < nb; i++) {
+    Iter p = blocks[i]->code.begin();
+    while (p != blocks[i]->code.end()) {
+      Instruction *instr = *p;
+      for (int s = -1; s < instr->NumSrcs(); s++) {
+        Location *loc = (s < 0) ? instr->GetDst() : instr->GetSrc(s);
+        if (!IsRenamed(loc)) continue;
+        Location *to = slot[Find(parent, index[loc])];
+        if (s < 0) instr->SetDst(to);
+        else instr->SetSrc(s, to);
+      }
+      if (dynamic_cast<Assign*>(instr) && instr->GetDst() == instr->GetSrc(0))
+        p = blocks[i]->code.erase(p);
+      else
+        ++p;
+    }
+  }
+}
+
+
+void OptimizeSSA(FlowGraph *graph, BeginFunc *func, CodeGenerator *gen)
+{
+  SSAForm ssa(graph, func, gen);
+  ssa.Build();
+  PropagateConstants(&ssa);
+  PropagateCopies(&ssa);
+  RemoveDeadCode(&ssa);
+  ssa.Destroy();
+}
@@ -0,0 +1,81 @@
+/* File: ssa.h
+ * -----------
+ * Static single assignment form for the Tac of one function, and the
+ * optimizations that run on it.
+ *
+ * Build gives every assignment to a local, parameter or temp (the $fp
+ * relative Locations) a Location of its own, a version, so each one is
+ * written exactly once; the original Location stands for the value it
+ * has on entry to the function. Where versions of a variable meet, a Phi
+ * at the start of the block (placed on the iterated dominance frontier
+ * of the blocks that assign the variable, for variables used across
+ * blocks) picks the version for the edge control came in on. Globals are
+ * left alone, any call can change them.
+ *
+ * Destroy turns each Phi into copies at the end of its predecessors,
+ * done as a parallel copy and splitting critical edges, then coalesces
+ * the Locations joined by copies whose live ranges don't overlap, so
+ * most versions go back to their variable's slot. Versions that can't
+ * get a temp of their own in the frame.
+ *
+ * In between, PropagateConstants (sparse conditional constant
+ * propagation), PropagateCopies and RemoveDeadCode (sccp.cc) rewrite
+ * the function.
+ */
+
+#ifndef _H_ssa
+#define _H_ssa
+
+#include <map>
+#include <set>
+#include <vector>
+#include "tac.h"
+
+class FlowGraph;
+class BasicBlock;
+class CodeGenerator;
+
+class SSAForm {
+  private:
+    FlowGraph *graph;
+    BeginFunc *func;
+    CodeGenerator *gen;
+    std::map<Location*, Location*> original;     // version -> variable
+    std::map<Phi*, Location*> phiVar;
+    std::map<Phi*, std::vector<BasicBlock*> > phiPreds;
+    std::set<BasicBlock*> dead;
+    std::vector<std::pair<BasicBlock*, Instruction*> > jumps;   // edge blocks, branch to them
+    int nextVersion;
+
+    Location *NewVersion(Location *var);
+    void PlacePhis();
+    void Rename(BasicBlock *b, std::map<Location*, std::vector<Location*> > &stacks);
+    void InsertCopies(BasicBlock *from, BasicBlock *to,
+                      std::vector<std::pair<Location*, Location*> > &copies);
+    void Coalesce();
+    void RemoveEmptyJumps();
+
+  public:
+    SSAForm(FlowGraph *graph, BeginFunc *func, CodeGenerator *gen);
+    void Build();
+    void Destroy();
+
+    FlowGraph *Graph() { return graph; }
+         // Whether loc is renamed: a version, or a variable's entry value
+    static bool IsRenamed(Location *loc);
+         // The predecessor a Phi's i-th source comes from
+    BasicBlock *PhiPred(Phi *phi, int i) { return phiPreds[phi][i]; }
+         // Blocks found unreachable, their code has been removed
+    void MarkDead(BasicBlock *b) { dead.insert(b); }
+    bool IsDead(BasicBlock *b) { return dead.count(b) > 0; }
+};
+
+void PropagateConstants(SSAForm *ssa);
+void PropagateCopies(SSAForm *ssa);
+     // Deletes instructions whose only effect is a version nobody reads
+void RemoveDeadCode(SSAForm *ssa);
+
+     // Runs the above on one function: Build, the propagations, Destroy
+void OptimizeSSA(FlowGraph *graph, BeginFunc *func, CodeGenerator *gen);
+
+#endif
@@ -0,0 +1,276 @@
+/* File: switch.cc
+ * ---------------
+ * Implementation of the lowering of switch-like chains. Like bounds.cc it
+ * relies on temps being assigned exactly once: a temp whose only
+ * definition loads a constant holds that constant wherever it is read.
+ */
+
+#include "switch.h"
+#include "cfg.h"
+#include "codegen.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+
+static const int MinCases = 4;
+static const int MaxTableSize = 1024;   // entries, gaps included
+static const int MaxLeafTests = 3;      // == tests at the bottom of a search
+
+struct Case {
+  int value;
+  Location *constant;     // a temp holding value
+  BasicBlock *target;
+  const char *label;      // of target
+  bool operator<(const Case &other) const { return value < other.value; }
+};
+
+class SwitchLowerer {
+  private:
+    FlowGraph *graph;
+    CodeGenerator *gen;
+    std::map<std::string, BasicBlock*> labeled;
+    std::map<Location*, int> numDefs, numUses;
+    std::map<Location*, LoadConstant*> defs;    // of the constant temps
+    std::vector<bool> visited;                  // by block id
+
+    bool IsConstant(Location *loc, int *value);
+    bool MatchTest(BasicBlock *b, Location **var, Case *test, BasicBlock **rest);
+    bool HoldsOnlyConstants(BasicBlock *b, Location *var);
+    const char *LabelOf(BasicBlock *b);
+    void EmitCompare(std::list<Instruction*> &code, IfCompare::RelOp relop,
+                     Location *var, Case &test, const char *label,
+                     std::set<Location*> &loaded);
+    void EmitSearch(std::list<Instruction*> &code, Location *var,
+                    std::vector<Case> &cases, int lo, int hi,
+                    const char *otherwise, std::set<Location*> loaded);
+    void Lower(std::vector<BasicBlock*> &tests, Location *var,
+               std::vector<Case> &cases, BasicBlock *otherwise);
+
+  public:
+    SwitchLowerer(FlowGraph *g, CodeGenerator *cg);
+    void Run();
+};
+
+SwitchLowerer::SwitchLowerer(FlowGraph *g, CodeGenerator *cg) : graph(g), gen(cg)
+{
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  visited.resize(blocks.size(), false);
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    if (blocks[i]->GetLabel()) labeled[blocks[i]->GetLabel()] = blocks[i];
+    std::list<Instruction*>::iterator p;
+    for (p = blocks[i]->code.begin(); p != blocks[i]->code.end(); ++p) {
+      Instruction *instr = *p;
+      if (Location *dst = instr->GetDst()) {
+        numDefs[dst]++;
+        if (LoadConstant *load = dynamic_cast<LoadConstant*>(instr)) defs[dst] = load;
+      }
+      for (int j = 0; j < instr->NumSrcs(); j++)
+        numUses[instr->GetSrc(j)]++;
+    }
+  }
+}
+
+bool SwitchLowerer::IsConstant(Location *loc, int *value)
+{
+  if (numDefs[loc] != 1 || !defs.count(loc)) return false;
+  *value = defs[loc]->GetValue();
+  return true;
+}
+
+//the one block reaching b, NULL if there are more; the empty blocks left
+//where dead code after a Return was removed don't count
+static BasicBlock *OnlyPred(BasicBlock *b)
+{
+  BasicBlock *only = NULL;
+  for (size_t i = 0; i < b->preds.size(); i++) {
+    if (!b->preds[i]->reachable) continue;
+    if (only) return NULL;
+    only = b->preds[i];
+  }
+  return only;
+}
+
+//b ends in "var == constant" or "var != constant"; test gets the value
+//and where a match goes, rest where the others go
+bool SwitchLowerer::MatchTest(BasicBlock *b, Location **var, Case *test,
+                              BasicBlock **rest)
+{
+  IfCompare *compare = dynamic_cast<IfCompare*>(b->GetTerminator());
+  if (!compare) return false;
+  IfCompare::RelOp relop = compare->GetRelOp();
+  if (relop != IfCompare::Eq && relop != IfCompare::NotEq) return false;
+  Location *value = compare->GetSrc(0), *constant = compare->GetSrc(1);
+  if (!IsConstant(constant, &test->value)) {
+    std::swap(value, constant);
+    if (!IsConstant(constant, &test->value)) return false;
+  }
+  if (value->IsDouble()) return false;
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  if (b->id + 1 >= (int)blocks.size() || !labeled.count(compare->branch_label()))
+    return false;
+  BasicBlock *taken = labeled[compare->branch_label()], *next = blocks[b->id + 1];
+  *var = value;
+  test->constant = constant;
+  test->target = (relop == IfCompare::Eq)? taken : next;
+  *rest = (relop == IfCompare::Eq)? next : taken;
+  return true;
+}
+
+//all b does besides its test is load constants into temps, none into var
+bool SwitchLowerer::HoldsOnlyConstants(BasicBlock *b, Location *var)
+{
+  std::list<Instruction*>::iterator p = b->code.begin();
+  if (b->GetLabel()) ++p;
+  for (; *p != b->code.back(); ++p) {
+    int value;
+    Location *dst = (*p)->GetDst();
+    if (!dynamic_cast<LoadConstant*>(*p) || dst == var || !IsConstant(dst, &value))
+      return false;
+  }
+  return true;
+}
+
+//gives b a label if it doesn't start with one
+const char *SwitchLowerer::LabelOf(BasicBlock *b)
+{
+  if (!b->GetLabel()) {
+    const char *label = gen->NewLabel();
+    b->code.push_front(new Label(label));
+    labeled[label] = b;
+  }
+  return b->GetLabel();
+}
+
+//constant loads of the chain that were dropped are redone where needed,
+//once on each path
+void SwitchLowerer::EmitCompare(std::list<Instruction*> &code, IfCompare::RelOp relop,
+                                Location *var, Case &test, const char *label,
+                                std::set<Location*> &loaded)
+{
+  if (loaded.insert(test.constant).second)
+    code.push_back(new LoadConstant(test.constant, test.value));
+  code.push_back(new IfCompare(relop, var, test.constant, label));
+}
+
+//loaded is copied: what one half of the search loads the other can't use
+void SwitchLowerer::EmitSearch(std::list<Instruction*> &code, Location *var,
+                               std::vector<Case> &cases, int lo, int hi,
+                               const char *otherwise, std::set<Location*> loaded)
+{
+  if (hi - lo <= MaxLeafTests) {
+    for (int i = lo; i < hi; i++)
+      EmitCompare(code, IfCompare::Eq, var, cases[i], cases[i].label, loaded);
+    code.push_back(new Goto(otherwise));
+    return;
+  }
+  int mid = (lo + hi) / 2;
+  const char *lower = gen->NewLabel();
+  EmitCompare(code, IfCompare::Less, var, cases[mid], lower, loaded);
+  EmitSearch(code, var, cases, mid, hi, otherwise, loaded);
+  code.push_back(new Label(lower));
+  EmitSearch(code, var, cases, lo, mid, otherwise, loaded);
+}
+
+/* The constant loads in the chain's blocks are only kept (moved ahead of
+ * the dispatch) when something besides the tests reads them; the blocks
+ * after the first are emptied, nothing reaches them any more.
+ */
+void SwitchLowerer::Lower(std::vector<BasicBlock*> &tests, Location *var,
+                          std::vector<Case> &cases, BasicBlock *otherwise)
+{
+  std::map<Location*, int> testUses;
+  for (size_t i = 0; i < tests.size(); i++) {
+    Instruction *compare = tests[i]->code.back();
+    testUses[compare->GetSrc(0)]++;
+    testUses[compare->GetSrc(1)]++;
+  }
+  BasicBlock *first = tests[0];
+  delete first->code.back();
+  first->code.pop_back();
+  std::list<Instruction*> kept;
+  std::set<Location*> loaded;           // available to the dispatch
+  for (size_t i = 0; i < cases.size(); i++)
+    loaded.insert(cases[i].constant);
+  for (size_t i = 0; i < tests.size(); i++) {
+    std::list<Instruction*> &code = tests[i]->code;
+    std::list<Instruction*>::iterator p = code.begin();
+    while (p != code.end()) {
+      LoadConstant *load = dynamic_cast<LoadConstant*>(*p);
+      Location *dst = load? load->GetDst() : NULL;
+      bool chainOnly = dst && dst != var && numUses[dst] == testUses[dst];
+      if (i > 0 && !chainOnly && load) {
+        kept.push_back(load);
+      } else if (chainOnly) {
+        loaded.erase(dst);
+        delete load;
+      } else if (i > 0) {
+        delete *p;                      // a label no one jumps to
+      } else {
+        ++p;
+        continue;
+      }
+      p = code.erase(p);
+    }
+  }
+  std::list<Instruction*> &code = first->code;
+  code.splice(code.end(), kept);
+
+  const char *otherLabel = LabelOf(otherwise);
+  for (size_t i = 0; i < cases.size(); i++)
+    cases[i].label = LabelOf(cases[i].target);
+  std::sort(cases.begin(), cases.end());
+  int low = cases.front().value, count = cases.size();
+  long long range = (long long)cases.back().value - low + 1;
+  if (range <= MaxTableSize && range <= 2 * count) {
+    List<const char *> *labels = new List<const char *>;
+    for (size_t i = 0; i < cases.size(); i++) {
+      while (low + labels->NumElements() < cases[i].value)
+        labels->Append(otherLabel);
+      labels->Append(cases[i].label);
+    }
+    code.push_back(new JumpTable(var, low, gen->NewLabel(), labels, otherLabel));
+  } else {
+    EmitSearch(code, var, cases, 0, count, otherLabel, loaded);
+  }
+}
+
+void SwitchLowerer::Run()
+{
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  for (int i = 0; i < (int)blocks.size(); i++) {
+    Location *var, *next;
+    Case test, nextTest;
+    BasicBlock *rest, *nextRest;
+    if (visited[i] || !MatchTest(blocks[i], &var, &test, &rest)) continue;
+    std::vector<BasicBlock*> tests(1, blocks[i]);
+    std::vector<Case> cases;
+    std::set<int> values;
+    std::set<BasicBlock*> chain;
+    chain.insert(blocks[i]);
+    while (true) {
+      if (values.insert(test.value).second) cases.push_back(test);
+      visited[tests.back()->id] = true;
+      BasicBlock *b = rest;
+      if (chain.count(b) || OnlyPred(b) != tests.back()
+          || !MatchTest(b, &next, &nextTest, &nextRest) || next != var
+          || !HoldsOnlyConstants(b, var))
+        break;
+      tests.push_back(b);
+      chain.insert(b);
+      test = nextTest;
+      rest = nextRest;
+    }
+    //code elsewhere jumping into the chain would lose the tests before it
+    bool jumpsIn = chain.count(rest) > 0;
+    for (size_t j = 0; j < cases.size(); j++)
+      if (chain.count(cases[j].target) && cases[j].target != tests[0]) jumpsIn = true;
+    if ((int)cases.size() >= MinCases && !jumpsIn)
+      Lower(tests, var, cases, rest);
+  }
+}
+
+void LowerSwitches(FlowGraph *graph, CodeGenerator *gen)
+{
+  SwitchLowerer(graph, gen).Run();
+}
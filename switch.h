@@ -0,0 +1,33 @@
+/* File: switch.h
+ * --------------
+ * Lowers the switch-like chains of tests IfStmt makes for
+ *
+ *     if (x == 3) ... else if (x == 4) ... else if (x == 6) ... else ...
+ *
+ * A chain is a run of blocks each ending in an == or != compare of the
+ * same int variable against a constant, where every block after the first
+ * holds nothing else but constant loads and is only reached from the one
+ * before. When it tests at least MinCases different values, the tests
+ * are replaced by a single dispatch at the end of the first block:
+ *
+ *   - a JumpTable, a bounds check and an indexed jump through a table in
+ *     the data segment, when the values are dense: they cover at least
+ *     half of the range from the smallest to the largest;
+ *   - otherwise a binary search, compares that halve the sorted values
+ *     down to a few == tests each.
+ *
+ * When a value is tested twice the first test wins, as it did before.
+ *
+ * This runs last: the flow graph doesn't know where a JumpTable can jump,
+ * so it must not be analyzed again afterwards.
+ */
+
+#ifndef _H_switch
+#define _H_switch
+
+class FlowGraph;
+class CodeGenerator;
+
+void LowerSwitches(FlowGraph *graph, CodeGenerator *gen);
+
+#endif
@@ -4,7 +4,9 @@
 #include <cstring>
 SymbolTable *SymbolTable::active = NULL;
 
-SymbolTable::SymbolTable() : symbols(), offset(CodeGenerator::OffsetToFirstGlobal){
+SymbolTable::SymbolTable() : symbols(), offset(CodeGenerator::OffsetToFirstGlobal),
+                             param_offset(CodeGenerator::OffsetToFirstParam),
+                             fields(false){
   class_name = NULL;
   if(active){ // assuming we will be able to always track the active
     parent = active;
@@ -16,7 +18,9 @@ SymbolTable::SymbolTable() : symbols(), offset(CodeGenerator::OffsetToFirstGloba
   }
 }
 
-SymbolTable::SymbolTable(Location *l) : symbols(), offset(CodeGenerator::OffsetToFirstLocal){
+SymbolTable::SymbolTable(Location *l) : symbols(), offset(CodeGenerator::OffsetToFirstLocal),
+                                        param_offset(CodeGenerator::OffsetToFirstParam),
+                                        fields(false){
   class_name = l;
   if(active){ // assuming we will be able to always track the active
     parent = active;
@@ -29,6 +33,15 @@ SymbolTable::SymbolTable(Location *l) : symbols(), offset(CodeGenerator::OffsetT
 
 }
 
+//the members of a class; the parent is the superclass table (or the
+//global one) so lookups from a method see inherited members
+SymbolTable::SymbolTable(Location *l, int firstField) : symbols(), offset(firstField),
+                                                        param_offset(0), fields(true){
+  class_name = l;
+  parent = active;
+  active = this;
+}
+
 
 //SymbolTable::SymbolTable(Location *l): SymbolTable(){class_name = l;}
 Location *SymbolTable::Lookup(const char* label){
@@ -49,16 +62,26 @@ Location *SymbolTable::Lookup(const char* label){
 
 
 void SymbolTable::Add(const char * name, bool is_param, Type *type){
-  static int param_offset = CodeGenerator::OffsetToFirstParam;
-
-  Location *loc  = new Location(GetSegment(), ((is_param)?param_offset : offset), name);
+  int size = CodeGenerator::SizeOf(type);
+  if(fields){
+    Location *field = new Location(CodeGenerator::ThisPtr, offset, name);
+    offset += size;
+    if(type) field->SetType(type);
+    symbols.push_back(field);
+    return;
+  }
+  int where = (is_param)? param_offset : offset;
+  if(GetSegment() == fpRelative && !is_param){
+    where -= size - CodeGenerator::VarSize;  // locals grow down, offset is the low end
+  }
+  Location *loc  = new Location(GetSegment(), where, name);
   //will need to modify this for arrays
   if(GetSegment() == fpRelative){
-    if(!is_param) offset -=4;
-    if(is_param) param_offset +=4;
+    if(!is_param) offset -= size;
+    if(is_param) param_offset += size;
   }
   else{
-    offset +=4;
+    offset += size;
   }
   if(type){
     loc->SetType(type);
@@ -66,16 +89,11 @@ void SymbolTable::Add(const char * name, bool is_param, Type *type){
   symbols.push_back(loc);
 }
 
-SymbolTable *SymbolTable::FindClassTable(const char * type_name){
-  if (std::strcmp(type_name, class_name->GetName()) == 0 ){
-    return this;
-  }
-  if(parent != NULL){
-    return parent->FindClassTable(type_name);
-  }
-  else{
-    return NULL;
-  }
+//methods are looked up by their "_name", the slot is the vtable index
+void SymbolTable::AddMethod(const char * name, int slot, Type *returnType){
+  Location *method = new Location(CodeGenerator::ThisPtr, slot * CodeGenerator::VarSize, name);
+  method->SetType(returnType);
+  symbols.push_back(method);
 }
 
 void SymbolTable::SwitchActive(SymbolTable * new_active) {
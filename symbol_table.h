@@ -21,20 +21,25 @@ class SymbolTable {
   Location * class_name;
   std::list<Location *> symbols;
   int offset;
+  int param_offset;
+  bool fields;  // a class table: variables are laid out upward in the object
 
  public:
   static SymbolTable *active;
   SymbolTable();
   SymbolTable(Location *l);
+  SymbolTable(Location *l, int firstField);
   static void SwitchActive(SymbolTable * new_active);
   //prints symbols in table
   void DebugSymbolTable();
   Location *Lookup(const char * label);
   void Add(const char * name, bool is_param, Type *type=NULL);
-  SymbolTable *FindClassTable(const char * type_name) ;
+  void AddMethod(const char * name, int slot, Type *returnType);
   Location * GetClass() {return class_name;}
   const char * GetClassName() {if(class_name != NULL) return class_name->GetName(); else return "";}
   SymbolTable *GetParent() {return parent;}
+  const std::list<Location *> &GetSymbols() {return symbols;}
+  int GetNextOffset() {return offset;}
   Segment GetSegment() {if(parent) return fpRelative; else return gpRelative;}
 };
 
@@ -9,10 +9,14 @@
 #include "ast_type.h"
 void Location::SetType(Type* t)      { type = t; }
 Type* Location::GetType() const       { return type; }
+bool Location::IsDouble() const       { return type == Type::doubleType; }
 
 Location::Location(Segment s, int o, const char *name) :
   variableName(strdup(name)), segment(s), offset(o), base(NULL), type(Type::nullType) {}
 
+Location::Location(Location *b, int o, const char *name) :
+  variableName(strdup(name)), segment(b->GetSegment()), offset(o), base(b), type(Type::nullType) {}
+
 
 void Instruction::Print() {
   printf("\t%s ;\n", printed);
@@ -25,9 +29,47 @@ void Instruction::Emit(Mips *mips) {
   EmitSpecific(mips);
 }
 
+Location *Instruction::GetDst() {
+  Location **slot = DstSlot();
+  return slot ? *slot : NULL;
+}
+
+Location *Instruction::GetSrc(int i) {
+  Assert(i >= 0 && i < NumSrcs());
+  return *SrcSlot(i);
+}
+
+void Instruction::SetDst(Location *loc) {
+  Location **slot = DstSlot();
+  Assert(slot != NULL && loc != NULL);
+  *slot = loc;
+  Describe();
+}
+
+void Instruction::SetSrc(int i, Location *loc) {
+  Assert(i >= 0 && i < NumSrcs() && loc != NULL);
+  *SrcSlot(i) = loc;
+  Describe();
+}
+
+const char *Instruction::branch_label() {
+  const char **slot = LabelSlot();
+  return slot ? *slot : NULL;
+}
+
+void Instruction::SetBranchLabel(const char *label) {
+  const char **slot = LabelSlot();
+  Assert(slot != NULL && label != NULL);
+  *slot = strdup(label);
+  Describe();
+}
+
 LoadConstant::LoadConstant(Location *d, int v)
   : dst(d), val(v) {
   Assert(dst != NULL);
+  Describe();
+}
+void LoadConstant::Describe() {
   sprintf(printed, "%s = %d", dst->GetName(), val);
 }
 void LoadConstant::EmitSpecific(Mips *mips) {
@@ -41,7 +83,10 @@ LoadStringConstant::LoadStringConstant(Location *d, const char *s)
   const char *quote = (*s == '"') ? "" : "\"";
   str = new char[strlen(s) + 2*strlen(quote) + 1];
   sprintf(str, "%s%s%s", quote, s, quote);
-  quote = (strlen(str) > 50) ? "...\"" : "";
+  Describe();
+}
+void LoadStringConstant::Describe() {
+  const char *quote = (strlen(str) > 50) ? "...\"" : "";
   sprintf(printed, "%s = %.50s%s", dst->GetName(), str, quote);
 }
 void LoadStringConstant::EmitSpecific(Mips *mips) {
@@ -49,9 +94,25 @@ void LoadStringConstant::EmitSpecific(Mips *mips) {
 }
 
 
+LoadDoubleConstant::LoadDoubleConstant(Location *d, double v)
+  : dst(d), val(v) {
+  Assert(dst != NULL);
+  Describe();
+}
+void LoadDoubleConstant::Describe() {
+  sprintf(printed, "%s = %g", dst->GetName(), val);
+}
+void LoadDoubleConstant::EmitSpecific(Mips *mips) {
+  mips->EmitLoadDoubleConstant(dst, val);
+}
+
+
 LoadLabel::LoadLabel(Location *d, const char *l)
   : dst(d), label(strdup(l)) {
   Assert(dst != NULL && label != NULL);
+  Describe();
+}
+void LoadLabel::Describe() {
   sprintf(printed, "%s = %s", dst->GetName(), label);
 }
 void LoadLabel::EmitSpecific(Mips *mips) {
@@ -62,6 +123,9 @@ void LoadLabel::EmitSpecific(Mips *mips) {
 Assign::Assign(Location *d, Location *s)
   : dst(d), src(s) {
   Assert(dst != NULL && src != NULL);
+  Describe();
+}
+void Assign::Describe() {
   sprintf(printed, "%s = %s", dst->GetName(), src->GetName());
 }
 void Assign::EmitSpecific(Mips *mips) {
@@ -72,6 +136,9 @@ void Assign::EmitSpecific(Mips *mips) {
 Load::Load(Location *d, Location *s, int off)
   : dst(d), src(s), offset(off) {
   Assert(dst != NULL && src != NULL);
+  Describe();
+}
+void Load::Describe() {
   if (offset)
     sprintf(printed, "%s = *(%s + %d)", dst->GetName(), src->GetName(), offset);
   else
@@ -85,6 +152,9 @@ void Load::EmitSpecific(Mips *mips) {
 Store::Store(Location *d, Location *s, int off)
   : dst(d), src(s), offset(off) {
   Assert(dst != NULL && src != NULL);
+  Describe();
+}
+void Store::Describe() {
   if (offset)
     sprintf(printed, "*(%s + %d) = %s", dst->GetName(), offset, src->GetName());
   else
@@ -95,6 +165,19 @@ void Store::EmitSpecific(Mips *mips) {
 }
 
 
+BoundsCheck::BoundsCheck(Location *a, Location *i)
+  : array(a), index(i) {
+  Assert(array != NULL && index != NULL);
+  Describe();
+}
+void BoundsCheck::Describe() {
+  sprintf(printed, "BoundsCheck %s[%s]", array->GetName(), index->GetName());
+}
+void BoundsCheck::EmitSpecific(Mips *mips) {
+  mips->EmitBoundsCheck(array, index);
+}
+
+
 const char * const BinaryOp::opName[BinaryOp::NumOps]  = {"+", "-", "*", "/", "%", "==", "<", "&&", "||"};;
 
 BinaryOp::OpCode BinaryOp::OpCodeForName(const char *name) {
@@ -109,6 +192,9 @@ BinaryOp::BinaryOp(OpCode c, Location *d, Location *o1, Location *o2)
   : code(c), dst(d), op1(o1), op2(o2) {
   Assert(dst != NULL && op1 != NULL && op2 != NULL);
   Assert(code >= 0 && code < NumOps);
+  Describe();
+}
+void BinaryOp::Describe() {
   sprintf(printed, "%s = %s %s %s", dst->GetName(), op1->GetName(), opName[code], op2->GetName());
 }
 void BinaryOp::EmitSpecific(Mips *mips) {
@@ -119,6 +205,10 @@ Label::Label(const char *l) : label(strdup(l)) {
   Assert(label != NULL);
   *printed = '\0';
 }
+void Label::SetText(const char *l) {
+  Assert(l != NULL);
+  label = strdup(l);
+}
 void Label::Print() {
   printf("%s:\n", label);
 }
@@ -128,6 +218,9 @@ void Label::EmitSpecific(Mips *mips) {
 
 Goto::Goto(const char *l) : label(strdup(l)) {
   Assert(label != NULL);
+  Describe();
+}
+void Goto::Describe() {
   sprintf(printed, "Goto %s", label);
 }
 void Goto::EmitSpecific(Mips *mips) {
@@ -137,13 +230,49 @@ void Goto::EmitSpecific(Mips *mips) {
 IfZ::IfZ(Location *te, const char *l)
    : test(te), label(strdup(l)) {
   Assert(test != NULL && label != NULL);
+  Describe();
+}
+void IfZ::Describe() {
   sprintf(printed, "IfZ %s Goto %s", test->GetName(), label);
 }
 void IfZ::EmitSpecific(Mips *mips) {
   mips->EmitIfZ(test, label);
 }
 
-BeginFunc::BeginFunc() {
+const char * const IfCompare::opName[IfCompare::NumRelOps] =
+  {"IfEq", "IfNotEq", "IfLess", "IfLessEq", "IfGreater", "IfGreaterEq"};
+const char * const IfCompare::opToken[IfCompare::NumRelOps] =
+  {"==", "!=", "<", "<=", ">", ">="};
+
+IfCompare::RelOp IfCompare::RelOpForName(const char *token) {
+  for (int i = 0; i < NumRelOps; i++)
+    if (!strcmp(opToken[i], token))
+      return (RelOp)i;
+  Failure("Unrecognized relational operator: '%s'\n", token);
+  return Eq; // can't get here, but compiler doesn't know that
+}
+
+IfCompare::RelOp IfCompare::Negate(RelOp c) {
+  static const RelOp negated[NumRelOps] =
+    {NotEq, Eq, GreaterEq, Greater, LessEq, Less};
+  return negated[c];
+}
+
+IfCompare::IfCompare(RelOp c, Location *o1, Location *o2, const char *l)
+  : code(c), op1(o1), op2(o2), label(strdup(l)) {
+  Assert(op1 != NULL && op2 != NULL && label != NULL);
+  Assert(code >= 0 && code < NumRelOps);
+  Describe();
+}
+void IfCompare::Describe() {
+  sprintf(printed, "%s %s, %s Goto %s", opName[code], op1->GetName(),
+          op2->GetName(), label);
+}
+void IfCompare::EmitSpecific(Mips *mips) {
+  mips->EmitIfCompare(code, op1, op2, label);
+}
+
+BeginFunc::BeginFunc(bool entry) : isEntry(entry) {
   sprintf(printed,"BeginFunc (unassigned)");
   frameSize = -555; // used as sentinel to recognized unassigned value
 }
@@ -152,7 +281,7 @@ void BeginFunc::SetFrameSize(int numBytesForAllLocalsAndTemps) {
   sprintf(printed,"BeginFunc %d", frameSize);
 }
 void BeginFunc::EmitSpecific(Mips *mips) {
-  mips->EmitBeginFunction(frameSize);
+  mips->EmitBeginFunction(frameSize, isEntry);
 }
 
 EndFunc::EndFunc() : Instruction() {
@@ -163,6 +292,9 @@ void EndFunc::EmitSpecific(Mips *mips) {
 }
 
 Return::Return(Location *v) : val(v) {
+  Describe();
+}
+void Return::Describe() {
   sprintf(printed, "Return %s", val? val->GetName() : "");
 }
 void Return::EmitSpecific(Mips *mips) {
@@ -172,6 +304,9 @@ void Return::EmitSpecific(Mips *mips) {
 PushParam::PushParam(Location *p)
   :  param(p) {
   Assert(param != NULL);
+  Describe();
+}
+void PushParam::Describe() {
   sprintf(printed, "PushParam %s", param->GetName());
 }
 void PushParam::EmitSpecific(Mips *mips) {
@@ -189,6 +324,9 @@ void PopParams::EmitSpecific(Mips *mips) {
 
 LCall::LCall(const char *l, Location *d)
   :  label(strdup(l)), dst(d) {
+  Describe();
+}
+void LCall::Describe() {
   sprintf(printed, "%s%sLCall %s", dst? dst->GetName(): "", dst?" = ":"", label);
 }
 void LCall::EmitSpecific(Mips *mips) {
@@ -198,6 +336,9 @@ void LCall::EmitSpecific(Mips *mips) {
 ACall::ACall(Location *ma, Location *d)
   : dst(d), methodAddr(ma) {
   Assert(methodAddr != NULL);
+  Describe();
+}
+void ACall::Describe() {
   sprintf(printed, "%s%sACall %s", dst? dst->GetName(): "", dst?" = ":"",
 	    methodAddr->GetName());
 }
@@ -205,6 +346,26 @@ void ACall::EmitSpecific(Mips *mips) {
   mips->EmitACall(dst, methodAddr);
 }
 
+JumpTable::JumpTable(Location *v, int lo, const char *t,
+                     List<const char *> *l, const char *otherwise)
+  : value(v), low(lo), table(strdup(t)), label(strdup(otherwise)), labels(l) {
+  Assert(value != NULL && labels != NULL && table != NULL && label != NULL);
+  Describe();
+}
+void JumpTable::Describe() {
+  sprintf(printed, "JumpTable %s[%s - %d] else Goto %s", table,
+          value->GetName(), low, label);
+}
+void JumpTable::Print() {
+  printf("\t%s =\n", printed);
+  for (int i = 0; i < labels->NumElements(); i++)
+    printf("\t\t%s,\n", labels->Nth(i));
+  printf("\t;\n");
+}
+void JumpTable::EmitSpecific(Mips *mips) {
+  mips->EmitJumpTable(value, low, table, labels, label);
+}
+
 VTable::VTable(const char *l, List<const char *> *m)
   : methodLabels(m), label(strdup(l)) {
   Assert(methodLabels != NULL && label != NULL);
@@ -220,3 +381,25 @@ void VTable::Print() {
 void VTable::EmitSpecific(Mips *mips) {
   mips->EmitVTable(label, methodLabels);
 }
+
+Phi::Phi(Location *d, int n)
+  : dst(d), args(new Location*[n]), numArgs(n) {
+  Assert(dst != NULL);
+  for (int i = 0; i < numArgs; i++) args[i] = dst;
+  Describe();
+}
+void Phi::Describe() {
+  int len = sprintf(printed, "%s = Phi(", dst->GetName());
+  for (int i = 0; i < numArgs && len < (int)sizeof(printed) - 24; i++)
+    len += sprintf(printed + len, "%s%s", i ? ", " : "", args[i]->GetName());
+  sprintf(printed + len, ")");
+}
+void Phi::EmitSpecific(Mips *mips) {
+  Assert(!"Phi left in the code, SSA form was not destroyed");
+}
+Instruction *Phi::Clone() {
+  Phi *copy = new Phi(dst, numArgs);
+  for (int i = 0; i < numArgs; i++) copy->args[i] = args[i];
+  copy->Describe();
+  return copy;
+}
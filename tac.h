@@ -51,6 +51,10 @@ class Location
 
   public:
     Location(Segment seg, int offset, const char *name);
+         // A member of the object base points at: a field at that byte
+         // offset into the object, or a method at that offset into the
+         // class vtable
+    Location(Location *base, int offset, const char *name);
 
     const char *GetName() const     { return variableName; }
     Segment GetSegment() const      { return segment; }
@@ -58,6 +62,7 @@ class Location
     Location* GetBase() const       { return base; }
     void SetType(Type* t);
     Type* GetType() const;
+    bool IsDouble() const;      // 8-byte slot, lives in FPU registers
 };
 
 
@@ -69,10 +74,42 @@ class Instruction {
     protected:
       char printed[128];
 
+           // Rebuilds printed from the current operands. Subclasses call
+           // it from their constructor, the setters below call it again.
+      virtual void Describe() {}
+
+           // Each subclass exposes the address of its operand fields here
+           // so the generic accessors below can read and rewrite them
+      virtual Location **DstSlot() { return NULL; }
+      virtual Location **SrcSlot(int i) { return NULL; }
+      virtual const char **LabelSlot() { return NULL; }
+
     public:
+	virtual ~Instruction() {}
 	virtual void Print();
 	virtual void EmitSpecific(Mips *mips) = 0;
 	void Emit(Mips *mips);
+
+           // Returns a copy with the same operands (used when passes
+           // duplicate code).
+	virtual Instruction *Clone() = 0;
+
+           // Operand access for the optimization passes. GetDst is the
+           // Location written (NULL if none) and GetSrc(i), for
+           // 0 <= i < NumSrcs(), the Locations read. The setters rewrite
+           // an operand in place.
+	Location *GetDst();
+	virtual int NumSrcs() { return 0; }
+	Location *GetSrc(int i);
+	void SetDst(Location *loc);
+	void SetSrc(int i, Location *loc);
+
+           // Control flow shape: the label this instruction may jump to
+           // (NULL if none) and whether execution can continue with the
+           // next instruction in the list.
+	const char *branch_label();
+	void SetBranchLabel(const char *label);
+	virtual bool FallsThrough() { return true; }
 };
 
 
@@ -82,14 +119,18 @@ class Instruction {
 
   class LoadConstant;
   class LoadStringConstant;
+  class LoadDoubleConstant;
   class LoadLabel;
   class Assign;
   class Load;
   class Store;
+  class BoundsCheck;
   class BinaryOp;
   class Label;
   class Goto;
   class IfZ;
+  class IfCompare;
+  class JumpTable;
   class BeginFunc;
   class EndFunc;
   class Return;
@@ -98,54 +139,110 @@ class Instruction {
   class LCall;
   class ACall;
   class VTable;
+  class Phi;
 
 
 
 class LoadConstant: public Instruction {
     Location *dst;
     int val;
+    void Describe();
+    Location **DstSlot() { return &dst; }
   public:
     LoadConstant(Location *dst, int val);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new LoadConstant(*this); }
+    int GetValue() const { return val; }
 };
 
 class LoadStringConstant: public Instruction {
     Location *dst;
     char *str;
+    void Describe();
+    Location **DstSlot() { return &dst; }
   public:
     LoadStringConstant(Location *dst, const char *s);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new LoadStringConstant(*this); }
+    const char *GetString() const { return str; }
+};
+
+class LoadDoubleConstant: public Instruction {
+    Location *dst;
+    double val;
+    void Describe();
+    Location **DstSlot() { return &dst; }
+  public:
+    LoadDoubleConstant(Location *dst, double val);
+    void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new LoadDoubleConstant(*this); }
+    double GetValue() const { return val; }
 };
 
 class LoadLabel: public Instruction {
     Location *dst;
     const char *label;
+    void Describe();
+    Location **DstSlot() { return &dst; }
   public:
     LoadLabel(Location *dst, const char *label);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new LoadLabel(*this); }
+    const char *GetLabel() const { return label; }
 };
 
 class Assign: public Instruction {
     Location *dst, *src;
+    void Describe();
+    Location **DstSlot() { return &dst; }
+    Location **SrcSlot(int i) { return &src; }
   public:
     Assign(Location *dst, Location *src);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new Assign(*this); }
+    int NumSrcs() { return 1; }
 };
 
 class Load: public Instruction {
     Location *dst, *src;
     int offset;
+    void Describe();
+    Location **DstSlot() { return &dst; }
+    Location **SrcSlot(int i) { return &src; }
   public:
     Load(Location *dst, Location *src, int offset = 0);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new Load(*this); }
+    int NumSrcs() { return 1; }
+    int GetOffset() const { return offset; }
 };
 
+  // Note a Store reads both of its operands: the address (dst) and the
+  // value written there (src). Src(0) is the address, Src(1) the value.
 class Store: public Instruction {
     Location *dst, *src;
     int offset;
+    void Describe();
+    Location **SrcSlot(int i) { return i == 0 ? &dst : &src; }
   public:
     Store(Location *d, Location *s, int offset = 0);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new Store(*this); }
+    int NumSrcs() { return 2; }
+    int GetOffset() const { return offset; }
+};
+
+  // Halts with a runtime error unless 0 <= index < length of array.
+  // The length is the word just before the first element.
+class BoundsCheck: public Instruction {
+    Location *array, *index;
+    void Describe();
+    Location **SrcSlot(int i) { return i == 0 ? &array : &index; }
+  public:
+    BoundsCheck(Location *array, Location *index);
+    void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new BoundsCheck(*this); }
+    int NumSrcs() { return 2; }
 };
 
 class BinaryOp: public Instruction {
@@ -158,9 +255,15 @@ class BinaryOp: public Instruction {
   protected:
     OpCode code;
     Location *dst, *op1, *op2;
+    void Describe();
+    Location **DstSlot() { return &dst; }
+    Location **SrcSlot(int i) { return i == 0 ? &op1 : &op2; }
   public:
     BinaryOp(OpCode c, Location *dst, Location *op1, Location *op2);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new BinaryOp(*this); }
+    int NumSrcs() { return 2; }
+    OpCode GetOpCode() const { return code; }
 };
 
 class Label: public Instruction {
@@ -169,53 +272,129 @@ class Label: public Instruction {
     Label(const char *label);
     void Print();
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new Label(*this); }
     const char* text() const { return label; }
+    void SetText(const char *l);
 };
 
 class Goto: public Instruction {
     const char *label;
+    void Describe();
+    const char **LabelSlot() { return &label; }
   public:
     Goto(const char *label);
     void EmitSpecific(Mips *mips);
-    const char* branch_label() const { return label; }
+    Instruction *Clone() { return new Goto(*this); }
+    bool FallsThrough() { return false; }
 };
 
 class IfZ: public Instruction {
     Location *test;
     const char *label;
+    void Describe();
+    Location **SrcSlot(int i) { return &test; }
+    const char **LabelSlot() { return &label; }
   public:
     IfZ(Location *test, const char *label);
     void EmitSpecific(Mips *mips);
-    const char* branch_label() const { return label; }
+    Instruction *Clone() { return new IfZ(*this); }
+    int NumSrcs() { return 1; }
+};
+
+    // Fused compare-and-branch: jumps to label when "op1 relop op2" holds.
+    // Lets conditions on RelationalExpr/EqualityExpr skip materializing a
+    // 0/1 value in a temp only to test it again with IfZ.
+class IfCompare: public Instruction {
+
+  public:
+    typedef enum {Eq, NotEq, Less, LessEq, Greater, GreaterEq, NumRelOps} RelOp;
+    static const char * const opName[NumRelOps];
+    static const char * const opToken[NumRelOps];
+    static RelOp RelOpForName(const char *token);
+    static RelOp Negate(RelOp code);
+
+  protected:
+    RelOp code;
+    Location *op1, *op2;
+    const char *label;
+    void Describe();
+    Location **SrcSlot(int i) { return i == 0 ? &op1 : &op2; }
+    const char **LabelSlot() { return &label; }
+  public:
+    IfCompare(RelOp c, Location *op1, Location *op2, const char *label);
+    void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new IfCompare(*this); }
+    int NumSrcs() { return 2; }
+    RelOp GetRelOp() const { return code; }
+};
+
+    // Multiway branch, made from chains of tests by LowerSwitches (see
+    // switch.h): jumps to labels[value - low] when there is such an
+    // element, to label otherwise. The labels are laid out as a table
+    // of addresses in the data segment, under the label table.
+class JumpTable: public Instruction {
+    Location *value;
+    int low;
+    const char *table, *label;
+    List<const char *> *labels;
+    void Describe();
+    Location **SrcSlot(int i) { return &value; }
+    const char **LabelSlot() { return &label; }
+  public:
+    JumpTable(Location *value, int low, const char *table,
+              List<const char *> *labels, const char *otherwise);
+    void Print();
+    void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new JumpTable(*this); }
+    int NumSrcs() { return 1; }
+    bool FallsThrough() { return false; }
+    int GetLow() const { return low; }
+    const char *GetTable() const { return table; }
+    List<const char *> *GetLabels() const { return labels; }
 };
 
 class BeginFunc: public Instruction {
     int frameSize;
+    bool isEntry;
   public:
-    BeginFunc();
+    BeginFunc(bool isEntry = false);
     // used to backpatch the instruction with frame size once known
     void SetFrameSize(int numBytesForAllLocalsAndTemps);
+    int GetFrameSize() const { return frameSize; }
+    bool IsEntry() const { return isEntry; }
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new BeginFunc(*this); }
 };
 
 class EndFunc: public Instruction {
   public:
     EndFunc();
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new EndFunc(*this); }
+    bool FallsThrough() { return false; }
 };
 
 class Return: public Instruction {
     Location *val;
+    void Describe();
+    Location **SrcSlot(int i) { return &val; }
   public:
     Return(Location *val);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new Return(*this); }
+    int NumSrcs() { return val ? 1 : 0; }
+    bool FallsThrough() { return false; }
 };
 
 class PushParam: public Instruction {
     Location *param;
+    void Describe();
+    Location **SrcSlot(int i) { return &param; }
   public:
     PushParam(Location *param);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new PushParam(*this); }
+    int NumSrcs() { return 1; }
 };
 
 class PopParams: public Instruction {
@@ -223,21 +402,32 @@ class PopParams: public Instruction {
   public:
     PopParams(int numBytesOfParamsToRemove);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new PopParams(*this); }
+    int GetNumBytes() const { return numBytes; }
 };
 
 class LCall: public Instruction {
     const char *label;
     Location *dst;
+    void Describe();
+    Location **DstSlot() { return &dst; }
   public:
     LCall(const char *labe, Location *result);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new LCall(*this); }
+    const char *GetLabel() const { return label; }
 };
 
 class ACall: public Instruction {
     Location *dst, *methodAddr;
+    void Describe();
+    Location **DstSlot() { return &dst; }
+    Location **SrcSlot(int i) { return &methodAddr; }
   public:
     ACall(Location *meth, Location *result);
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new ACall(*this); }
+    int NumSrcs() { return 1; }
 };
 
 class VTable: public Instruction {
@@ -247,7 +437,26 @@ class VTable: public Instruction {
     VTable(const char *labelForTable, List<const char *> *methodLabels);
     void Print();
     void EmitSpecific(Mips *mips);
+    Instruction *Clone() { return new VTable(*this); }
+    const char *GetLabel() const { return label; }
+    List<const char *> *GetMethodLabels() const { return methodLabels; }
 };
 
+    // Only exists while a function is in SSA form (see ssa.h): dst gets
+    // the i-th source when control arrives from the block's i-th
+    // predecessor, in the order recorded by SSAForm. Never emitted.
+class Phi: public Instruction {
+    Location *dst;
+    Location **args;
+    int numArgs;
+    void Describe();
+    Location **DstSlot() { return &dst; }
+    Location **SrcSlot(int i) { return &args[i]; }
+  public:
+    Phi(Location *dst, int numArgs);
+    void EmitSpecific(Mips *mips);
+    Instruction *Clone();
+    int NumSrcs() { return numArgs; }
+};
 
 #endif
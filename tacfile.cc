@@ -0,0 +1,481 @@
+/* File: tacfile.cc
+ * ----------------
+ * Implementation of the Tac file writer and reader, and of the -d fromtac
+ * tool that runs the Mips backend on a Tac file.
+ */
+
+#include "tacfile.h"
+#include "tac.h"
+#include "mips.h"
+#include "ast_type.h"
+#include "utility.h"
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const int TacFileVersion = 3;
+
+    // instruction kinds, as stored in TacFileInstruction::kind
+typedef enum { KLoadConstant, KLoadStringConstant, KLoadDoubleConstant,
+               KLoadLabel, KAssign, KLoad, KStore, KBoundsCheck, KBinaryOp,
+               KLabel, KGoto, KIfZ, KIfCompare, KBeginFunc, KEndFunc,
+               KReturn, KPushParam, KPopParams, KLCall, KACall, KVTable,
+               KJumpTable, NumKinds } Kind;
+
+    // sections start at multiples of 8 bytes, so the doubles are aligned
+static size_t Align(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+    // a label NewLabel made, _L and a number
+static bool IsLocalLabel(const char *label)
+{
+  if (strncmp(label, "_L", 2) != 0 || !label[2]) return false;
+  for (const char *p = label + 2; *p; p++)
+    if (*p < '0' || *p > '9') return false;
+  return true;
+}
+
+
+TacWriter::TacWriter() : firstRoot(0), numRoots(0) {}
+
+int TacWriter::StringNum(const char *str)
+{
+  Assert(str != NULL);
+  std::map<std::string, int>::iterator found = stringNums.find(str);
+  if (found != stringNums.end()) return found->second;
+  int num = stringOffsets.size();
+  stringNums[str] = num;
+  stringOffsets.push_back(stringText.size());
+  stringText.append(str, strlen(str) + 1);
+  return num;
+}
+
+int TacWriter::LocationNum(Location *loc)
+{
+  if (!loc) return -1;
+  std::map<Location*, int>::iterator found = locationNums.find(loc);
+  if (found != locationNums.end()) return found->second;
+  TacFileLocation record;
+  record.name = StringNum(loc->GetName());
+  record.segment = loc->GetSegment();
+  record.offset = loc->GetOffset();
+  record.base = LocationNum(loc->GetBase());
+  record.isDouble = loc->IsDouble();
+  int num = locations.size();
+  locationNums[loc] = num;
+  locations.push_back(record);
+  return num;
+}
+
+void TacWriter::NoteLabel(std::set<int> *labels, const char *label)
+{
+  if (!IsLocalLabel(label)) labels->insert(StringNum(label));
+}
+
+void TacWriter::Append(Instruction *instr)
+{
+  TacFileInstruction record;
+  memset(&record, 0, sizeof(record));
+  int *op = record.operand;
+  if (LoadConstant *lc = dynamic_cast<LoadConstant*>(instr)) {
+    record.kind = KLoadConstant;
+    op[0] = LocationNum(lc->GetDst());
+    op[1] = lc->GetValue();
+  } else if (LoadStringConstant *ls = dynamic_cast<LoadStringConstant*>(instr)) {
+    record.kind = KLoadStringConstant;
+    op[0] = LocationNum(ls->GetDst());
+    op[1] = StringNum(ls->GetString());
+  } else if (LoadDoubleConstant *ld = dynamic_cast<LoadDoubleConstant*>(instr)) {
+    record.kind = KLoadDoubleConstant;
+    op[0] = LocationNum(ld->GetDst());
+    op[1] = doubles.size();
+    doubles.push_back(ld->GetValue());
+  } else if (LoadLabel *ll = dynamic_cast<LoadLabel*>(instr)) {
+    record.kind = KLoadLabel;
+    op[0] = LocationNum(ll->GetDst());
+    op[1] = StringNum(ll->GetLabel());
+    NoteLabel(&referenced, ll->GetLabel());
+  } else if (dynamic_cast<Assign*>(instr)) {
+    record.kind = KAssign;
+    op[0] = LocationNum(instr->GetDst());
+    op[1] = LocationNum(instr->GetSrc(0));
+  } else if (Load *load = dynamic_cast<Load*>(instr)) {
+    record.kind = KLoad;
+    op[0] = LocationNum(load->GetDst());
+    op[1] = LocationNum(load->GetSrc(0));
+    op[2] = load->GetOffset();
+  } else if (Store *store = dynamic_cast<Store*>(instr)) {
+    record.kind = KStore;
+    op[0] = LocationNum(store->GetSrc(0));
+    op[1] = LocationNum(store->GetSrc(1));
+    op[2] = store->GetOffset();
+  } else if (dynamic_cast<BoundsCheck*>(instr)) {
+    record.kind = KBoundsCheck;
+    op[0] = LocationNum(instr->GetSrc(0));
+    op[1] = LocationNum(instr->GetSrc(1));
+  } else if (BinaryOp *bin = dynamic_cast<BinaryOp*>(instr)) {
+    record.kind = KBinaryOp;
+    record.code = bin->GetOpCode();
+    op[0] = LocationNum(bin->GetDst());
+    op[1] = LocationNum(bin->GetSrc(0));
+    op[2] = LocationNum(bin->GetSrc(1));
+  } else if (Label *label = dynamic_cast<Label*>(instr)) {
+    record.kind = KLabel;
+    op[0] = StringNum(label->text());
+    NoteLabel(&defined, label->text());
+  } else if (dynamic_cast<Goto*>(instr)) {
+    record.kind = KGoto;
+    op[0] = StringNum(instr->branch_label());
+  } else if (dynamic_cast<IfZ*>(instr)) {
+    record.kind = KIfZ;
+    op[0] = LocationNum(instr->GetSrc(0));
+    op[1] = StringNum(instr->branch_label());
+  } else if (IfCompare *cmp = dynamic_cast<IfCompare*>(instr)) {
+    record.kind = KIfCompare;
+    record.code = cmp->GetRelOp();
+    op[0] = LocationNum(cmp->GetSrc(0));
+    op[1] = LocationNum(cmp->GetSrc(1));
+    op[2] = StringNum(cmp->branch_label());
+  } else if (JumpTable *jump = dynamic_cast<JumpTable*>(instr)) {
+    // the words are the table label, the number of case labels and them
+    record.kind = KJumpTable;
+    List<const char *> *labels = jump->GetLabels();
+    op[0] = LocationNum(jump->GetSrc(0));
+    op[1] = jump->GetLow();
+    op[2] = StringNum(jump->branch_label());
+    op[3] = words.size();
+    words.push_back(StringNum(jump->GetTable()));
+    words.push_back(labels->NumElements());
+    for (int i = 0; i < labels->NumElements(); i++)
+      words.push_back(StringNum(labels->Nth(i)));
+  } else if (BeginFunc *begin = dynamic_cast<BeginFunc*>(instr)) {
+    record.kind = KBeginFunc;
+    op[0] = begin->GetFrameSize();
+    op[1] = begin->IsEntry();
+  } else if (dynamic_cast<EndFunc*>(instr)) {
+    record.kind = KEndFunc;
+  } else if (dynamic_cast<Return*>(instr)) {
+    record.kind = KReturn;
+    op[0] = instr->NumSrcs() ? LocationNum(instr->GetSrc(0)) : -1;
+  } else if (dynamic_cast<PushParam*>(instr)) {
+    record.kind = KPushParam;
+    op[0] = LocationNum(instr->GetSrc(0));
+  } else if (PopParams *pop = dynamic_cast<PopParams*>(instr)) {
+    record.kind = KPopParams;
+    op[0] = pop->GetNumBytes();
+  } else if (LCall *call = dynamic_cast<LCall*>(instr)) {
+    record.kind = KLCall;
+    op[0] = StringNum(call->GetLabel());
+    op[1] = LocationNum(call->GetDst());
+    NoteLabel(&referenced, call->GetLabel());
+  } else if (dynamic_cast<ACall*>(instr)) {
+    record.kind = KACall;
+    op[0] = LocationNum(instr->GetSrc(0));
+    op[1] = LocationNum(instr->GetDst());
+  } else if (VTable *vtable = dynamic_cast<VTable*>(instr)) {
+    record.kind = KVTable;
+    List<const char *> *methods = vtable->GetMethodLabels();
+    op[0] = StringNum(vtable->GetLabel());
+    op[1] = words.size();
+    op[2] = methods->NumElements();
+    for (int i = 0; i < methods->NumElements(); i++)
+      words.push_back(StringNum(methods->Nth(i)));
+    NoteLabel(&defined, vtable->GetLabel());
+    for (int i = 0; i < methods->NumElements(); i++)
+      NoteLabel(&referenced, methods->Nth(i));
+  } else {
+    Failure("A Phi can't be written to a Tac file");
+  }
+  instructions.push_back(record);
+}
+
+void TacWriter::SetRoots(List<int> *globalOffsets)
+{
+  firstRoot = words.size();
+  numRoots = globalOffsets->NumElements();
+  for (int i = 0; i < numRoots; i++)
+    words.push_back(globalOffsets->Nth(i));
+}
+
+void TacWriter::SetKey(const std::string &k)
+{
+  Assert(k.size() <= sizeof(((TacFileHeader *)0)->key));
+  key = k;
+}
+
+    // writes bytes from data, then zeros up to the next section
+static void WriteSection(FILE *fp, const void *data, size_t bytes)
+{
+  static const char zeros[8] = {0};
+  if (bytes) fwrite(data, 1, bytes, fp);
+  fwrite(zeros, 1, Align(bytes) - bytes, fp);
+}
+
+void TacWriter::Write(FILE *fp)
+{
+  TacFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "DTAC", 4);
+  header.version = TacFileVersion;
+  header.numStrings = stringOffsets.size();
+  header.stringBytes = stringText.size();
+  header.numLocations = locations.size();
+  header.numInstructions = instructions.size();
+  header.numDoubles = doubles.size();
+  memcpy(header.key, key.data(), key.size());
+  header.firstRoot = firstRoot;
+  header.numRoots = numRoots;
+  header.firstDefined = words.size();
+  header.numDefined = defined.size();
+  words.insert(words.end(), defined.begin(), defined.end());
+  header.firstReferenced = words.size();
+  header.numReferenced = referenced.size();
+  words.insert(words.end(), referenced.begin(), referenced.end());
+  header.numWords = words.size();
+  WriteSection(fp, &header, sizeof(header));
+  WriteSection(fp, stringOffsets.data(), stringOffsets.size() * sizeof(int));
+  WriteSection(fp, stringText.data(), stringText.size());
+  WriteSection(fp, locations.data(), locations.size() * sizeof(TacFileLocation));
+  WriteSection(fp, instructions.data(), instructions.size() * sizeof(TacFileInstruction));
+  WriteSection(fp, doubles.data(), doubles.size() * sizeof(double));
+  WriteSection(fp, words.data(), words.size() * sizeof(int));
+  fflush(fp);
+}
+
+
+/* The reader finds each section from the counts in the header and checks
+ * every index it follows against them, so a truncated or damaged file is
+ * reported rather than read out of bounds.
+ */
+TacReader::TacReader(const char *d, size_t size) : data(d), locations(NULL)
+{
+  header = (const TacFileHeader *)data;
+  if (size < sizeof(TacFileHeader) || memcmp(header->magic, "DTAC", 4) != 0)
+    Failure("Input is not a Tac file");
+  if (header->version != TacFileVersion)
+    Failure("Tac file has version %d (or another byte order), expected %d",
+            header->version, TacFileVersion);
+  int counts[] = { header->numStrings, header->stringBytes, header->numLocations,
+                   header->numInstructions, header->numDoubles, header->numWords };
+  for (int i = 0; i < 6; i++)
+    if (counts[i] < 0) Failure("Damaged Tac file");
+
+  size_t at = Align(sizeof(TacFileHeader));
+  stringOffsets = (const int *)(data + at);
+  at += Align(header->numStrings * sizeof(int));
+  stringText = data + at;
+  at += Align(header->stringBytes);
+  locationRecords = (const TacFileLocation *)(data + at);
+  at += Align(header->numLocations * sizeof(TacFileLocation));
+  instructions = (const TacFileInstruction *)(data + at);
+  at += Align(header->numInstructions * sizeof(TacFileInstruction));
+  doubles = (const double *)(data + at);
+  at += Align(header->numDoubles * sizeof(double));
+  words = (const int *)(data + at);
+  at += Align(header->numWords * sizeof(int));
+  if (at > size) Failure("Tac file is truncated");
+  if (header->stringBytes > 0 && stringText[header->stringBytes - 1] != '\0')
+    Failure("Damaged Tac file");
+  int ranges[][2] = { {header->firstRoot, header->numRoots},
+                      {header->firstDefined, header->numDefined},
+                      {header->firstReferenced, header->numReferenced} };
+  for (int i = 0; i < 3; i++)
+    if (ranges[i][0] < 0 || ranges[i][1] < 0 ||
+        ranges[i][0] + ranges[i][1] > header->numWords)
+      Failure("Damaged Tac file");
+  renamed.resize(header->numStrings);
+}
+
+const char *TacReader::String(int n)
+{
+  if (n < 0 || n >= header->numStrings ||
+      stringOffsets[n] < 0 || stringOffsets[n] >= header->stringBytes)
+    Failure("Damaged Tac file: no string %d", n);
+  if (!renamed[n].empty()) return renamed[n].c_str();
+  return stringText + stringOffsets[n];
+}
+
+Location *TacReader::LocationNumbered(int n)
+{
+  if (n == -1) return NULL;
+  if (n < 0 || n >= header->numLocations)
+    Failure("Damaged Tac file: no location %d", n);
+  if (!locations) {
+    locations = new Location*[header->numLocations];
+    memset(locations, 0, header->numLocations * sizeof(Location*));
+  }
+  if (!locations[n]) {
+    const TacFileLocation &record = locationRecords[n];
+    if (record.base >= n)        // written before the Locations based on it
+      Failure("Damaged Tac file: location %d", n);
+    Location *base = LocationNumbered(record.base);
+    if (base)
+      locations[n] = new Location(base, record.offset, String(record.name));
+    else
+      locations[n] = new Location((Segment)record.segment, record.offset, String(record.name));
+    if (record.isDouble) locations[n]->SetType(Type::doubleType);
+  }
+  return locations[n];
+}
+
+    // a Location operand that must be there
+#define LOC(i) NonNull(LocationNumbered(op[i]))
+static Location *NonNull(Location *loc)
+{
+  if (!loc) Failure("Damaged Tac file: missing operand");
+  return loc;
+}
+
+Instruction *TacReader::Read(int n)
+{
+  Assert(n >= 0 && n < header->numInstructions);
+  const TacFileInstruction &record = instructions[n];
+  const int *op = record.operand;
+  switch (record.kind) {
+    case KLoadConstant: return new LoadConstant(LOC(0), op[1]);
+    case KLoadStringConstant: return new LoadStringConstant(LOC(0), String(op[1]));
+    case KLoadDoubleConstant:
+      if (op[1] < 0 || op[1] >= header->numDoubles) break;
+      return new LoadDoubleConstant(LOC(0), doubles[op[1]]);
+    case KLoadLabel: return new LoadLabel(LOC(0), String(op[1]));
+    case KAssign: return new Assign(LOC(0), LOC(1));
+    case KLoad: return new Load(LOC(0), LOC(1), op[2]);
+    case KStore: return new Store(LOC(0), LOC(1), op[2]);
+    case KBoundsCheck: return new BoundsCheck(LOC(0), LOC(1));
+    case KBinaryOp:
+      if (record.code >= BinaryOp::NumOps) break;
+      return new BinaryOp((BinaryOp::OpCode)record.code, LOC(0), LOC(1), LOC(2));
+    case KLabel: return new Label(String(op[0]));
+    case KGoto: return new Goto(String(op[0]));
+    case KIfZ: return new IfZ(LOC(0), String(op[1]));
+    case KIfCompare:
+      if (record.code >= IfCompare::NumRelOps) break;
+      return new IfCompare((IfCompare::RelOp)record.code, LOC(0), LOC(1), String(op[2]));
+    case KJumpTable: {
+      if (op[3] < 0 || op[3] + 2 > header->numWords) break;
+      int count = words[op[3] + 1];
+      if (count < 0 || op[3] + 2 + count > header->numWords) break;
+      List<const char *> *labels = new List<const char *>;
+      for (int i = 0; i < count; i++)
+        labels->Append(String(words[op[3] + 2 + i]));
+      return new JumpTable(LOC(0), op[1], String(words[op[3]]), labels, String(op[2]));
+    }
+    case KBeginFunc: {
+      BeginFunc *begin = new BeginFunc(op[1] != 0);
+      begin->SetFrameSize(op[0]);
+      return begin;
+    }
+    case KEndFunc: return new EndFunc();
+    case KReturn: return new Return(LocationNumbered(op[0]));
+    case KPushParam: return new PushParam(LOC(0));
+    case KPopParams: return new PopParams(op[0]);
+    case KLCall: return new LCall(String(op[0]), LocationNumbered(op[1]));
+    case KACall: return new ACall(LOC(0), LocationNumbered(op[1]));
+    case KVTable: {
+      if (op[1] < 0 || op[2] < 0 || op[1] + op[2] > header->numWords) break;
+      List<const char *> *methods = new List<const char *>;
+      for (int i = 0; i < op[2]; i++)
+        methods->Append(String(words[op[1] + i]));
+      return new VTable(String(op[0]), methods);
+    }
+  }
+  Failure("Damaged Tac file: instruction %d", n);
+  return NULL;
+}
+
+void TacReader::GetRoots(List<int> *globalOffsets)
+{
+  for (int i = 0; i < header->numRoots; i++)
+    globalOffsets->Append(words[header->firstRoot + i]);
+}
+
+std::string TacReader::GetKey() const
+{
+  return std::string(header->key, strnlen(header->key, sizeof(header->key)));
+}
+
+std::string TacReader::KeyOf(const char *path)
+{
+  TacFileHeader header;
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return "";
+  bool read = fread(&header, sizeof(header), 1, fp) == 1;
+  fclose(fp);
+  if (!read || memcmp(header.magic, "DTAC", 4) != 0 || header.version != TacFileVersion)
+    return "";
+  return std::string(header.key, strnlen(header.key, sizeof(header.key)));
+}
+
+void TacReader::GetLabels(int first, int count, List<const char *> *labels)
+{
+  for (int i = 0; i < count; i++)
+    labels->Append(String(words[first + i]));
+}
+
+void TacReader::GetDefined(List<const char *> *labels)
+{
+  GetLabels(header->firstDefined, header->numDefined, labels);
+}
+
+void TacReader::GetReferenced(List<const char *> *labels)
+{
+  GetLabels(header->firstReferenced, header->numReferenced, labels);
+}
+
+void TacReader::RenumberLabels(int *nextLabelNum)
+{
+  for (int n = 0; n < header->numStrings; n++) {
+    renamed[n].clear();
+    if (!IsLocalLabel(String(n))) continue;
+    char label[16];
+    sprintf(label, "_L%d", (*nextLabelNum)++);
+    renamed[n] = label;
+  }
+}
+
+
+/* Method: Open
+ * ------------
+ * A regular file is mapped into memory, anything else (a pipe) is read.
+ * The memory stays for the rest of the compile.
+ */
+TacReader *TacReader::Open(FILE *fp)
+{
+  struct stat info;
+  if (fstat(fileno(fp), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (mapped != MAP_FAILED)
+      return new TacReader((const char *)mapped, info.st_size);
+  }
+  size_t capacity = 1 << 16, length = 0, n;
+  char *buffer = (char *)malloc(capacity);
+  while ((n = fread(buffer + length, 1, capacity - length, fp)) > 0) {
+    length += n;
+    if (length == capacity) buffer = (char *)realloc(buffer, capacity *= 2);
+  }
+  return new TacReader(buffer, length);
+}
+
+void EmitTacFile(FILE *fp)
+{
+  TacReader &reader = *TacReader::Open(fp);
+  bool printTac = IsDebugOn("tac");
+  Mips mips;
+  if (!printTac) mips.EmitPreamble();
+  for (int i = 0; i < reader.NumInstructions(); i++) {
+    Instruction *instr = reader.Read(i);
+    if (printTac)
+      instr->Print();
+    else
+      instr->Emit(&mips);
+    delete instr;
+  }
+  if (printTac) return;
+  List<int> roots;
+  reader.GetRoots(&roots);
+  mips.EmitGcRoots(&roots);
+  mips.EmitStringPool();
+  mips.EmitDoublePool();
+  mips.EmitJumpTables();
+}
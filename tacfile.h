@@ -0,0 +1,144 @@
+/* File: tacfile.h
+ * ---------------
+ * A binary file format for the Tac of a program, so the output of the
+ * front end and optimizer can be saved (-d tacfile writes it to stdout
+ * in place of the assembly) and translated later by itself (-d fromtac
+ * reads it from stdin and runs only the Mips backend, or prints the Tac
+ * under -d tac as well).
+ *
+ * The file is a header followed by sections of fixed-size records, all
+ * in the byte order of the machine that wrote it and referring to each
+ * other by index, never by pointer, so it can be used straight from an
+ * mmap'd copy:
+ *
+ *    strings       a table of offsets into a block of '\0'-terminated
+ *                  text: every variable name, label and string constant,
+ *                  each distinct one stored once
+ *    locations     name, segment, offset, base (-1 if none) and whether
+ *                  the slot holds a double, one per distinct Location
+ *                  (instructions sharing a Location share the record)
+ *    instructions  a kind, a sub-code (the BinaryOp or IfCompare
+ *                  operator) and four operands: Location, string, double
+ *                  or word indexes or plain numbers, depending on kind
+ *    doubles       the values of double constants
+ *    words         method label lists of vtables, the labels of jump
+ *                  tables, the $gp offsets of the globals the collector
+ *                  treats as roots, and the labels the code defines and
+ *                  those it refers to
+ *
+ * The last two make a Tac file an object file for the linker (link.h),
+ * which also checks the key the header can carry. Labels made by
+ * NewLabel (_L and a number) are local to the file and left out.
+ *
+ * Phi instructions only exist inside the optimizer and are never written.
+ */
+
+#ifndef _H_tacfile
+#define _H_tacfile
+
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "list.h"
+
+class Instruction;
+class Location;
+
+struct TacFileHeader {
+  char magic[4];                        // "DTAC"
+  int version;                          // also tells the byte order
+  int numStrings, stringBytes, numLocations, numInstructions,
+      numDoubles, numWords;
+  char key[32];                         // see SetKey
+  int firstRoot, numRoots;              // in the words section
+  int firstDefined, numDefined, firstReferenced, numReferenced;
+};
+
+struct TacFileLocation {
+  int name, segment, offset, base, isDouble;
+};
+
+struct TacFileInstruction {
+  unsigned char kind, code;
+  short unused;
+  int operand[4];
+};
+
+
+class TacWriter {
+  private:
+    std::vector<int> stringOffsets;
+    std::string stringText;
+    std::map<std::string, int> stringNums;
+    std::vector<TacFileLocation> locations;
+    std::map<Location*, int> locationNums;
+    std::vector<TacFileInstruction> instructions;
+    std::vector<double> doubles;
+    std::vector<int> words;
+    int firstRoot, numRoots;
+    std::set<int> defined, referenced;     // label string numbers
+    std::string key;
+
+    int StringNum(const char *str);
+    int LocationNum(Location *loc);     // -1 for NULL
+    void NoteLabel(std::set<int> *labels, const char *label);
+
+  public:
+    TacWriter();
+
+         // Records instr, which can be deleted afterwards
+    void Append(Instruction *instr);
+    void SetRoots(List<int> *globalOffsets);
+         // Up to 32 characters identifying what the file was made from
+    void SetKey(const std::string &key);
+    void Write(FILE *fp);
+};
+
+
+class TacReader {
+  private:
+    const char *data;
+    const TacFileHeader *header;
+    const int *stringOffsets;
+    const char *stringText;
+    const TacFileLocation *locationRecords;
+    const TacFileInstruction *instructions;
+    const double *doubles;
+    const int *words;
+    Location **locations;               // made on first use
+    std::vector<std::string> renamed;   // by RenumberLabels
+
+    const char *String(int n);
+    Location *LocationNumbered(int n);  // NULL for -1
+    void GetLabels(int first, int count, List<const char *> *labels);
+
+  public:
+         // Reads the size bytes of a file at data, which must stay
+         // valid while the reader is used. Fails on a damaged file.
+    TacReader(const char *data, size_t size);
+         // A reader of the file fp, mmap'd when it is a regular file
+    static TacReader *Open(FILE *fp);
+         // The key of the Tac file at path, empty when there is no such
+         // file or it isn't one this compiler can read
+    static std::string KeyOf(const char *path);
+
+    int NumInstructions() const { return header->numInstructions; }
+         // Returns a new instruction built from the nth record
+    Instruction *Read(int n);
+    void GetRoots(List<int> *globalOffsets);
+
+    std::string GetKey() const;
+    void GetDefined(List<const char *> *labels);
+    void GetReferenced(List<const char *> *labels);
+         // Renames the local labels to _L numbers from nextLabelNum on
+         // (and advances it), so files made apart can be put together
+    void RenumberLabels(int *nextLabelNum);
+};
+
+     // The -d fromtac tool: reads a Tac file from fp and emits the program
+     // to stdout, as assembly or, under -d tac, as Tac.
+void EmitTacFile(FILE *fp);
+
+#endif
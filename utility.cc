@@ -10,6 +10,8 @@
 #include <string.h>
 
 static List<const char*> debugKeys;
+static List<const char*> sourceFiles;
+static List<int> firstLines;     // of each source file
 static const int BufferSize = 2048;
 
 void Failure(const char *format, ...)
@@ -40,6 +42,17 @@ bool IsDebugOn(const char *key)
 }
 
 
+int NumDebugKeys()
+{
+   return debugKeys.NumElements();
+}
+
+const char *NthDebugKey(int n)
+{
+   return debugKeys.Nth(n);
+}
+
+
 void SetDebugForKey(const char *key, bool value)
 {
   int k = IndexOf(key);
@@ -68,15 +81,73 @@ void PrintDebug(const char *key, const char *format, ...)
 
 void ParseCommandLine(int argc, char *argv[])
 {
-  if (argc == 1)
-    return;
-  
-  if (strcmp(argv[1], "-d") != 0) { // first arg is not -d
-    printf("Usage:   -d <debug-key-1> <debug-key-2> ... \n");
-    exit(2);
+  int i = 1;
+  for (; i < argc && strcmp(argv[i], "-d") != 0; i++) {
+    if (argv[i][0] == '-') { // an option other than -d
+      printf("Usage:   [file ...] [-d <debug-key-1> <debug-key-2> ...] \n");
+      exit(2);
+    }
+    sourceFiles.Append(argv[i]);
   }
 
-  for (int i = 2; i < argc; i++)
+  for (i++; i < argc; i++)
     SetDebugForKey(argv[i], true);
 }
 
+
+int NumSourceFiles()
+{
+  return sourceFiles.NumElements();
+}
+
+const char *NthSourceFile(int n)
+{
+  return sourceFiles.Nth(n);
+}
+
+FILE *OpenSourceFiles()
+{
+  if (sourceFiles.NumElements() == 0) return stdin;
+
+  char *text = NULL;
+  size_t length = 0;
+  FILE *all = open_memstream(&text, &length);
+  int line = 1, c = '\n';
+  for (int i = 0; i < sourceFiles.NumElements(); i++) {
+    FILE *fp = fopen(sourceFiles.Nth(i), "r");
+    if (!fp) {
+      fprintf(stderr, "Can't open %s\n", sourceFiles.Nth(i));
+      exit(2);
+    }
+    firstLines.Append(line);
+    char buf[BufferSize];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+      fwrite(buf, 1, n, all);
+      for (size_t k = 0; k < n; k++)
+        if (buf[k] == '\n') line++;
+      c = buf[n-1];
+    }
+    fclose(fp);
+    if (c != '\n') { // so the next file starts on a line of its own
+      fputc('\n', all);
+      line++;
+      c = '\n';
+    }
+  }
+  fclose(all);
+  return fmemopen(text, length, "r");
+}
+
+int SourceFileForLine(int line)
+{
+  int n = 0;
+  while (n + 1 < firstLines.NumElements() && firstLines.Nth(n + 1) <= line)
+    n++;
+  return n;
+}
+
+int FirstLineOfSourceFile(int n)
+{
+  return firstLines.Nth(n);
+}
@@ -71,13 +71,40 @@ void SetDebugForKey(const char *key, bool val);
 bool IsDebugOn(const char *key);
 
 
+/* Function: NumDebugKeys(), NthDebugKey()
+ * Usage: for (int i = 0; i < NumDebugKeys(); i++) ... NthDebugKey(i)
+ * ------------------------------------------------------------------
+ * The keys currently on, in the order they were turned on. Many of
+ * them change the code generated, so the compilation cache keys on
+ * them all.
+ */
+int NumDebugKeys();
+const char *NthDebugKey(int n);
+
+
 
 /* Function: ParseCommandLine
  * --------------------------
- * Turn on the debugging flags from the command line.  Verifies that
- * first argument is -d, and then interpret all the arguments that follow
- * as being flags to turn on.
+ * Reads the command line, "dcc [file ...] [-d key ...]": the names of
+ * the source files, then after -d the debugging flags to turn on.
  */
 void ParseCommandLine(int argc, char *argv[]);
+
+
+/* Function: NumSourceFiles(), NthSourceFile(), OpenSourceFiles()
+ * Usage: FILE *fp = OpenSourceFiles();
+ * --------------------------------------------------------------
+ * The source files named on the command line, none when the program is
+ * read from stdin. OpenSourceFiles returns a stream of the text of all
+ * of them, one after the other, for the scanner to read as one program
+ * (stdin if there are none). Line numbers run on from one file into the
+ * next; SourceFileForLine maps one back to the index of its file, and
+ * FirstLineOfSourceFile gives the number the first line of file n has.
+ */
+int NumSourceFiles();
+const char *NthSourceFile(int n);
+FILE *OpenSourceFiles();
+int SourceFileForLine(int line);
+int FirstLineOfSourceFile(int n);
      
 #endif
@@ -0,0 +1,186 @@
+/* File: valnum.cc
+ * ---------------
+ * Implementation of local value numbering. A Location's number is looked
+ * up in current, and a Location not written yet in the block gets a
+ * fresh number standing for whatever it held on entry.
+ */
+
+#include "valnum.h"
+#include "cfg.h"
+#include "codegen.h"
+#include <map>
+#include <string>
+#include <utility>
+#include <stdio.h>
+
+struct Available {
+  int value;
+  Location *holder;     // has the value as long as its number is value
+};
+
+typedef std::pair<int, int> Word;       // pointer's number, offset
+
+class ValueNumberer {
+  private:
+    int next;
+    std::map<Location*, int> current;
+    std::map<std::string, Available> computed;
+    std::map<Word, Available> memory;
+    std::map<Word, int> width;
+
+    int NumberOf(Location *loc);
+    void Define(Location *loc, int value) { current[loc] = value; }
+    Location *Find(Available *avail);
+    void KillMemory(Word word, int bytes);
+    void Clobber(bool globals);
+    Instruction *Number(Instruction *instr);
+
+  public:
+    ValueNumberer() : next(0) {}
+    void NumberBlock(BasicBlock *b);
+};
+
+int ValueNumberer::NumberOf(Location *loc)
+{
+  std::map<Location*, int>::iterator found = current.find(loc);
+  if (found != current.end()) return found->second;
+  return current[loc] = next++;
+}
+
+Location *ValueNumberer::Find(Available *avail)
+{
+  if (!avail || !avail->holder) return NULL;
+  return NumberOf(avail->holder) == avail->value ? avail->holder : NULL;
+}
+
+//a store of bytes at word may change any load except those from the
+//same pointer at offsets that don't overlap it
+void ValueNumberer::KillMemory(Word word, int bytes)
+{
+  std::map<Word, Available>::iterator p = memory.begin();
+  while (p != memory.end()) {
+    const Word &w = p->first;
+    bool disjoint = w.first == word.first
+      && (w.second + width[w] <= word.second || word.second + bytes <= w.second);
+    if (disjoint) ++p;
+    else memory.erase(p++);
+  }
+}
+
+void ValueNumberer::Clobber(bool globals)
+{
+  memory.clear();
+  if (!globals) return;
+  std::map<Location*, int>::iterator p;
+  for (p = current.begin(); p != current.end(); ++p)
+    if (p->first->GetSegment() == gpRelative) p->second = next++;
+}
+
+static bool Commutes(BinaryOp::OpCode code)
+{
+  return code == BinaryOp::Add || code == BinaryOp::Mul || code == BinaryOp::Eq
+      || code == BinaryOp::And || code == BinaryOp::Or;
+}
+
+static int Bytes(Location *loc)
+{
+  return loc->IsDouble() ? CodeGenerator::DoubleSize : CodeGenerator::VarSize;
+}
+
+/* Method: Number
+ * --------------
+ * Numbers the value instr computes and returns the instruction to keep
+ * in its place: instr itself, or an Assign when the value is already
+ * held somewhere.
+ */
+Instruction *ValueNumberer::Number(Instruction *instr)
+{
+  char key[64];
+  key[0] = '\0';
+  Location *dst = instr->GetDst();
+
+  if (Assign *copy = dynamic_cast<Assign*>(instr)) {
+    Define(dst, NumberOf(copy->GetSrc(0)));
+    return instr;
+  }
+  if (LoadConstant *load = dynamic_cast<LoadConstant*>(instr)) {
+    sprintf(key, "c %d", load->GetValue());
+    Available &avail = computed[key];
+    if (!avail.holder) avail.value = next++;
+    avail.holder = dst;
+    Define(dst, avail.value);   // a move is no cheaper than li, keep it
+    return instr;
+  }
+  if (Store *store = dynamic_cast<Store*>(instr)) {
+    Word word(NumberOf(store->GetSrc(0)), store->GetOffset());
+    KillMemory(word, Bytes(store->GetSrc(1)));
+    Available avail = { NumberOf(store->GetSrc(1)), store->GetSrc(1) };
+    memory[word] = avail;
+    width[word] = Bytes(store->GetSrc(1));
+    return instr;
+  }
+  if (LCall *call = dynamic_cast<LCall*>(instr)) {
+    Clobber(!CodeGenerator::IsBuiltIn(call->GetLabel()));
+  } else if (dynamic_cast<ACall*>(instr)) {
+    Clobber(true);
+  }
+
+  if (Load *load = dynamic_cast<Load*>(instr)) {
+    Word word(NumberOf(load->GetSrc(0)), load->GetOffset());
+    std::map<Word, Available>::iterator found = memory.find(word);
+    if (found != memory.end() && width[word] == Bytes(dst)) {
+      if (Location *holder = Find(&found->second)) {
+        Define(dst, found->second.value);
+        return new Assign(dst, holder);
+      }
+    }
+    Available avail = { next++, dst };
+    memory[word] = avail;
+    width[word] = Bytes(dst);
+    Define(dst, avail.value);
+    return instr;
+  }
+  if (LoadLabel *load = dynamic_cast<LoadLabel*>(instr)) {
+    snprintf(key, sizeof(key), "l %s", load->GetLabel());
+  } else if (BinaryOp *op = dynamic_cast<BinaryOp*>(instr)) {
+    int a = NumberOf(op->GetSrc(0)), b = NumberOf(op->GetSrc(1));
+    if (Commutes(op->GetOpCode()) && b < a) std::swap(a, b);
+    sprintf(key, "b %d %d %d", op->GetOpCode(), a, b);
+  }
+
+  if (key[0]) {
+    std::map<std::string, Available>::iterator found = computed.find(key);
+    if (found != computed.end()) {
+      if (Location *holder = Find(&found->second)) {
+        Define(dst, found->second.value);
+        return new Assign(dst, holder);
+      }
+    }
+    Available avail = { next++, dst };
+    computed[key] = avail;
+    Define(dst, avail.value);
+    return instr;
+  }
+  if (dst) Define(dst, next++);
+  return instr;
+}
+
+void ValueNumberer::NumberBlock(BasicBlock *b)
+{
+  current.clear();
+  computed.clear();
+  memory.clear();
+  width.clear();
+  std::list<Instruction*>::iterator p;
+  for (p = b->code.begin(); p != b->code.end(); ++p)
+    *p = Number(*p);
+}
+
+
+void NumberValues(FlowGraph *graph)
+{
+  ValueNumberer numberer;
+  std::vector<BasicBlock*> &blocks = graph->Blocks();
+  for (int i = 0; i < (int)blocks.size(); i++)
+    numberer.NumberBlock(blocks[i]);
+}
@@ -0,0 +1,33 @@
+/* File: valnum.h
+ * --------------
+ * Common subexpression elimination by value numbering over the Tac of
+ * one function.
+ *
+ * Every value computed in a basic block gets a number, equal numbers
+ * meaning equal values: a copy has the number of its source, constants
+ * are numbered by value, and a BinaryOp (operands in a fixed order when
+ * the op commutes), Load or LoadLabel by what it computes from its
+ * operands' numbers. An instruction recomputing a value some Location
+ * still holds becomes an Assign from that Location, so repeated field
+ * loads, index arithmetic and vtable labels are done once per block.
+ *
+ * Loads follow a conservative alias model: a Store may change any word
+ * except those at other offsets from the same pointer, and a call may
+ * change all of memory and every global. A Store also makes the value
+ * it wrote available to later loads of the same word.
+ *
+ * The tables are kept by ValueNumberer (valnum.cc) and reset at the
+ * start of each block. Numbering along the dominator tree instead,
+ * starting each block from the tables of its immediate dominator, would
+ * make this global value numbering; the memory table would then also
+ * have to be cleared at blocks with more than one predecessor.
+ */
+
+#ifndef _H_valnum
+#define _H_valnum
+
+class FlowGraph;
+
+void NumberValues(FlowGraph *graph);
+
+#endif